@@ -0,0 +1,26 @@
+program test;
+var
+    n: integer;
+    c: char;
+
+function fact(k: integer): integer;
+begin
+    if k <= 1 then
+        Result := 1
+    else
+        Result := k * fact(k - 1);
+end;
+
+procedure bump(var x: integer; d: real);
+begin
+    n := n + 1;
+    x := x + 2;
+    write(d * 2);
+end;
+
+begin
+    n := 0;
+    c := 'a';
+    bump(n, 1.75);
+    write(fact(6), ' ', n, ' ', c, ' ', 'done');
+end.
@@ -0,0 +1,31 @@
+program test;
+type
+    point = record
+        x: integer;
+        y: real;
+    end;
+
+function make(a: integer; b: real): point;
+begin
+    Result.x := a;
+    Result.y := b;
+end;
+
+function shift(p: point): point;
+var
+    k: integer;
+begin
+    k := 1;
+    while k <= 3 do begin
+        p.x := p.x + k;
+        k := k + 1;
+    end;
+    Result := p;
+end;
+
+var
+    p: point;
+begin
+    p := shift(make(4, 2.5));
+    write(p.x, ' ', p.y);
+end.
@@ -0,0 +1,50 @@
+program test;
+type
+    point = record
+        x: integer;
+        y: integer;
+        c: char;
+    end;
+    line = array [1..3] of point;
+    path = array [1..7] of line;
+
+var
+    p, q: point;
+    l: line;
+    a, b: path;
+    i, j: integer;
+
+function shift(v: path; d: integer): path;
+var
+    i, j: integer;
+begin
+    for i := 1 to 7 do
+        for j := 1 to 3 do
+            v[i][j].x := v[i][j].x + d;
+    Result := v;
+end;
+
+function first(v: line): point;
+begin
+    exit(v[1]);
+end;
+
+begin
+    p.x := 1;
+    p.y := 2;
+    p.c := 'p';
+    q := p;
+    for i := 1 to 7 do
+        for j := 1 to 3 do
+        begin
+            a[i][j] := q;
+            a[i][j].x := i;
+            a[i][j].y := j;
+        end;
+    l := a[4];
+    write(l[1].x, ' ', l[2].y, ' ', l[3].c);
+    b := shift(a, 10);
+    write(b[1][1].x, ' ', b[7][3].x, ' ', b[7][3].y, ' ', a[7][3].x);
+    q := first(b[5]);
+    write(q.x, ' ', q.y, ' ', q.c);
+end.
@@ -0,0 +1,20 @@
+program test;
+var x, y, z: real; i: integer; ch: char;
+begin
+    x := 1.5; y := 1.5; z := 0.0; z := z / z;
+    if x = y then write('eq1') else write('ne1');
+    if x <> y then write('ne2') else write('eq2');
+    if x = z then write('eq3') else write('ne3');
+    if x <> z then write('ne4') else write('eq4');
+    if x < z then write('lt5') else write('nlt5');
+    if x >= y then write('ge6') else write('nge6');
+    i := 0;
+    while x <> 3.0 do begin x := x + 0.5; i := i + 1 end;
+    write(i);
+    repeat x := x - 0.5 until x = y;
+    write(x);
+    ch := 'b';
+    if ch > 'a' then write('chgt') else write('chle');
+    while ch < 'e' do ch := 'e';
+    write(ch);
+end.
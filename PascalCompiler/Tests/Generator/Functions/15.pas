@@ -0,0 +1,39 @@
+program test;
+type
+    pair = record
+        x: integer;
+        y: integer;
+    end;
+
+var
+    p: pair;
+
+function make(x, y: integer): pair;
+begin
+    Result.x := x;
+    Result.y := y;
+end;
+
+function add(a, b: pair): pair;
+begin
+    Result.x := a.x + b.x;
+    Result.y := a.y + b.y;
+end;
+
+function fib(n: integer): pair;
+var
+    t: pair;
+begin
+    if n = 0 then
+        exit(make(0, 1));
+    t := fib(n - 1);
+    Result := make(t.y, t.x + t.y);
+end;
+
+begin
+    p := add(make(1, 2), make(30, 40));
+    write(p.x, ' ', p.y);
+    p := add(fib(10), add(p, fib(3)));
+    write(p.x, ' ', p.y);
+    write(fib(20).x, ' ', make(7, 8).y);
+end.
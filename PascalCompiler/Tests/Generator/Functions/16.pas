@@ -0,0 +1,69 @@
+program test;
+type
+    vector = array [1..8] of integer;
+    pair = record
+        x: integer;
+        y: integer;
+    end;
+
+var
+    v, w: vector;
+    p: pair;
+    i: integer;
+
+function sum(const a: vector): integer;
+var
+    i: integer;
+begin
+    Result := 0;
+    for i := 1 to 8 do
+        Result := Result + a[i];
+end;
+
+function dot(a, b: vector): integer;
+var
+    i: integer;
+begin
+    Result := 0;
+    for i := 1 to 8 do
+        Result := Result + a[i] * b[i];
+end;
+
+function swap(const p: pair): pair;
+begin
+    Result.x := p.y;
+    Result.y := p.x;
+end;
+
+function twice(a: vector): integer;
+var
+    i: integer;
+begin
+    for i := 1 to 8 do
+        a[i] := a[i] * 2;
+    Result := sum(a);
+end;
+
+procedure scale(a: vector; var b: vector);
+var
+    i: integer;
+begin
+    for i := 1 to 8 do
+        b[i] := a[i] * i + a[1];
+end;
+
+begin
+    for i := 1 to 8 do
+    begin
+        v[i] := i;
+        w[i] := 9 - i;
+    end;
+    p.x := 1;
+    p.y := 2;
+    write(sum(v), ' ', dot(v, w), ' ', twice(v), ' ', sum(v));
+    p := swap(p);
+    write(p.x, ' ', p.y, ' ', swap(swap(p)).x);
+    scale(v, v);
+    for i := 1 to 8 do
+        write(v[i], ' ');
+end.
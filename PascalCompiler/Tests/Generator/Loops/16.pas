@@ -0,0 +1,25 @@
+program test;
+var
+    a: array [1..50] of integer;
+    i, s: integer;
+begin
+    for i := 1 to 50 do
+        a[i] := i;
+    s := 0;
+    for i := 1 to 50 do
+    begin
+        if a[i] mod 7 = 0 then
+            continue;
+        if a[i] > 45 then
+            break;
+        s := s + a[i];
+    end;
+    write(s);
+    write(i);
+    for i := 10 downto 3 do
+        s := s - i;
+    write(s);
+    for i := 5 to 4 do
+        s := 0;
+    write(s);
+end.
@@ -0,0 +1,33 @@
+program test;
+var
+    i, n: integer;
+    a: array [1..5] of integer;
+
+function check(v: integer): integer;
+begin
+    write('check ', v);
+    Result := v;
+end;
+
+begin
+    n := 0;
+    for i := 1 to 5 do
+        a[i] := i * 3;
+    if (n > 0) and (check(1) > 0) then
+        write('both');
+    if (n = 0) or (check(2) > 0) then
+        write('either');
+    if not ((n > 0) and (check(3) > 0)) then
+        write('not both');
+    i := 1;
+    while (i <= 5) and (a[i] < 10) do
+        i := i + 1;
+    write(i);
+    repeat
+        i := i - 1
+    until (i < 2) or (check(i) > 3);
+    if (n + 1) and 2 then
+        write('bitwise')
+    else
+        write('no bits');
+end.
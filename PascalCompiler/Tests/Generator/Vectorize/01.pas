@@ -0,0 +1,56 @@
+program test;
+type
+    vector = array [0..30] of integer;
+var
+    a, b, c: array [1..21] of real;
+    x, y: vector;
+    i, n, s: integer;
+    k, t: real;
+
+procedure scale(var v: vector; n: integer);
+var
+    i: integer;
+begin
+    for i := 0 to n do
+        v[i] *= 3;
+end;
+
+begin
+    for i := 1 to 21 do
+    begin
+        a[i] := i;
+        b[i] := 0.5 * i;
+    end;
+    k := 2;
+    for i := 1 to 21 do
+        c[i] := a[i] * b[i] + k;
+    write(c[1], ' ', c[2], ' ', c[20], ' ', c[21], ' ', i);
+    for i := 3 to 20 do
+        c[i] -= a[i] / b[i];
+    write(c[2], ' ', c[3], ' ', c[20], ' ', c[21]);
+    n := 30;
+    for i := 0 to n do
+        x[i] := i * i;
+    for i := 0 to n do
+        y[i] := x[i] + x[i] - i + 1;
+    write(y[0], ' ', y[1], ' ', y[29], ' ', y[30]);
+    for i := 5 to n - 2 do
+        y[i] += 100;
+    write(y[4], ' ', y[5], ' ', y[28], ' ', y[29]);
+    s := 0;
+    for i := 0 to n do
+        s := s + x[i];
+    write(s, ' ', i);
+    for i := 1 to n do
+        s -= y[i] - x[i];
+    write(s);
+    t := 0;
+    for i := 1 to 21 do
+        t := t + a[i];
+    write(t);
+    scale(x, 9);
+    write(x[8], ' ', x[9], ' ', x[10]);
+    for i := n to 4 do
+        x[i] := 0;
+    write(i);
+end.
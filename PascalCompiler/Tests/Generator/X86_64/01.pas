@@ -0,0 +1,45 @@
+program test;
+type
+    point = record x: integer; y: integer; end;
+    line = array [1..20] of integer;
+var
+    p: point;
+    l: line;
+    i: integer;
+    r: real;
+
+function fact(n: integer): integer;
+begin
+    if n <= 1 then
+        exit(1);
+    exit(n * fact(n - 1));
+end;
+
+function sum(v: line; n: integer): integer;
+var
+    i, s: integer;
+begin
+    s := 0;
+    for i := 1 to n do
+        s := s + v[i];
+    v[1] := 0;
+    exit(s);
+end;
+
+function shift(p: point; d: integer): point;
+begin
+    p.x := p.x + d;
+    p.y := p.y - d;
+    exit(p);
+end;
+
+begin
+    for i := 1 to 20 do
+        l[i] := i * i;
+    p.x := 3;
+    p.y := 4;
+    p := shift(p, 10);
+    r := fact(10) / 7;
+    write(fact(5), ' ', fact(10), ' ', r, ' ', p.x, ' ', p.y);
+    write(sum(l, 20), ' ', l[1], ' ', 'a', ' ', 2.5, ' ', -r, ' ', i);
+end.
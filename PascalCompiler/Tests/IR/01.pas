@@ -0,0 +1,19 @@
+program test;
+var
+    i, s: integer;
+    r: real;
+begin
+    s := 0;
+    for i := 1 to 10 do
+        if i mod 2 = 0 then
+            s := s + i
+        else
+            continue;
+    r := s / 4;
+    while s > 0 do begin
+        s := s - 7;
+        if s < 10 then
+            break;
+    end;
+    write(s, ' ', r);
+end.
\ No newline at end of file
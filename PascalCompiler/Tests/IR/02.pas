@@ -0,0 +1,20 @@
+program test;
+var
+    a: integer;
+
+    function f(x: integer; var y: integer): integer;
+
+        procedure g;
+        begin
+            y := y + x;
+        end;
+
+    begin
+        g;
+        result := x * y;
+    end;
+
+begin
+    a := 2;
+    write(f(3, a), ' ', a);
+end.
\ No newline at end of file
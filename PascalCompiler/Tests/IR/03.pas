@@ -0,0 +1,18 @@
+program test;
+type
+    point = record
+        x: integer;
+        y: integer;
+    end;
+var
+    a: array [1..5] of point;
+    p: point;
+    i: integer;
+begin
+    for i := 1 to 5 do begin
+        a[i].x := i;
+        a[i].y := i * i;
+    end;
+    p := a[3];
+    write(p.x, ' ', p.y);
+end.
\ No newline at end of file
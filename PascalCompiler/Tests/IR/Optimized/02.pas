@@ -0,0 +1,20 @@
+program test;
+var
+    a: array [1..10] of integer;
+    i, s: integer;
+
+    function sum(n: integer): integer;
+    var
+        k: integer;
+    begin
+        result := 0;
+        for k := 1 to n do
+            result := result + a[k] * a[k];
+    end;
+
+begin
+    for i := 1 to 10 do
+        a[i] := i - 5;
+    s := sum(10);
+    write(s);
+end.
\ No newline at end of file
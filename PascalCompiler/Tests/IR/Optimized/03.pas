@@ -0,0 +1,17 @@
+program test;
+var
+    s: integer;
+
+    function scale(a, b, n: integer): integer;
+    var
+        i: integer;
+    begin
+        result := 0;
+        for i := 1 to n do
+            result := result + a * b + i div (a - b);
+    end;
+
+begin
+    s := scale(7, 3, 10);
+    write(s);
+end.
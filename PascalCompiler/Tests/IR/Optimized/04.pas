@@ -0,0 +1,20 @@
+program test;
+var
+    a, b: array [1..4] of array [1..4] of real;
+
+    procedure transpose(n: integer);
+    var
+        i, j: integer;
+    begin
+        for i := 1 to n do
+            for j := 1 to n do
+                a[i][j] := i * j;
+        for i := 1 to n do
+            for j := 1 to n do
+                b[j][i] := a[i][j] * 2.0;
+    end;
+
+begin
+    transpose(4);
+    write(b[4][3]);
+end.
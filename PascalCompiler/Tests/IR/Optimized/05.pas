@@ -0,0 +1,16 @@
+program test;
+var
+    a: array [1..40] of integer;
+    i, s: integer;
+begin
+    for i := 1 to 3 do
+        a[i] := 0;
+    s := 0;
+    for i := 1 to 38 do
+    begin
+        if i = 20 then
+            break;
+        s := s + a[i];
+    end;
+    write(s);
+end.
@@ -0,0 +1,15 @@
+program test;
+var
+    a, b, c: array [1..100] of real;
+    x: array [1..100] of integer;
+    i, s: integer;
+    k: real;
+begin
+    k := 2;
+    for i := 1 to 100 do
+        c[i] := a[i] * b[i] + k;
+    s := 0;
+    for i := 1 to 100 do
+        s := s + x[i];
+    write(c[1], s);
+end.
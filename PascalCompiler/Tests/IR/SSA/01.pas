@@ -0,0 +1,16 @@
+program test;
+var
+    i, n, s, t: integer;
+    r: real;
+begin
+    n := 10;
+    s := 0;
+    t := n * 2;
+    for i := 1 to n do begin
+        s := s + i * 2;
+        if t > 100 then
+            s := s - 1;
+    end;
+    r := s * 0.5;
+    write(s, ' ', r, ' ', t);
+end.
\ No newline at end of file
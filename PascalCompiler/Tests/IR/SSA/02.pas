@@ -0,0 +1,15 @@
+program test;
+var
+    x, y: integer;
+begin
+    x := 1;
+    y := 5;
+    while y > 0 do begin
+        if y mod 2 = 0 then
+            x := x * 2
+        else
+            x := x + y;
+        y := y - 1;
+    end;
+    write(x);
+end.
\ No newline at end of file
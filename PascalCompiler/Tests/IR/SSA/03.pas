@@ -0,0 +1,17 @@
+program test;
+var
+    z, n: real;
+begin
+    z := 0.0;
+    n := z / z;
+    if n < 1.0 then
+        write('lt')
+    else
+        write('nlt');
+    if n <= 1.0 then
+        write('le')
+    else
+        write('nle');
+    if n <> n then
+        write('ne');
+end.
@@ -0,0 +1,15 @@
+program test;
+var
+    a, b: integer;
+    r: real;
+    c: char;
+begin
+    a := 10;
+    b := a * 2 + 1;
+    r := b / 4;
+    c := char(a + 55);
+    write(a, ' ', b, ' ', r, ' ', c);
+    a += 5;
+    b := a - b;
+    write(a, ' ', b);
+end.
@@ -0,0 +1,13 @@
+program test;
+const
+    n = 4;
+    primes: array [1..4] of integer = (2, 3, 5, 7);
+    scale: real = 2;
+    origin: record x: integer; y: integer; end = (x: 3; y: -4);
+var
+    s: integer;
+begin
+    s := primes[1] + primes[n];
+    write(s, ' ', primes[2] * scale, ' ', origin.x * origin.y);
+    write(n < 5, ' ', scale >= 2.5, ' ', -scale, ' ', not n);
+end.
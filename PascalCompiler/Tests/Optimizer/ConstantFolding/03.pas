@@ -0,0 +1,27 @@
+program test;
+var
+    i, s, k: integer;
+
+procedure change(var x: integer);
+begin
+    x := 100;
+end;
+
+begin
+    k := 3;
+    s := 0;
+    for i := 1 to k do
+        s := s + k;
+    write(s, ' ', k);
+    change(k);
+    write(k);
+    k := 7;
+    if k > 5 then
+        k := k + 1
+    else
+        k := 0;
+    write(k);
+    while k > 0 do
+        k := k - 3;
+    write(k);
+end.
@@ -0,0 +1,25 @@
+program test;
+var
+    z, n, d: real;
+    k: integer;
+begin
+    z := 0.0;
+    n := z / z;
+    if n = n then
+        write('eq')
+    else
+        write('neq');
+    if n <> 1.0 then
+        write('ne')
+    else
+        write('nne');
+    d := 1.0 / z;
+    if d > 1.0 then
+        write('gt')
+    else
+        write('ngt');
+    k := -17;
+    write(k shr 1);
+    k := k shr 28;
+    write(k, ' ', k shl 2);
+end.
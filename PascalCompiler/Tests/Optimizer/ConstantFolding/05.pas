@@ -0,0 +1,21 @@
+program test;
+var
+    x, y, m: integer;
+    r: real;
+begin
+    x := 100000;
+    r := x * x;
+    write(r, ' ');
+    y := 65536;
+    y := y * 65536;
+    write(y, ' ');
+    m := 2147483647;
+    m := m + 1;
+    write(m, ' ');
+    x := 100000;
+    x *= 100000;
+    write(x, ' ');
+    m := -2147483647;
+    m := m - 2;
+    write(m);
+end.
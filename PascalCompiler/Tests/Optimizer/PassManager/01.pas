@@ -0,0 +1,13 @@
+program test;
+var
+    n, m: integer;
+begin
+    n := 3;
+    m := n * 2;
+    if m > 5 then
+        write('big')
+    else
+        write('small');
+    if n < 0 then
+        write('never');
+end.
\ No newline at end of file
@@ -0,0 +1,12 @@
+program test;
+var
+    i, limit, unused: integer;
+begin
+    limit := 10;
+    unused := limit;
+    for i := limit div 2 to limit do
+    begin
+        write(i);
+        break;
+    end;
+end.
\ No newline at end of file
@@ -0,0 +1,12 @@
+program test;
+var
+    a: array [1..5] of integer;
+    i, s: integer;
+begin
+    s := 0;
+    for i := 1 to 5 do
+        a[i] := i * i;
+    for i := 1 to 5 do
+        s := s + a[i];
+    write(s);
+end.
@@ -0,0 +1,16 @@
+program test;
+var
+    x, y: real;
+    c: char;
+
+function scale(v: real; k: integer): real;
+begin
+    Result := v * k + 1.5;
+end;
+
+begin
+    c := 'a';
+    x := 2.25;
+    y := scale(x, 4) - 1;
+    write(c, ' ', x, ' ', y);
+end.
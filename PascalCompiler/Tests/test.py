@@ -27,7 +27,8 @@ def test(d):
     for i in listdir(d):
         name = r.match(i)
         if name:
-            subprocess.call(['../../x64/Debug/PascalCompiler.exe', '-' + args.argument, d + '/' + i, 'output.txt']) 
+            options = open(d + '/options').read().split() if os.path.exists(d + '/options') else []
+            subprocess.call(['../../x64/Debug/PascalCompiler.exe', '-' + args.argument, d + '/' + i, 'output.txt'] + options) 
             a, b = '', ''
             if args.check_output:
                 b = run()
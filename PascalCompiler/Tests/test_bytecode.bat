@@ -0,0 +1,2 @@
+py test.py Bytecode b
+PAUSE
\ No newline at end of file
@@ -0,0 +1,2 @@
+py test.py IR i
+PAUSE
\ No newline at end of file
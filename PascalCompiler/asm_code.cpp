@@ -2,42 +2,53 @@
 #include "tree.hpp"
 #include "boost/format.hpp"
 #include "type.hpp"
+#include "peephole.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <sstream>
 
 using namespace pascal_compiler;
 using namespace code;
 
-const std::string asm_reg::reg_type_str[] = { "eax", "ebx", "ecx", "edx", "xmm0", "xmm1", "esp", "ebp", "al", "cl", "ah", "bl", "ax" };
-const std::string asm_mem::mem_size_str[] = { "byte", "word", "dword", "qword" };
+const std::string asm_reg::reg_type_str[] = { "eax", "ebx", "ecx", "edx", "xmm0", "xmm1", "esp", "ebp", "al", "cl", "ah", "bl", "ax",
+    "esi", "edi", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "rsp", "rbp", "r8d", "r9d", "r10d", "r11d",
+    "r12d", "r13d", "r14d", "r15d", "xmm8", "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15" };
+const std::vector<asm_reg::reg_type> asm_code::integer_argument_registers = {
+    asm_reg::reg_type::esi, asm_reg::reg_type::edi
+};
+const std::vector<asm_reg::reg_type> asm_code::real_argument_registers = {
+    asm_reg::reg_type::xmm2, asm_reg::reg_type::xmm3, asm_reg::reg_type::xmm4,
+    asm_reg::reg_type::xmm5, asm_reg::reg_type::xmm6, asm_reg::reg_type::xmm7
+};
+// SSE registers are never preserved across calls
+const std::vector<asm_reg::reg_type> asm_code::caller_saved_registers = {
+    asm_reg::reg_type::eax, asm_reg::reg_type::ecx, asm_reg::reg_type::edx,
+    asm_reg::reg_type::ebx, asm_reg::reg_type::esi, asm_reg::reg_type::edi
+};
+const std::vector<asm_reg::reg_type> asm_code::callee_saved_registers = {
+    asm_reg::reg_type::esp, asm_reg::reg_type::ebp
+};
+const std::string asm_mem::mem_size_str[] = { "byte", "word", "dword", "qword", "xmmword" };
 const std::string asm_command::type_str[] = { 
     "mov", "push", "pop", "add", "sub", "imul", "idiv", "printf", "movsd", 
     "and", "or", "xor", "mulsd", "addsd", "divsd", "subsd", "neg", "pxor", 
     "not", "cdq", "movsx", "shl", "shr", "cvtsi2sd", "cvttsd2si",
     "setge", "setg", "setle", "setl", "sete", "setne", "cmp", "jmp", "", 
     "comisd", "ucomisd", "setbe", "setb", "seta", "setae", "jp", "jnp", "lahf", "test",
-    "loop", "jnz", "jz", "inc", "dec", "jge", "jle", "call", "lea", "leave", "ret"
+    "loop", "jnz", "jz", "inc", "dec", "jge", "jle", "call", "lea", "leave", "ret",
+    "jl", "jg", "jb", "jbe", "ja", "jae", "movupd", "movdqu", "addpd", "subpd", "mulpd", "divpd",
+    "paddd", "psubd", "unpcklpd", "unpckhpd", "pshufd", "movd", "enter"
 };
 
-asm_arg::type asm_arg::get_type() const {
-    return type_;
-}
-
-asm_mem::mem_size asm_mem::get_mem_size() const {
-    return size_;
-}
-
-std::string asm_mem::to_string() const {
-    return str(boost::format("%1% ptr [ebp - %2%]")
-        % mem_size_str[static_cast<unsigned char>(size_)]
-        % offset_);
-}
-
 std::string asm_code::add_double_constant(const double value) {
-    const std::unordered_map<double, std::string>::const_iterator it = double_const_.find(value);
+    const auto val = *reinterpret_cast<const uint64_t*>(&value);
+    const auto it = double_const_.find(val);
     if (it != double_const_.end())
-        return std::string("__real@") + it->second;
+        return std::string("__real@") + doubles_[it->second].second;
     std::string result;
     auto mask = uint64_t(15) << 60;
-    const auto val = *reinterpret_cast<const uint64_t*>(&value);
     for (auto i = 0; i < sizeof(value) * 2; ++i) {
         const unsigned char c = (val & mask) >> 60 - i * 4;
         result += c + (c < 10 ? 48 : 87);
@@ -45,7 +56,8 @@ std::string asm_code::add_double_constant(const double value) {
     }
     if (result[0] >= 97)
         result.insert(result.begin(), '0');
-    double_const_[value] = result;
+    double_const_[val] = doubles_.size();
+    doubles_.emplace_back(value, result);
     return std::string("__real@") + result;
 }
 
@@ -53,19 +65,20 @@ std::string asm_code::add_string_constant(const std::string& value) {
     const std::unordered_map<std::string, size_t>::const_iterator it = string_const_.find(value);
     if (it != string_const_.end())
         return std::string("__string@") + std::to_string(it->second);
-    string_const_[value] = strings_++;
-    return std::string("__string@") + std::to_string(string_const_[value]);
+    const auto id = strings_.size();
+    strings_.push_back(&string_const_.emplace(value, id).first->first);
+    return std::string("__string@") + std::to_string(id);
 }
 
-std::string asm_code::get_label_name(const size_t row, const size_t col, const std::string& suffix) {
-    return str(boost::format("$LN%1%AT%2%%3%@") % row % col % suffix);
+asm_label asm_code::new_label() {
+    return asm_label(labels_++);
 }
 
-void asm_code::add_loop_start(const std::string& value) {
+void asm_code::add_loop_start(const asm_label value) {
     loop_starts_.push(value);
 }
 
-void asm_code::add_loop_end(const std::string& value) {
+void asm_code::add_loop_end(const asm_label value) {
     loop_ends_.push(value);
 }
 
@@ -88,25 +101,85 @@ void asm_code::push_continue() {
 void asm_code::start_function(const std::string& name, const size_t row, const size_t col, const symbols_table& data_table, const symbols_table& param_table) {
     if (commands_.size() == 0)
         main_func_name_ = wrap_function_name(name, row, col);
-    const auto t = data_table.get_type("result");
-    if (!t->is_scalar())
-        temp_var_size_ = std::max(temp_var_size_, t->data_size());
     data_tables_.push_back(data_table);
     param_tables_.push_back(param_table);
+    frame_sizes_.push_back(0);
+    parameter_registers_.emplace_back();
     commands_.emplace_back(wrap_function_name(name, row, col), std::vector<asm_command>());
 }
 
 void asm_code::end_function() {
-    func_string_ += commands_.back().first + ":\n";
-    func_string_ += str(boost::format("enter %1%, %2%\n") % data_tables_.back().get_data_size() % commands_.size());
-    for (const auto com : commands_.back().second)
-        func_string_ += com.to_string() + '\n';
-    func_string_ += '\n';
+    if (peephole_optimizer_)
+        peephole_optimizer_->optimize(commands_.back().second);
+    const auto start = listing_.size();
+    listing_.emplace_back(asm_command::type::label, commands_.back().first);
+    listing_.emplace_back(asm_command::type::enter,
+        static_cast<long long>(data_tables_.back().get_data_size() + frame_sizes_.back()),
+        static_cast<long long>(commands_.size()));
+    listing_.insert(listing_.end(), commands_.back().second.begin(), commands_.back().second.end());
+    if (output_) {
+        if (!prologue_written_)
+            write_prologue(*output_);
+        prologue_written_ = true;
+        for (auto i = start; i < listing_.size(); ++i)
+            *output_ << format(listing_[i]) << '\n';
+        *output_ << '\n';
+        listing_.erase(listing_.begin() + start, listing_.end());
+    }
+    else {
+        for (auto i = start; i < listing_.size(); ++i)
+            func_string_ += format(listing_[i]) + '\n';
+        func_string_ += '\n';
+    }
     data_tables_.pop_back();
     param_tables_.pop_back();
+    frame_sizes_.pop_back();
+    parameter_registers_.pop_back();
     commands_.pop_back();
 }
 
+void asm_code::add_frame_size(const size_t size) {
+    frame_sizes_.back() += size;
+}
+
+long long asm_code::add_frame_slot(const size_t size) {
+    frame_sizes_.back() += size;
+    return slot_size() * static_cast<long long>(commands_.size()) + static_cast<long long>(frame_sizes_.back()) +
+        data_tables_.back().get_data_size();
+}
+
+void asm_code::set_peephole_optimizer(const std::shared_ptr<peephole_optimizer> optimizer) {
+    peephole_optimizer_ = optimizer;
+}
+
+void asm_code::set_short_circuit(const bool value) {
+    short_circuit_ = value;
+}
+
+bool asm_code::short_circuit() const {
+    return short_circuit_;
+}
+
+void asm_code::set_target(const target value) {
+    target_ = value;
+}
+
+asm_code::target asm_code::get_target() const {
+    return target_;
+}
+
+long long asm_code::slot_size() const {
+    return target_ == target::x86_64 ? 8 : 4;
+}
+
+asm_reg::reg_type asm_code::stack_pointer() const {
+    return target_ == target::x86_64 ? asm_reg::reg_type::rsp : asm_reg::reg_type::esp;
+}
+
+asm_reg::reg_type asm_code::frame_pointer() const {
+    return target_ == target::x86_64 ? asm_reg::reg_type::rbp : asm_reg::reg_type::ebp;
+}
+
 std::string asm_code::get_function_label(const std::string& name) const {
     for (auto i = commands_.size() - 1; i >= 0; --i) {
         const auto val = data_tables_[i].table().find(name);
@@ -125,104 +198,234 @@ type_p asm_code::get_current_function_result_type() const {
 }
 
 size_t asm_code::get_current_function_param_size() const {
-    return param_tables_.back().get_data_size();
+    const auto size = static_cast<size_t>(param_tables_.back().get_data_size());
+    const auto type = get_current_function_result_type();
+    return type->is_category(type::type_category::array) || type->is_category(type::type_category::record)
+        ? size + 4
+        : size;
+}
+
+long long asm_code::get_return_slot_offset() const {
+    const auto size = param_tables_.back().get_data_size();
+    return 2 * slot_size() + size + size % 4;
+}
+
+std::uint32_t asm_label::id() const {
+    return id_;
+}
+
+std::string asm_label::to_string() const {
+    return "$L" + std::to_string(id_);
+}
+
+asm_operand::asm_operand(const asm_reg::reg_type reg) : kind_(kind::reg) {
+    reg_ = reg;
+}
+
+asm_operand::asm_operand(const asm_reg::reg_type base, const asm_mem::mem_size size, const long long offset)
+    : kind_(kind::mem), size_(size) {
+    memory_ = { base, base, 0, static_cast<std::int32_t>(offset) };
+}
+
+asm_operand::asm_operand(const asm_reg::reg_type base, const asm_mem::mem_size size, const asm_reg::reg_type index,
+    const long long scale, const long long offset) : kind_(kind::mem), size_(size) {
+    memory_ = { base, index, static_cast<unsigned char>(scale), static_cast<std::int32_t>(offset) };
 }
 
-std::string asm_code::get_temp_var_name() { return "__temp@var"; }
+asm_operand::asm_operand(const long long value) : kind_(kind::imm) {
+    value_ = value;
+}
+
+asm_operand::asm_operand(const asm_label label) : kind_(kind::label) {
+    symbol_ = { label.id(), 0 };
+}
+
+asm_operand::asm_operand(const std::string& symbol) : kind_(kind::symbol) {
+    symbol_ = { intern(symbol), 0 };
+}
+
+asm_operand::asm_operand(const asm_mem::mem_size size, const std::string& constant, const long long offset)
+    : kind_(kind::constant), size_(size) {
+    symbol_ = { intern(constant), static_cast<std::int32_t>(offset) };
+}
+
+asm_operand asm_operand::address(const std::string& name) {
+    asm_operand result(name);
+    result.kind_ = kind::address;
+    return result;
+}
+
+asm_operand::kind asm_operand::get_kind() const {
+    return kind_;
+}
 
-asm_reg::reg_type asm_reg::get_reg_type() const {
-    return reg_;
+bool asm_operand::is_memory() const {
+    return kind_ == kind::mem || kind_ == kind::constant;
 }
 
-std::string asm_reg::to_string() const {
-    if (typed_) {
-        if (offset_ != 0)
-            return str(boost::format("%1% ptr [%2% %4% %3%]")
-                % asm_mem::mem_size_str[static_cast<unsigned char>(size_)]
-                % reg_type_str[static_cast<unsigned char>(reg_)]
-                % abs(offset_) % (offset_ > 0 ? '+' : '-')
-            );
-        return str(boost::format("%1% ptr [%2%]")
-            % asm_mem::mem_size_str[static_cast<unsigned char>(size_)]
-            % reg_type_str[static_cast<unsigned char>(reg_)]
-        );
+asm_reg::reg_type asm_operand::get_reg_type() const {
+    return kind_ == kind::reg ? reg_ : memory_.base;
+}
+
+asm_mem::mem_size asm_operand::get_mem_size() const {
+    return size_;
+}
+
+bool asm_operand::has_index() const {
+    return kind_ == kind::mem && memory_.scale != 0;
+}
+
+asm_reg::reg_type asm_operand::get_index() const {
+    return memory_.index;
+}
+
+long long asm_operand::get_scale() const {
+    return memory_.scale;
+}
+
+long long asm_operand::get_offset() const {
+    return kind_ == kind::mem ? memory_.offset : symbol_.offset;
+}
+
+long long asm_operand::get_value() const {
+    return value_;
+}
+
+std::uint32_t asm_operand::get_symbol() const {
+    return symbol_.id;
+}
+
+const std::string& asm_operand::get_name() const {
+    return symbol_name(symbol_.id);
+}
+
+std::string asm_operand::to_string() const {
+    switch (kind_) {
+    case kind::reg:
+        return asm_reg::reg_type_str[static_cast<unsigned char>(reg_)];
+    case kind::mem:
+    {
+        auto base = asm_reg::reg_type_str[static_cast<unsigned char>(memory_.base)];
+        if (has_index()) {
+            base += " + " + asm_reg::reg_type_str[static_cast<unsigned char>(memory_.index)];
+            if (memory_.scale != 1)
+                base += '*' + std::to_string(memory_.scale);
+        }
+        return memory_to_string(size_, base, memory_.offset);
     }
-    return reg_type_str[static_cast<unsigned char>(reg_)];
-}
-
-std::string asm_imm::to_string() const {
-    if (offset_ != -1) {
-        if (offset_ > 0)
-            return str(boost::format("%1% ptr [%2% + %3%]")
-                % asm_mem::mem_size_str[static_cast<unsigned char>(size_)]
-                % value_ % offset_);
-        return str(boost::format("%1% ptr [%2%]")
-            % asm_mem::mem_size_str[static_cast<unsigned char>(size_)]
-            % value_);
+    case kind::imm:
+        return std::to_string(value_);
+    case kind::label:
+        return asm_label(symbol_.id).to_string();
+    case kind::symbol:
+        return get_name();
+    case kind::constant:
+        return memory_to_string(size_, get_name(), symbol_.offset);
+    case kind::address:
+        return "offset " + get_name();
+    default:
+        throw std::logic_error("This point should never be reached");
     }
-    return value_;
 }
 
-asm_command::asm_command(const type type, const asm_mem& arg1, const asm_mem& arg2) : type_(type) {
-    add(std::make_shared<asm_mem>(arg1), std::make_shared<asm_mem>(arg2));
+bool asm_operand::operator==(const asm_operand& other) const {
+    if (kind_ != other.kind_)
+        return false;
+    switch (kind_) {
+    case kind::reg:
+        return reg_ == other.reg_;
+    case kind::mem:
+        return size_ == other.size_ && memory_.base == other.memory_.base && memory_.scale == other.memory_.scale &&
+            (memory_.scale == 0 || memory_.index == other.memory_.index) && memory_.offset == other.memory_.offset;
+    case kind::imm:
+        return value_ == other.value_;
+    case kind::constant:
+        return size_ == other.size_ && symbol_.id == other.symbol_.id && symbol_.offset == other.symbol_.offset;
+    case kind::label:
+    case kind::symbol:
+    case kind::address:
+        return symbol_.id == other.symbol_.id;
+    default:
+        return true;
+    }
+}
+
+bool asm_operand::operator!=(const asm_operand& other) const {
+    return !(*this == other);
+}
+
+struct asm_operand::symbol_pool {
+    std::mutex mutex;
+    std::deque<std::string> names;
+    std::unordered_map<std::string, std::uint32_t> ids;
+};
+
+std::uint32_t asm_operand::intern(const std::string& name) {
+    auto& pool = symbols();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    const auto it = pool.ids.find(name);
+    if (it != pool.ids.end())
+        return it->second;
+    pool.names.push_back(name);
+    return pool.ids[name] = static_cast<std::uint32_t>(pool.names.size() - 1);
 }
 
-asm_command::asm_command(const type type, const asm_reg& arg1, const asm_mem& arg2) : type_(type) {
-    add(std::make_shared<asm_reg>(arg1), std::make_shared<asm_mem>(arg2));
+const std::string& asm_operand::symbol_name(const std::uint32_t id) {
+    auto& pool = symbols();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.names[id];
 }
 
-asm_command::asm_command(const type type, const asm_mem& arg1, const asm_reg& arg2) : type_(type) {
-    add(std::make_shared<asm_mem>(arg1), std::make_shared<asm_reg>(arg2));
+asm_operand::symbol_pool& asm_operand::symbols() {
+    static symbol_pool pool;
+    return pool;
 }
 
-asm_command::asm_command(const type type, const asm_reg& arg1, const asm_reg& arg2) : type_(type) {
-    add(std::make_shared<asm_reg>(arg1), std::make_shared<asm_reg>(arg2));
+std::string asm_operand::memory_to_string(const asm_mem::mem_size size, const std::string& address, const long long offset) {
+    if (offset != 0)
+        return str(boost::format("%1% ptr [%2% %4% %3%]")
+            % asm_mem::mem_size_str[static_cast<unsigned char>(size)]
+            % address % std::abs(offset) % (offset > 0 ? '+' : '-'));
+    return str(boost::format("%1% ptr [%2%]") % asm_mem::mem_size_str[static_cast<unsigned char>(size)] % address);
 }
 
-asm_command::asm_command(const type type, const asm_mem& arg1, const asm_imm& arg2) : type_(type) {
-    add(std::make_shared<asm_mem>(arg1), std::make_shared<asm_imm>(arg2));
+asm_command::asm_command(const type type, const asm_operand& arg) : type_(type), count_(1) {
+    args_[0] = arg;
 }
 
-asm_command::asm_command(const type type, const asm_reg& arg1, const asm_imm& arg2) : type_(type) {
-    add(std::make_shared<asm_reg>(arg1), std::make_shared<asm_imm>(arg2));
+asm_command::asm_command(const type type, const asm_operand& arg1, const asm_operand& arg2) : type_(type), count_(2) {
+    args_[0] = arg1;
+    args_[1] = arg2;
 }
 
-asm_command::asm_command(const type type, const asm_mem& arg) : type_(type) {
-    add(std::make_shared<asm_mem>(arg));
+asm_command::asm_command(const type type, const asm_operand& arg1, const asm_operand& arg2, const asm_operand& arg3)
+    : type_(type), count_(3) {
+    args_[0] = arg1;
+    args_[1] = arg2;
+    args_[2] = arg3;
 }
 
-asm_command::asm_command(const type type, const asm_reg& arg) : type_(type) {
-    add(std::make_shared<asm_reg>(arg));
+asm_command::type asm_command::get_type() const {
+    return type_;
 }
 
-asm_command::asm_command(const type type, const asm_imm& arg) : type_(type) {
-    add(std::make_shared<asm_imm>(arg));
+size_t asm_command::args_count() const {
+    return count_;
 }
 
-asm_command::asm_command(const type type, const std::vector<std::shared_ptr<asm_arg>>& args) : type_(type) {
-    for (const auto& it : args)
-        args_.push_back(it);
+const asm_operand& asm_command::arg(const size_t i) const {
+    return args_[i];
 }
 
 std::string asm_command::to_string() const {
     if (type_ == type::label)
-        return args_[0]->to_string() + ':';
+        return args_[0].to_string() + ':';
     auto result = type_str[static_cast<unsigned char>(type_)] + ' ';
-    if (args_.size() > 0) {
-        result += args_[0]->to_string();
-        for (auto i = 1; i < args_.size(); ++i)
-            result += std::string(", ") + args_[i]->to_string();
-    }
+    for (size_t i = 0; i < count_; ++i)
+        result += (i ? ", " : "") + args_[i].to_string();
     return result;
 }
 
-void asm_command::add(const std::shared_ptr<asm_arg> arg1, const std::shared_ptr<asm_arg> arg2) {
-    args_.push_back(arg1);
-    args_.push_back(arg2);
-}
-
-void asm_command::add(const std::shared_ptr<asm_arg> arg1) { args_.push_back(arg1); }
-
 void asm_code::push_back(const asm_command& command) {
     commands_.back().second.push_back(command);
 }
@@ -231,42 +434,200 @@ void asm_code::push_back(asm_command&& command) {
     commands_.back().second.push_back(std::move(command));
 }
 
+void asm_code::add_block_copy(const asm_reg::reg_type source, const asm_reg::reg_type destination,
+    const size_t size, const asm_label label) {
+    size_t offset = 0;
+    if (size > max_unrolled_copy) {
+        offset = size / 16 * 16;
+        push_back({ asm_command::type::xor, asm_reg::reg_type::ecx, asm_reg::reg_type::ecx });
+        push_back({ asm_command::type::label, label });
+        push_back({ asm_command::type::movdqu, asm_reg::reg_type::xmm0,
+            { source, asm_mem::mem_size::xmmword, asm_reg::reg_type::ecx, 1 } });
+        push_back({ asm_command::type::movdqu, { destination, asm_mem::mem_size::xmmword, asm_reg::reg_type::ecx, 1 },
+            asm_reg::reg_type::xmm0 });
+        push_back({ asm_command::type::add, asm_reg::reg_type::ecx, 16 });
+        push_back({ asm_command::type::cmp, asm_reg::reg_type::ecx, static_cast<int>(offset) });
+        push_back({ asm_command::type::jl, label });
+    }
+    for (; offset + 16 <= size; offset += 16) {
+        push_back({ asm_command::type::movdqu, asm_reg::reg_type::xmm0,
+            { source, asm_mem::mem_size::xmmword, static_cast<long long>(offset) } });
+        push_back({ asm_command::type::movdqu, { destination, asm_mem::mem_size::xmmword, static_cast<long long>(offset) },
+            asm_reg::reg_type::xmm0 });
+    }
+    if (offset + 8 <= size) {
+        push_back({ asm_command::type::movsd, asm_reg::reg_type::xmm0,
+            { source, asm_mem::mem_size::qword, static_cast<long long>(offset) } });
+        push_back({ asm_command::type::movsd, { destination, asm_mem::mem_size::qword, static_cast<long long>(offset) },
+            asm_reg::reg_type::xmm0 });
+        offset += 8;
+    }
+    if (offset + 4 <= size) {
+        push_back({ asm_command::type::movd, asm_reg::reg_type::xmm0,
+            { source, asm_mem::mem_size::dword, static_cast<long long>(offset) } });
+        push_back({ asm_command::type::movd, { destination, asm_mem::mem_size::dword, static_cast<long long>(offset) },
+            asm_reg::reg_type::xmm0 });
+    }
+}
+
+void asm_code::set_output(std::ostream& out) {
+    output_ = &out;
+}
+
+void asm_code::end_program() {
+    if (!prologue_written_)
+        write_prologue(*output_);
+    prologue_written_ = true;
+    write_epilogue(*output_);
+    output_->flush();
+}
+
 std::string asm_code::to_string() const {
-    std::string result = "include c:\\masm32\\include\\masm32rt.inc\n.xmm\n.const\n";
-    for (const auto& it : double_const_)
-        result += str(boost::format("__real\@%1% dq %1%r ;%2%\n") % it.second % it.first);
-    for (const auto& it : string_const_) {
-        result += "__string@";
-        result += std::to_string(it.second);
-        for (size_t i = 0; i <= it.first.size() / 32; ++i) {
-            result += " db ";
-            size_t j = i * 32;
-            for (; j < std::min(32 * (i + 1), it.first.size()); ++j)
-                result += std::to_string(int(it.first[j])) + ",";
-            if (j == it.first.size())
-                result += "0\n";
-            else {
-                result[result.size() - 1] = '\n';
-            }
+    std::ostringstream result;
+    write_prologue(result);
+    result << func_string_;
+    write_epilogue(result);
+    return result.str();
+}
+
+void asm_code::write_prologue(std::ostream& out) const {
+    if (target_ == target::x86_64)
+        out << ".intel_syntax noprefix\n.text\n";
+    else
+        out << "include c:\\masm32\\include\\masm32rt.inc\n.xmm\n.code\n";
+}
+
+void asm_code::write_epilogue(std::ostream& out) const {
+    if (target_ == target::x86_64)
+        write_gas_epilogue(out);
+    else
+        write_masm_epilogue(out);
+}
+
+void asm_code::write_masm_epilogue(std::ostream& out) const {
+    out << "start:\n" << boost::format("call %1%\n") % main_func_name_ << "exit\n.const\n";
+    for (const auto& it : doubles_)
+        out << boost::format("__real\@%1% dq %1%r ;%2%\n") % it.second % it.first;
+    for (size_t k = 0; k < strings_.size(); ++k) {
+        const auto& value = *strings_[k];
+        out << "__string@" << k;
+        for (size_t i = 0; i <= value.size() / 32; ++i) {
+            const auto end = std::min(32 * (i + 1), value.size());
+            out << " db ";
+            for (auto j = i * 32; j < end; ++j)
+                out << int(value[j]) << (j + 1 < end || end == value.size() ? "," : "\n");
+            if (end == value.size())
+                out << "0\n";
         }
     }
-    if (temp_var_size_)
-        result += std::string(".data\n") + get_temp_var_name() + " byte " + std::to_string(temp_var_size_) + " dup (?) \n";
-    result += ".code\n";
-    result += func_string_;
-    result += "start:\n";
-    result += str(boost::format("call %1%\n") % main_func_name_);
-    return result + "exit\nend start";    
+    out << "end start";
+}
+
+void asm_code::write_gas_epilogue(std::ostream& out) const {
+    out << ".globl main\nmain:\npush rbp\npush rbx\npush r12\npush r13\npush r14\npush r15\n";
+    out << "mov qword ptr [rip + __stack_pointer], rsp\n";
+    out << boost::format("lea rsp, [rip + __stack + %1%]\n") % std::to_string(x86_64_stack_size);
+    out << boost::format("call %1%\n") % to_gas_name(main_func_name_);
+    out << "mov rsp, qword ptr [rip + __stack_pointer]\n";
+    out << "pop r15\npop r14\npop r13\npop r12\npop rbx\npop rbp\nxor eax, eax\nret\n";
+    out << ".section .rodata\n";
+    for (const auto& it : doubles_)
+        out << boost::format("__real_%1%: .quad 0x%1%\n") % it.second;
+    for (size_t i = 0; i < strings_.size(); ++i) {
+        out << "__string_" << i << ": .byte ";
+        for (const auto c : *strings_[i])
+            out << int(c) << ',';
+        out << "0\n";
+    }
+    out << boost::format(".bss\n.align 16\n__stack: .zero %1%\n__stack_pointer: .zero 8\n") % std::to_string(x86_64_stack_size);
+    out << ".section .note.GNU-stack,\"\",@progbits\n";
+}
+
+std::string asm_code::format(const asm_command& command) const {
+    auto result = command.to_string();
+    if (target_ == target::x86)
+        return result;
+    const auto constant = result.find("[__real@");
+    if (constant != std::string::npos)
+        result.insert(constant + 1, "rip + ");
+    return to_gas_name(result);
+}
+
+std::string asm_code::to_gas_name(const std::string& name) {
+    std::string result;
+    for (const auto c : name)
+        if (c == '$')
+            result += ".L";
+        else
+            result += c == '@' ? '_' : c;
+    return result;
 }
 
 std::pair<long long, long long> asm_code::get_offset(const std::string& name) const {
     for (auto i = commands_.size() - 1; i >= 0; --i) {
         auto val = data_tables_[i].table().find(name);
         if (val != data_tables_[i].table().end())
-            return std::make_pair((i + 1) * -4, data_tables_[i].get_offset(name) + 4 * (i + 1));
+            return std::make_pair((i + 1) * -slot_size(), data_tables_[i].get_offset(name) + slot_size() * (i + 1));
         val = param_tables_[i].table().find(name);
         if (val != param_tables_[i].table().end())
-            return std::make_pair((i + 1) * -4, +param_tables_[i].get_offset(name) - 8 - param_tables_[i].get_data_size());
+            return std::make_pair((i + 1) * -slot_size(),
+                +param_tables_[i].get_offset(name) - 2 * slot_size() - param_tables_[i].get_data_size());
     }
     throw std::logic_error("This point should never be reached");
 }
+
+bool asm_code::is_reference(const std::string& name) const {
+    for (auto i = commands_.size() - 1; i >= 0; --i) {
+        if (data_tables_[i].table().find(name) != data_tables_[i].table().end())
+            return false;
+        const auto val = param_tables_[i].table().find(name);
+        if (val != param_tables_[i].table().end())
+            return val->second.first->is_category(type::type_category::modified) &&
+                std::dynamic_pointer_cast<modified_type>(val->second.first)->is_reference();
+    }
+    throw std::logic_error("This point should never be reached");
+}
+
+bool asm_code::is_local(const std::string& name) const {
+    const auto& data = data_tables_.back().table();
+    const auto& params = param_tables_.back().table();
+    return data.find(name) != data.end() || params.find(name) != params.end();
+}
+
+void asm_code::assign_parameter_registers(const bool leaf) {
+    for (const auto& it : get_parameter_registers(param_tables_.back())) {
+        if (leaf) {
+            parameter_registers_.back().insert(it);
+            continue;
+        }
+        const auto is_real = std::find(real_argument_registers.begin(), real_argument_registers.end(), it.second) !=
+            real_argument_registers.end();
+        push_back({ is_real ? asm_command::type::movsd : asm_command::type::mov,
+            { asm_reg::reg_type::ebp, is_real ? asm_mem::mem_size::qword : asm_mem::mem_size::dword, -get_offset(it.first).second },
+            it.second });
+    }
+}
+
+bool asm_code::get_parameter_register(const std::string& name, asm_reg::reg_type& reg) const {
+    const auto it = parameter_registers_.back().find(name);
+    if (it == parameter_registers_.back().end())
+        return false;
+    reg = it->second;
+    return true;
+}
+
+std::vector<std::pair<std::string, asm_reg::reg_type>> asm_code::get_parameter_registers(const symbols_table& parameters) {
+    std::vector<std::pair<std::string, asm_reg::reg_type>> result;
+    size_t integers = 0, reals = 0;
+    for (const auto& it : parameters.vector()) {
+        const auto& t = it.second.first;
+        const auto is_reference = t->is_category(type::type_category::modified) &&
+            std::dynamic_pointer_cast<modified_type>(t)->is_reference();
+        const auto category = base_type(t)->category();
+        if ((is_reference || category == type::type_category::integer) && integers < integer_argument_registers.size())
+            result.emplace_back(it.first, integer_argument_registers[integers++]);
+        else if (!is_reference && category == type::type_category::real && reals < real_argument_registers.size())
+            result.emplace_back(it.first, real_argument_registers[reals++]);
+    }
+    return result;
+}
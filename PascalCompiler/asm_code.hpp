@@ -1,5 +1,7 @@
 #pragma once
 #include "symbols_table.hpp"
+#include <cstdint>
+#include <ostream>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -14,94 +16,112 @@ namespace pascal_compiler {
     // ReSharper disable CppNonExplicitConversionOperator
     namespace code {
 
-        class asm_arg {
-            
-        public:
+        class asm_mem {
 
-            virtual ~asm_arg() = default;
+        public:
 
-            enum class type : unsigned char {
-                reg, mem, imm, label
+            enum class mem_size : unsigned char {
+                byte, word, dword, qword, xmmword
             };
-            
-            virtual std::string to_string() const = 0;
-
-        protected:
 
-            explicit asm_arg(const type type) : type_(type) {}
-            type get_type() const;
-           
-        private:
+            static const std::string mem_size_str[];
 
-            type type_;
-        
         };
 
-        class asm_mem : public asm_arg {
+        class asm_reg {
 
         public:
 
-            enum class mem_size {
-                byte, word, dword, qword
+            enum class reg_type : unsigned char {
+                eax, ebx, ecx, edx, xmm0, xmm1, esp, ebp, al, cl, ah, bl, ax,
+                esi, edi, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7,
+                rsp, rbp, r8d, r9d, r10d, r11d, r12d, r13d, r14d, r15d,
+                xmm8, xmm9, xmm10, xmm11, xmm12, xmm13, xmm14, xmm15
             };
 
-            static const std::string mem_size_str[];
-
-            asm_mem(const mem_size size, const size_t offset) :
-                asm_arg(type::mem), offset_(offset), size_(size) {}
-
-            mem_size get_mem_size() const;
-            std::string to_string() const override;
-
-        private:
+            static const std::string reg_type_str[];
 
-            size_t offset_;
-            mem_size size_;
-          
         };
 
-        class asm_reg : public asm_arg {
+        class asm_label {
 
         public:
 
-            enum class reg_type {
-                eax, ebx, ecx, edx, xmm0, xmm1, esp, ebp, al, cl, ah, bl, ax
-            };
+            explicit asm_label(const std::uint32_t id) : id_(id) {}
 
-            asm_reg(const reg_type reg) : asm_arg(type::reg), reg_(reg) {}
-            asm_reg(const reg_type reg, const asm_mem::mem_size size, const long long offset = 0) 
-                : asm_arg(type::reg), reg_(reg), typed_(true), size_(size), offset_(offset) {}
-            reg_type get_reg_type() const;
-            std::string to_string() const override;
+            std::uint32_t id() const;
+            std::string to_string() const;
 
         private:
 
-            reg_type reg_;
-            bool typed_ = false;
-            const asm_mem::mem_size size_ = asm_mem::mem_size::dword;
-            const long long offset_ = 0;
-            static const std::string reg_type_str[];
+            std::uint32_t id_;
 
         };
 
-        class asm_imm : public asm_arg {
-            
+        class asm_operand {
+
         public:
 
-            asm_imm(const std::string value) : asm_arg(type::imm), value_(value) {}
-            asm_imm(const std::string value1, const std::string value2) : asm_arg(type::imm), value_(value1 + ' ' + value2) {}
-            asm_imm(const int value) : asm_arg(type::imm), value_(std::to_string(value)) {}
+            enum class kind : unsigned char {
+                none, reg, mem, imm, label, symbol, constant, address
+            };
 
-            asm_imm(const asm_mem::mem_size size, const std::string value, const long offset)
-                : asm_arg(type::imm), value_(value), offset_(offset), size_(size) {}
+            asm_operand() = default;
+            asm_operand(const asm_reg::reg_type reg);
+            asm_operand(const asm_reg::reg_type base, const asm_mem::mem_size size, const long long offset = 0);
+            asm_operand(const asm_reg::reg_type base, const asm_mem::mem_size size, const asm_reg::reg_type index,
+                const long long scale, const long long offset = 0);
+            asm_operand(const long long value);
+            asm_operand(const asm_label label);
+            asm_operand(const std::string& symbol);
+            asm_operand(const asm_mem::mem_size size, const std::string& constant, const long long offset);
+            static asm_operand address(const std::string& name);
+
+            kind get_kind() const;
+            bool is_memory() const;
+            asm_reg::reg_type get_reg_type() const;
+            asm_mem::mem_size get_mem_size() const;
+            bool has_index() const;
+            asm_reg::reg_type get_index() const;
+            long long get_scale() const;
+            long long get_offset() const;
+            long long get_value() const;
+            std::uint32_t get_symbol() const;
+            const std::string& get_name() const;
+            std::string to_string() const;
+            bool operator==(const asm_operand& other) const;
+            bool operator!=(const asm_operand& other) const;
 
-            std::string to_string() const override;
+            static std::uint32_t intern(const std::string& name);
+            static const std::string& symbol_name(const std::uint32_t id);
 
         private:
 
-            std::string value_;
-            long offset_ = -1;
+            struct memory_t {
+                asm_reg::reg_type base;
+                asm_reg::reg_type index;
+                unsigned char scale;
+                std::int32_t offset;
+            };
+
+            struct symbol_t {
+                std::uint32_t id;
+                std::int32_t offset;
+            };
+
+            kind kind_ = kind::none;
             asm_mem::mem_size size_ = asm_mem::mem_size::dword;
+            union {
+                asm_reg::reg_type reg_;
+                memory_t memory_;
+                symbol_t symbol_;
+                long long value_ = 0;
+            };
+
+            struct symbol_pool;
+
+            static symbol_pool& symbols();
+            static std::string memory_to_string(const asm_mem::mem_size size, const std::string& address, const long long offset);
 
         };
 
@@ -109,7 +129,7 @@ namespace pascal_compiler {
             
         public:
 
-            enum class type {
+            enum class type : unsigned char {
                 mov, push, pop, add, sub, imul, idiv, printf, movsd, 
                 and, or, xor, mulsd, addsd, divsd, subsd, neg, pxor, 
                 not, cdq, movsx, shl, shr,
@@ -118,74 +138,121 @@ namespace pascal_compiler {
                 // ReSharper restore CppInconsistentNaming
                 setge, setg, setle, setl, sete, setne, cmp, jmp, label, 
                 comisd, ucomisd, setbe, setb, seta, setae, jp, jnp, lahf, test,
-                loop, jnz, jz, inc, dec, jge, jle, call, lea, leave, ret
+                loop, jnz, jz, inc, dec, jge, jle, call, lea, leave, ret,
+                jl, jg, jb, jbe, ja, jae, movupd, movdqu, addpd, subpd, mulpd, divpd,
+                paddd, psubd, unpcklpd, unpckhpd, pshufd, movd, enter
             };
 
-            asm_command(const type type, const asm_mem& arg1, const asm_mem& arg2);
-            asm_command(const type type, const asm_reg& arg1, const asm_mem& arg2);
-            asm_command(const type type, const asm_mem& arg1, const asm_reg& arg2);
-            asm_command(const type type, const asm_reg& arg1, const asm_reg& arg2);
-            asm_command(const type type, const asm_mem& arg1, const asm_imm& arg2);
-            asm_command(const type type, const asm_reg& arg1, const asm_imm& arg2);
-            asm_command(const type type, const asm_mem& arg);
-            asm_command(const type type, const asm_reg& arg);
-            asm_command(const type type, const asm_imm& arg);
-            asm_command(const type type, const std::vector<std::shared_ptr<asm_arg>>& args);
             asm_command(const type type) : type_(type) {}
+            asm_command(const type type, const asm_operand& arg);
+            asm_command(const type type, const asm_operand& arg1, const asm_operand& arg2);
+            asm_command(const type type, const asm_operand& arg1, const asm_operand& arg2, const asm_operand& arg3);
+            type get_type() const;
+            size_t args_count() const;
+            const asm_operand& arg(const size_t i) const;
             std::string to_string() const;
 
         private:
 
-            void add(const std::shared_ptr<asm_arg> arg1, const std::shared_ptr<asm_arg> arg2);
-            void add(const std::shared_ptr<asm_arg> arg1);
-
+            static const size_t max_args = 3;
             static const std::string type_str[];
-            std::vector<std::shared_ptr<asm_arg>> args_;
-            type type_;
 
+            type type_;
+            unsigned char count_ = 0;
+            asm_operand args_[max_args];
             
         };
 
+        class peephole_optimizer;
+        class encoder;
+
         class asm_code {
 
         public:
 
+            enum class target {
+                x86, x86_64
+            };
+
             asm_code() {}
 
             void push_back(const asm_command& command);
             void push_back(asm_command&& command);
+            void add_block_copy(const asm_reg::reg_type source, const asm_reg::reg_type destination,
+                const size_t size, const asm_label label);
             std::string to_string() const;
+            void set_output(std::ostream& out);
+            void end_program();
             std::pair<long long, long long> get_offset(const std::string& name) const;
+            bool is_reference(const std::string& name) const;
+            bool is_local(const std::string& name) const;
+            void assign_parameter_registers(const bool leaf);
+            bool get_parameter_register(const std::string& name, asm_reg::reg_type& reg) const;
             std::string add_double_constant(const double  value);
             std::string add_string_constant(const std::string& value);
-            static std::string get_label_name(const size_t row, const size_t col, const std::string& suffix);
-            void add_loop_start(const std::string& value);
-            void add_loop_end(const std::string& value);
+            asm_label new_label();
+            void add_loop_start(const asm_label value);
+            void add_loop_end(const asm_label value);
             void pop_loop_start();
             void pop_loop_end();
             void push_break();
             void push_continue();
             void start_function(const std::string& name, const size_t row, const size_t col, const symbols_table& data_table, const symbols_table& param_table);
             void end_function();
+            void add_frame_size(const size_t size);
+            long long add_frame_slot(const size_t size);
+            void set_peephole_optimizer(const std::shared_ptr<peephole_optimizer> optimizer);
+            void set_short_circuit(const bool value);
+            bool short_circuit() const;
+            void set_target(const target value);
+            target get_target() const;
+            long long slot_size() const;
+            asm_reg::reg_type stack_pointer() const;
+            asm_reg::reg_type frame_pointer() const;
             std::string get_function_label(const std::string&) const;
             static std::string wrap_function_name(const std::string& name, const size_t row, const size_t col);
             type_p get_current_function_result_type() const;
             size_t get_current_function_param_size() const;
-            static std::string get_temp_var_name();
+            long long get_return_slot_offset() const;
+            static std::string to_gas_name(const std::string& name);
+            static std::vector<std::pair<std::string, asm_reg::reg_type>> get_parameter_registers(const symbols_table& parameters);
+
+            static const std::vector<asm_reg::reg_type> integer_argument_registers, real_argument_registers,
+                caller_saved_registers, callee_saved_registers;
 
         private:
 
+            static const size_t max_unrolled_copy = 64;
+            static const size_t x86_64_stack_size = 8 << 20;
+
+            void write_prologue(std::ostream& out) const;
+            void write_epilogue(std::ostream& out) const;
+            void write_masm_epilogue(std::ostream& out) const;
+            void write_gas_epilogue(std::ostream& out) const;
+            std::string format(const asm_command& command) const;
+
             std::vector<std::pair<std::string, std::vector<asm_command>>> commands_;
+            std::vector<asm_command> listing_;
             std::vector<symbols_table> data_tables_, param_tables_;
+            std::vector<size_t> frame_sizes_;
+            std::vector<std::unordered_map<std::string, asm_reg::reg_type>> parameter_registers_;
             std::string main_func_name_;
             static const std::string data_types_str[];
-            std::unordered_map<double, std::string> double_const_;
+            std::unordered_map<std::uint64_t, size_t> double_const_;
+            std::vector<std::pair<double, std::string>> doubles_;
             std::unordered_map<std::string, size_t> string_const_;
-            size_t strings_ = 0;
-            std::stack<std::string> loop_ends_;
-            std::stack<std::string> loop_starts_;
+            std::vector<const std::string*> strings_;
+            std::uint32_t labels_ = 0;
+            std::stack<asm_label> loop_ends_;
+            std::stack<asm_label> loop_starts_;
             std::string func_string_ = "";
-            size_t temp_var_size_ = 0;
+            std::ostream* output_ = nullptr;
+            bool prologue_written_ = false;
+            std::shared_ptr<peephole_optimizer> peephole_optimizer_;
+            bool short_circuit_ = false;
+            target target_ = target::x86;
+
+            friend class encoder;
 
         };
        
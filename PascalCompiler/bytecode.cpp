@@ -0,0 +1,117 @@
+#include "bytecode.hpp"
+#include "boost/format.hpp"
+#include <stdexcept>
+
+using namespace pascal_compiler;
+using namespace bytecode;
+
+const std::string program::opcode_str[] = {
+    "mov", "add_int", "sub_int", "mul_int", "div_int", "mod_int", "and_int", "or_int", "xor_int", "shl_int", "shr_int",
+    "neg_int", "not_int", "add_real", "sub_real", "mul_real", "div_real", "neg_real",
+    "eq_int", "ne_int", "lt_int", "le_int", "gt_int", "ge_int", "eq_real", "ne_real", "lt_real", "le_real", "gt_real", "ge_real",
+    "int_to_real", "real_to_int", "int_to_char", "address_local", "address_outer",
+    "load_local_int", "load_local_char", "load_local_real", "store_local_int", "store_local_char", "store_local_real",
+    "load_int", "load_char", "load_real", "store_int", "store_char", "store_real", "copy",
+    "push_int", "push_char", "push_real", "push_block", "call", "ret", "ret_int", "ret_real", "ret_block",
+    "jump", "jump_if", "jump_unless", "jump_back", "jump_back_if", "jump_back_unless",
+    "write_int", "write_char", "write_real", "write_string", "write_line"
+};
+
+static const std::string operands_str[] = {
+    "ab", "abc", "abc", "abc", "abc", "abc", "abc", "abc", "abc", "abc", "abc",
+    "ab", "ab", "abc", "abc", "abc", "abc", "ab",
+    "abc", "abc", "abc", "abc", "abc", "abc", "abc", "abc", "abc", "abc", "abc", "abc",
+    "ab", "ab", "ab", "av", "abv",
+    "av", "av", "av", "av", "av", "av",
+    "ab", "ab", "ab", "ab", "ab", "ab", "abv",
+    "a", "a", "a", "av", "av", "", "a", "a", "a",
+    "v", "av", "av", "v", "av", "av", "a", "a", "a", "a", ""
+};
+
+size_t program::add_function(const function& function) {
+    functions_.push_back(function);
+    return functions_.size() - 1;
+}
+
+const function& program::get_function(const size_t id) const {
+    return functions_[id];
+}
+
+function& program::get_function(const size_t id) {
+    return functions_[id];
+}
+
+const std::vector<function>& program::functions() const {
+    return functions_;
+}
+
+std::int32_t program::add_string(const std::string& value) {
+    const auto result = static_cast<std::int32_t>(data_.size());
+    data_.insert(data_.end(), value.begin(), value.end());
+    data_.push_back(0);
+    return result;
+}
+
+const std::vector<unsigned char>& program::data() const {
+    return data_;
+}
+
+void program::set_slot_size(const std::int32_t value) {
+    slot_size_ = value;
+}
+
+std::int32_t program::slot_size() const {
+    return slot_size_;
+}
+
+std::string program::to_string(const instruction& instruction) {
+    const auto& operands = operands_str[static_cast<size_t>(instruction.op)];
+    auto result = opcode_str[static_cast<size_t>(instruction.op)];
+    for (size_t i = 0; i < operands.size(); ++i) {
+        result += i ? ", " : " ";
+        switch (operands[i]) {
+        case 'a':
+            result += instruction.a == no_register ? "_" : 'r' + std::to_string(instruction.a);
+            break;
+        case 'b':
+            result += 'r' + std::to_string(instruction.b);
+            break;
+        case 'c':
+            result += 'r' + std::to_string(instruction.c);
+            break;
+        case 'v':
+            result += std::to_string(instruction.value);
+            break;
+        default:
+            throw std::logic_error("This point should never be reached");
+        }
+    }
+    return result;
+}
+
+std::string program::constant_to_string(const constant& value) {
+    switch (value.kind) {
+    case constant_kind::real:
+        return str(boost::format("%1%r") % value.value.real);
+    case constant_kind::address:
+        return '&' + std::to_string(value.value.integer);
+    default:
+        return std::to_string(value.value.integer);
+    }
+}
+
+std::string program::to_string() const {
+    std::string result;
+    for (size_t i = 0; i < functions_.size(); ++i) {
+        const auto& f = functions_[i];
+        result += str(boost::format("f%1% = %2% (depth %3%, frame %4%, registers %5%)\n")
+            % i % f.name % f.depth % f.frame_size % f.registers);
+        const auto base = f.registers - f.constants.size();
+        for (size_t j = 0; j < f.constants.size(); ++j)
+            result += str(boost::format("    r%1% = %2%\n") % (base + j) % constant_to_string(f.constants[j]));
+        for (size_t j = 0; j < f.code.size(); ++j)
+            result += str(boost::format("%1$4d: %2%\n") % j % to_string(f.code[j]));
+        result += '\n';
+    }
+    return result;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace bytecode {
+
+        enum class opcode : unsigned char {
+            mov, add_int, sub_int, mul_int, div_int, mod_int, and_int, or_int, xor_int, shl_int, shr_int,
+            neg_int, not_int, add_real, sub_real, mul_real, div_real, neg_real,
+            eq_int, ne_int, lt_int, le_int, gt_int, ge_int, eq_real, ne_real, lt_real, le_real, gt_real, ge_real,
+            int_to_real, real_to_int, int_to_char, address_local, address_outer,
+            load_local_int, load_local_char, load_local_real, store_local_int, store_local_char, store_local_real,
+            load_int, load_char, load_real, store_int, store_char, store_real, copy,
+            push_int, push_char, push_real, push_block, call, ret, ret_int, ret_real, ret_block,
+            jump, jump_if, jump_unless, jump_back, jump_back_if, jump_back_unless,
+            write_int, write_char, write_real, write_string, write_line
+        };
+
+        union slot {
+            std::int32_t integer;
+            double real;
+        };
+
+        struct instruction {
+            opcode op;
+            std::uint16_t a, b, c;
+            std::int32_t value;
+        };
+
+        enum class constant_kind : unsigned char {
+            integer, real, address
+        };
+
+        struct constant {
+            slot value;
+            constant_kind kind;
+        };
+
+        struct function {
+            std::string name;
+            size_t depth;
+            std::int32_t frame_size;
+            std::int32_t parameters_size;
+            std::int32_t padding;
+            std::int32_t return_slot;
+            std::int32_t return_size;
+            bool real_result;
+            size_t registers;
+            std::vector<constant> constants;
+            std::vector<instruction> code;
+        };
+
+        class program {
+
+        public:
+
+            static const std::string opcode_str[];
+            static const std::uint16_t no_register = 0xffff;
+
+            size_t add_function(const function& function);
+            const function& get_function(const size_t id) const;
+            function& get_function(const size_t id);
+            const std::vector<function>& functions() const;
+            std::int32_t add_string(const std::string& value);
+            const std::vector<unsigned char>& data() const;
+            void set_slot_size(const std::int32_t value);
+            std::int32_t slot_size() const;
+            std::string to_string() const;
+
+        private:
+
+            std::vector<function> functions_;
+            std::vector<unsigned char> data_ = std::vector<unsigned char>(16);
+            std::int32_t slot_size_ = 4;
+
+            static std::string to_string(const instruction& instruction);
+            static std::string constant_to_string(const constant& value);
+
+        };// class program
+
+    }// namespace bytecode
+
+}// namespace pascal_compiler
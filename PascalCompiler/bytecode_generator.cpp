@@ -0,0 +1,364 @@
+#include "bytecode_generator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace pascal_compiler;
+using namespace bytecode;
+
+void generator::generate(const ir::module& module) {
+    module_ = &module;
+    strings_.clear();
+    for (const auto& it : module.strings())
+        strings_.push_back(code_.add_string(it));
+    for (size_t i = 0; i < module.functions().size(); ++i)
+        generate_function(i);
+}
+
+void generator::generate_function(const size_t id) {
+    const auto f = module_->get_function(id);
+    function_ = f;
+    current_ = function();
+    current_.name = f->name();
+    current_.depth = f->depth();
+    scratch_ = static_cast<std::uint16_t>(f->temps().size());
+    constants_.clear();
+    jumps_.clear();
+    slots_ = 0;
+    const auto parameters = static_cast<std::int32_t>(f->type()->parameters().get_data_size());
+    const auto result = ir::resolve_type(f->type()->return_type());
+    current_.parameters_size = parameters + (is_aggregate(result) ? 4 : 0);
+    current_.padding = parameters % 4;
+    current_.return_slot = 2 * code_.slot_size() + parameters + parameters % 4;
+    current_.return_size = is_aggregate(result) ? static_cast<std::int32_t>(result->data_size()) : 0;
+    current_.real_result = f->return_type() == ir::value_type::real;
+    size_t blocks = 0;
+    for (const auto& it : f->blocks())
+        blocks = std::max(blocks, it.id() + 1);
+    blocks_.assign(blocks, 0);
+    for (size_t i = 0; i < f->blocks().size(); ++i) {
+        const auto& block = f->blocks()[i];
+        next_block_ = i + 1 < f->blocks().size() ? f->blocks()[i + 1].id() : blocks;
+        blocks_[block.id()] = static_cast<std::int32_t>(current_.code.size());
+        for (const auto& it : block.instructions())
+            generate_instruction(it);
+    }
+    for (const auto it : jumps_) {
+        auto& jump = current_.code[it];
+        jump.value = blocks_[jump.value];
+        if (jump.value <= static_cast<std::int32_t>(it))
+            jump.op = static_cast<opcode>(static_cast<unsigned char>(jump.op) +
+                static_cast<unsigned char>(opcode::jump_back) - static_cast<unsigned char>(opcode::jump));
+    }
+    current_.frame_size = static_cast<std::int32_t>(f->type()->table().get_data_size()) + slots_;
+    current_.registers = scratch_ + scratch_count + current_.constants.size();
+    code_.add_function(current_);
+}
+
+void generator::generate_instruction(const ir::instruction& instruction) {
+    const auto& args = instruction.args();
+    const auto& result = instruction.result();
+    switch (instruction.op()) {
+    case ir::instruction::opcode::mov:
+        if (result.is(ir::operand::kind::temp))
+            load(destination(result), args[0]);
+        else
+            store(result, source(args[0], 0));
+        return;
+    case ir::instruction::opcode::add:
+    case ir::instruction::opcode::sub:
+    case ir::instruction::opcode::mul:
+    case ir::instruction::opcode::div:
+    case ir::instruction::opcode::mod:
+    case ir::instruction::opcode::and:
+    case ir::instruction::opcode::or:
+    case ir::instruction::opcode::xor:
+    case ir::instruction::opcode::shl:
+    case ir::instruction::opcode::shr:
+    {
+        const auto base = result.type() == ir::value_type::real ? opcode::add_real : opcode::add_int;
+        const auto op = static_cast<opcode>(static_cast<unsigned char>(base) + static_cast<unsigned char>(instruction.op()) -
+            static_cast<unsigned char>(ir::instruction::opcode::add));
+        const auto reg = destination(result);
+        emit(op, reg, source(args[0], 0), source(args[1], 1));
+        store(result, reg);
+        return;
+    }
+    case ir::instruction::opcode::neg:
+    case ir::instruction::opcode::not:
+    {
+        const auto op = result.type() == ir::value_type::real
+            ? opcode::neg_real
+            : instruction.op() == ir::instruction::opcode::neg ? opcode::neg_int : opcode::not_int;
+        const auto reg = destination(result);
+        emit(op, reg, source(args[0], 0));
+        store(result, reg);
+        return;
+    }
+    case ir::instruction::opcode::eq:
+    case ir::instruction::opcode::ne:
+    case ir::instruction::opcode::lt:
+    case ir::instruction::opcode::le:
+    case ir::instruction::opcode::gt:
+    case ir::instruction::opcode::ge:
+    {
+        const auto base = args[0].type() == ir::value_type::real ? opcode::eq_real : opcode::eq_int;
+        const auto op = static_cast<opcode>(static_cast<unsigned char>(base) + static_cast<unsigned char>(instruction.op()) -
+            static_cast<unsigned char>(ir::instruction::opcode::eq));
+        const auto reg = destination(result);
+        emit(op, reg, source(args[0], 0), source(args[1], 1));
+        store(result, reg);
+        return;
+    }
+    case ir::instruction::opcode::cast:
+        generate_cast(instruction);
+        return;
+    case ir::instruction::opcode::addr:
+    {
+        const auto& variable = function_->variables()[args[0].id()];
+        const auto reg = destination(result);
+        if (variable.level == function_->depth())
+            emit(opcode::address_local, reg, 0, 0, static_cast<std::int32_t>(variable.offset));
+        else
+            emit(opcode::address_outer, reg, static_cast<std::uint16_t>(variable.level), 0, static_cast<std::int32_t>(variable.offset));
+        store(result, reg);
+        return;
+    }
+    case ir::instruction::opcode::load:
+    {
+        const auto reg = destination(result);
+        emit(typed(opcode::load_int, result.type()), reg, source(args[0], 0));
+        store(result, reg);
+        return;
+    }
+    case ir::instruction::opcode::store:
+        emit(typed(opcode::store_int, args[1].type()), source(args[0], 0), source(args[1], 1));
+        return;
+    case ir::instruction::opcode::copy:
+        emit(opcode::copy, source(args[0], 0), source(args[1], 1), 0, static_cast<std::int32_t>(args[2].int_value()));
+        return;
+    case ir::instruction::opcode::call:
+        generate_call(instruction);
+        return;
+    case ir::instruction::opcode::write:
+        for (const auto& it : args)
+            switch (it.type()) {
+            case ir::value_type::character:
+                emit(opcode::write_char, source(it, 0));
+                break;
+            case ir::value_type::integer:
+                emit(opcode::write_int, source(it, 0));
+                break;
+            case ir::value_type::real:
+                emit(opcode::write_real, source(it, 0));
+                break;
+            default:
+                emit(opcode::write_string, source(it, 0));
+            }
+        emit(opcode::write_line);
+        return;
+    case ir::instruction::opcode::jmp:
+        if (args[0].id() != next_block_)
+            emit_jump(opcode::jump, args[0].id());
+        return;
+    case ir::instruction::opcode::br:
+        generate_branch(instruction);
+        return;
+    case ir::instruction::opcode::ret:
+        generate_return(instruction);
+        return;
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+void generator::generate_cast(const ir::instruction& instruction) {
+    const auto& value = instruction.args()[0];
+    const auto& result = instruction.result();
+    const auto reg = destination(result);
+    if (result.type() == ir::value_type::real)
+        emit(opcode::int_to_real, reg, source(value, 0));
+    else if (value.type() == ir::value_type::real) {
+        emit(opcode::real_to_int, reg, source(value, 0));
+        if (result.type() == ir::value_type::character)
+            emit(opcode::int_to_char, reg, reg);
+    }
+    else if (result.type() == ir::value_type::character)
+        emit(opcode::int_to_char, reg, source(value, 0));
+    else
+        load(reg, value);
+    store(result, reg);
+}
+
+void generator::generate_call(const ir::instruction& instruction) {
+    const auto& args = instruction.args();
+    const auto f = module_->get_function(args[0].id());
+    const auto result = ir::resolve_type(f->type()->return_type());
+    if (is_aggregate(result)) {
+        if (args.size() > f->parameters().size() + 1)
+            emit(opcode::push_int, source(args.back(), 0));
+        else {
+            slots_ += static_cast<std::int32_t>(result->data_size());
+            emit(opcode::address_local, scratch(0), 0, 0, code_.slot_size() * static_cast<std::int32_t>(function_->depth()) +
+                static_cast<std::int32_t>(function_->type()->table().get_data_size()) + slots_);
+            emit(opcode::push_int, scratch(0));
+        }
+    }
+    for (size_t i = 0; i < f->parameters().size(); ++i) {
+        const auto& parameter = f->parameters()[i];
+        const auto reg = source(args[i + 1], 0);
+        if (parameter.is_reference)
+            emit(opcode::push_int, reg);
+        else if (parameter.type == ir::value_type::pointer)
+            emit(opcode::push_block, reg, 0, 0, static_cast<std::int32_t>(parameter.size));
+        else
+            emit(typed(opcode::push_int, parameter.type), reg);
+    }
+    const auto reg = destination(instruction.result());
+    emit(opcode::call, reg, 0, 0, static_cast<std::int32_t>(args[0].id()));
+    store(instruction.result(), reg);
+}
+
+void generator::generate_branch(const ir::instruction& instruction) {
+    const auto& args = instruction.args();
+    const auto on_true = args[1].id(), on_false = args[2].id();
+    if (args[0].is(ir::operand::kind::integer)) {
+        const auto target = args[0].int_value() ? on_true : on_false;
+        if (target != next_block_)
+            emit_jump(opcode::jump, target);
+        return;
+    }
+    const auto reg = source(args[0], 0);
+    if (on_true == next_block_) {
+        emit_jump(opcode::jump_unless, on_false, reg);
+        return;
+    }
+    emit_jump(opcode::jump_if, on_true, reg);
+    if (on_false != next_block_)
+        emit_jump(opcode::jump, on_false);
+}
+
+void generator::generate_return(const ir::instruction& instruction) {
+    if (instruction.args().empty()) {
+        emit(opcode::ret);
+        return;
+    }
+    const auto& value = instruction.args()[0];
+    switch (value.type()) {
+    case ir::value_type::real:
+        emit(opcode::ret_real, source(value, 0));
+        return;
+    case ir::value_type::pointer:
+        emit(opcode::ret_block, source(value, 0));
+        return;
+    default:
+        emit(opcode::ret_int, source(value, 0));
+    }
+}
+
+void generator::emit(const opcode op, const std::uint16_t a, const std::uint16_t b, const std::uint16_t c,
+    const std::int32_t value) {
+    current_.code.push_back({ op, a, b, c, value });
+}
+
+void generator::emit_jump(const opcode op, const size_t block, const std::uint16_t reg) {
+    jumps_.push_back(current_.code.size());
+    emit(op, reg, 0, 0, static_cast<std::int32_t>(block));
+}
+
+std::uint16_t generator::scratch(const size_t index) const {
+    return static_cast<std::uint16_t>(scratch_ + index);
+}
+
+std::uint16_t generator::add_constant(const constant_kind kind, const slot value) {
+    long long key = value.integer;
+    if (kind == constant_kind::real)
+        std::memcpy(&key, &value.real, sizeof key);
+    const auto it = constants_.find({ kind, key });
+    if (it != constants_.end())
+        return it->second;
+    const auto result = static_cast<std::uint16_t>(scratch_ + scratch_count + current_.constants.size());
+    current_.constants.push_back({ value, kind });
+    constants_[{ kind, key }] = result;
+    return result;
+}
+
+std::uint16_t generator::source(const ir::operand& value, const size_t scratch_index) {
+    slot constant;
+    switch (value.get_kind()) {
+    case ir::operand::kind::temp:
+        return static_cast<std::uint16_t>(value.id());
+    case ir::operand::kind::integer:
+        constant.integer = static_cast<std::int32_t>(value.int_value());
+        return add_constant(constant_kind::integer, constant);
+    case ir::operand::kind::real:
+        constant.real = value.real_value();
+        return add_constant(constant_kind::real, constant);
+    case ir::operand::kind::string:
+        constant.integer = strings_[value.id()];
+        return add_constant(constant_kind::address, constant);
+    case ir::operand::kind::variable:
+        load(scratch(scratch_index), value);
+        return scratch(scratch_index);
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+void generator::load(const std::uint16_t reg, const ir::operand& value) {
+    if (!value.is(ir::operand::kind::variable)) {
+        const auto from = source(value, 0);
+        if (from != reg)
+            emit(opcode::mov, reg, from);
+        return;
+    }
+    const auto& variable = function_->variables()[value.id()];
+    if (variable.level == function_->depth()) {
+        emit(typed(opcode::load_local_int, value.type()), reg, 0, 0, static_cast<std::int32_t>(variable.offset));
+        return;
+    }
+    emit(opcode::address_outer, scratch(2), static_cast<std::uint16_t>(variable.level), 0, static_cast<std::int32_t>(variable.offset));
+    emit(typed(opcode::load_int, value.type()), reg, scratch(2));
+}
+
+std::uint16_t generator::destination(const ir::operand& result) const {
+    switch (result.get_kind()) {
+    case ir::operand::kind::temp:
+        return static_cast<std::uint16_t>(result.id());
+    case ir::operand::kind::variable:
+        return scratch(3);
+    default:
+        return program::no_register;
+    }
+}
+
+void generator::store(const ir::operand& result, const std::uint16_t reg) {
+    if (!result.is(ir::operand::kind::variable))
+        return;
+    const auto& variable = function_->variables()[result.id()];
+    if (variable.level == function_->depth()) {
+        emit(typed(opcode::store_local_int, result.type()), reg, 0, 0, static_cast<std::int32_t>(variable.offset));
+        return;
+    }
+    emit(opcode::address_outer, scratch(2), static_cast<std::uint16_t>(variable.level), 0, static_cast<std::int32_t>(variable.offset));
+    emit(typed(opcode::store_int, result.type()), scratch(2), reg);
+}
+
+opcode generator::typed(const opcode op, const ir::value_type type) {
+    switch (type) {
+    case ir::value_type::character:
+        return static_cast<opcode>(static_cast<unsigned char>(op) + 1);
+    case ir::value_type::real:
+        return static_cast<opcode>(static_cast<unsigned char>(op) + 2);
+    case ir::value_type::packed_integer:
+    case ir::value_type::packed_real:
+        throw std::logic_error("This point should never be reached");
+    default:
+        return op;
+    }
+}
+
+bool generator::is_aggregate(const syntax_analyzer::types::type_p& type) {
+    return type->is_category(syntax_analyzer::types::type::type_category::array) ||
+        type->is_category(syntax_analyzer::types::type::type_category::record);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "bytecode.hpp"
+#include "ir.hpp"
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace bytecode {
+
+        class generator {
+
+        public:
+
+            explicit generator(program& code, const std::int32_t slot_size = 4) : code_(code) {
+                code_.set_slot_size(slot_size);
+            }
+
+            void generate(const ir::module& module);
+
+        private:
+
+            static const std::uint16_t scratch_count = 4;
+
+            program& code_;
+            const ir::module* module_ = nullptr;
+            ir::function_p function_;
+            function current_;
+            std::uint16_t scratch_ = 0;
+            std::map<std::pair<constant_kind, long long>, std::uint16_t> constants_;
+            std::vector<std::int32_t> strings_;
+            std::vector<std::int32_t> blocks_;
+            std::vector<size_t> jumps_;
+            std::int32_t slots_ = 0;
+            size_t next_block_ = 0;
+
+            void generate_function(const size_t id);
+            void generate_instruction(const ir::instruction& instruction);
+            void generate_cast(const ir::instruction& instruction);
+            void generate_call(const ir::instruction& instruction);
+            void generate_branch(const ir::instruction& instruction);
+            void generate_return(const ir::instruction& instruction);
+
+            void emit(const opcode op, const std::uint16_t a = 0, const std::uint16_t b = 0, const std::uint16_t c = 0,
+                const std::int32_t value = 0);
+            void emit_jump(const opcode op, const size_t block, const std::uint16_t reg = 0);
+            std::uint16_t scratch(const size_t index) const;
+            std::uint16_t add_constant(const constant_kind kind, const slot value);
+            std::uint16_t source(const ir::operand& value, const size_t scratch_index);
+            void load(const std::uint16_t reg, const ir::operand& value);
+            std::uint16_t destination(const ir::operand& result) const;
+            void store(const ir::operand& result, const std::uint16_t reg);
+            static opcode typed(const opcode op, const ir::value_type type);
+            static bool is_aggregate(const syntax_analyzer::types::type_p& type);
+
+        };// class generator
+
+    }// namespace bytecode
+
+}// namespace pascal_compiler
@@ -0,0 +1,645 @@
+#include "encoder.hpp"
+#include <cstring>
+
+using namespace pascal_compiler;
+using namespace code;
+
+const int encoder::register_code[] = { 0, 3, 1, 2, 0, 1, 4, 5, 0, 1, 4, 3, 0, 6, 7, 2, 3, 4, 5, 6, 7, 4, 5,
+    8, 9, 10, 11, 12, 13, 14, 15, 8, 9, 10, 11, 12, 13, 14, 15 };
+const size_t encoder::register_size[] = { 4, 4, 4, 4, 16, 16, 4, 4, 1, 1, 1, 1, 2, 4, 4, 16, 16, 16, 16, 16, 16, 8, 8,
+    4, 4, 4, 4, 4, 4, 4, 4, 16, 16, 16, 16, 16, 16, 16, 16 };
+
+encoder::encoder(const asm_code& code) {
+    encode_data(code);
+    for (const auto& it : code.listing_)
+        encode(it);
+    encode_entry(code);
+    resolve();
+}
+
+const std::vector<unsigned char>& encoder::text() const {
+    return text_;
+}
+
+const std::vector<unsigned char>& encoder::rodata() const {
+    return rodata_;
+}
+
+size_t encoder::bss_size() const {
+    return bss_size_;
+}
+
+const std::vector<encoder::symbol>& encoder::symbols() const {
+    return symbols_;
+}
+
+const std::vector<encoder::relocation>& encoder::relocations() const {
+    return relocations_;
+}
+
+size_t encoder::entry() const {
+    return entry_;
+}
+
+void encoder::encode_data(const asm_code& code) {
+    for (const auto& it : code.doubles_) {
+        labels_["__real@" + it.second] = std::make_pair(section::rodata, rodata_.size());
+        unsigned long long value;
+        std::memcpy(&value, &it.first, sizeof value);
+        append(rodata_, value, sizeof value);
+    }
+    for (size_t i = 0; i < code.strings_.size(); ++i) {
+        labels_["__string@" + std::to_string(i)] = std::make_pair(section::rodata, rodata_.size());
+        append(rodata_, *code.strings_[i]);
+        rodata_.push_back(0);
+    }
+    labels_["__stack"] = std::make_pair(section::bss, size_t(0));
+    labels_["__stack_pointer"] = std::make_pair(section::bss, size_t(asm_code::x86_64_stack_size));
+    bss_size_ = asm_code::x86_64_stack_size + 8;
+}
+
+void encoder::encode_entry(const asm_code& code) {
+    entry_ = text_.size();
+    symbols_.push_back({ "main", section::text, entry_, true });
+    for (const auto it : { 0x55, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57 })
+        emit(it, 1);
+    operand stack_pointer{ asm_operand::kind::mem, 8 };
+    stack_pointer.name = "__stack_pointer";
+    operand stack{ asm_operand::kind::mem, 8 };
+    stack.name = "__stack";
+    stack.value = asm_code::x86_64_stack_size;
+    instruction(0, true, { 0x89 }, 4, stack_pointer);
+    instruction(0, true, { 0x8d }, 4, stack);
+    encode_jump({ 0xe8 }, code.main_func_name_);
+    instruction(0, true, { 0x8b }, 4, stack_pointer);
+    for (const auto it : { 0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5b, 0x5d, 0x31, 0xc0, 0xc3 })
+        emit(it, 1);
+}
+
+void encoder::encode(const asm_command& command) {
+    switch (command.get_type()) {
+    case asm_command::type::label:
+    {
+        const auto name = command.arg(0).to_string();
+        labels_[name] = std::make_pair(section::text, text_.size());
+        if (name.compare(0, 11, "__function@") == 0)
+            symbols_.push_back({ asm_code::to_gas_name(name), section::text, text_.size(), false });
+        break;
+    }
+    case asm_command::type::enter:
+        emit(0xc8, 1);
+        emit(make_operand(command.arg(0)).value, 2);
+        emit(make_operand(command.arg(1)).value, 1);
+        break;
+    case asm_command::type::leave:
+        emit(0xc9, 1);
+        break;
+    case asm_command::type::cdq:
+        emit(0x99, 1);
+        break;
+    case asm_command::type::lahf:
+        emit(0x9f, 1);
+        break;
+    case asm_command::type::ret:
+        if (command.args_count() == 0)
+            emit(0xc3, 1);
+        else {
+            emit(0xc2, 1);
+            emit(make_operand(command.arg(0)).value, 2);
+        }
+        break;
+    case asm_command::type::add:
+        encode_alu(command, 0);
+        break;
+    case asm_command::type::or:
+        encode_alu(command, 1);
+        break;
+    case asm_command::type::and:
+        encode_alu(command, 4);
+        break;
+    case asm_command::type::sub:
+        encode_alu(command, 5);
+        break;
+    case asm_command::type::xor:
+        encode_alu(command, 6);
+        break;
+    case asm_command::type::cmp:
+        encode_alu(command, 7);
+        break;
+    case asm_command::type::test:
+    {
+        const auto a = make_operand(command.arg(0)), b = make_operand(command.arg(1));
+        if (b.type == asm_operand::kind::imm)
+            instruction(0, a.size == 8, { static_cast<unsigned char>(a.size == 1 ? 0xf6 : 0xf7) }, 0, a, a.size == 1 ? 1 : 4, &b);
+        else
+            instruction(0, a.size == 8, { static_cast<unsigned char>(a.size == 1 ? 0x84 : 0x85) }, b.reg, a);
+        break;
+    }
+    case asm_command::type::mov:
+        encode_mov(make_operand(command.arg(0)), make_operand(command.arg(1)));
+        break;
+    case asm_command::type::lea:
+    {
+        const auto a = make_operand(command.arg(0));
+        instruction(0, a.size == 8, { 0x8d }, a.reg, make_operand(command.arg(1)));
+        break;
+    }
+    case asm_command::type::imul:
+    {
+        const auto a = make_operand(command.arg(0)), b = make_operand(command.arg(1));
+        if (command.args_count() == 3 || b.type == asm_operand::kind::imm) {
+            const auto source = command.args_count() == 3 ? b : a;
+            const auto value = command.args_count() == 3 ? make_operand(command.arg(2)) : b;
+            if (fits_byte(value.value))
+                instruction(0, a.size == 8, { 0x6b }, a.reg, source, 1, &value);
+            else
+                instruction(0, a.size == 8, { 0x69 }, a.reg, source, 4, &value);
+        }
+        else
+            instruction(0, a.size == 8, { 0x0f, 0xaf }, a.reg, b);
+        break;
+    }
+    case asm_command::type::not:
+    case asm_command::type::neg:
+    case asm_command::type::idiv:
+    {
+        const auto a = make_operand(command.arg(0));
+        const auto extension = command.get_type() == asm_command::type::not ? 2 : command.get_type() == asm_command::type::neg ? 3 : 7;
+        instruction(0, a.size == 8, { static_cast<unsigned char>(a.size == 1 ? 0xf6 : 0xf7) }, extension, a);
+        break;
+    }
+    case asm_command::type::inc:
+    case asm_command::type::dec:
+    {
+        const auto a = make_operand(command.arg(0));
+        instruction(0, a.size == 8, { static_cast<unsigned char>(a.size == 1 ? 0xfe : 0xff) },
+            command.get_type() == asm_command::type::inc ? 0 : 1, a);
+        break;
+    }
+    case asm_command::type::shl:
+    case asm_command::type::shr:
+    {
+        const auto a = make_operand(command.arg(0)), b = make_operand(command.arg(1));
+        const auto extension = command.get_type() == asm_command::type::shl ? 4 : 5;
+        if (b.type == asm_operand::kind::imm)
+            instruction(0, a.size == 8, { static_cast<unsigned char>(a.size == 1 ? 0xc0 : 0xc1) }, extension, a, 1, &b);
+        else
+            instruction(0, a.size == 8, { static_cast<unsigned char>(a.size == 1 ? 0xd2 : 0xd3) }, extension, a);
+        break;
+    }
+    case asm_command::type::movsx:
+    {
+        const auto a = make_operand(command.arg(0)), b = make_operand(command.arg(1));
+        instruction(0, a.size == 8, { 0x0f, static_cast<unsigned char>(b.size == 1 ? 0xbe : 0xbf) }, a.reg, b);
+        break;
+    }
+    case asm_command::type::setge:
+    case asm_command::type::setg:
+    case asm_command::type::setle:
+    case asm_command::type::setl:
+    case asm_command::type::sete:
+    case asm_command::type::setne:
+    case asm_command::type::setbe:
+    case asm_command::type::setb:
+    case asm_command::type::seta:
+    case asm_command::type::setae:
+        instruction(0, false, { 0x0f, static_cast<unsigned char>(0x90 + condition_code(command.get_type())) }, 0, make_operand(command.arg(0)));
+        break;
+    case asm_command::type::jmp:
+        encode_jump({ 0xe9 }, make_operand(command.arg(0)).name);
+        break;
+    case asm_command::type::call:
+        encode_jump({ 0xe8 }, make_operand(command.arg(0)).name, relocation_type::plt);
+        break;
+    case asm_command::type::loop:
+        encode_jump({ 0xe2 }, make_operand(command.arg(0)).name, relocation_type::pc_relative, 1);
+        break;
+    case asm_command::type::jp:
+    case asm_command::type::jnp:
+    case asm_command::type::jnz:
+    case asm_command::type::jz:
+    case asm_command::type::jge:
+    case asm_command::type::jle:
+    case asm_command::type::jl:
+    case asm_command::type::jg:
+    case asm_command::type::jb:
+    case asm_command::type::jbe:
+    case asm_command::type::ja:
+    case asm_command::type::jae:
+        encode_jump({ 0x0f, static_cast<unsigned char>(0x80 + condition_code(command.get_type())) }, make_operand(command.arg(0)).name);
+        break;
+    case asm_command::type::push:
+    case asm_command::type::pop:
+        encode_stack(command);
+        break;
+    default:
+        encode_sse(command);
+    }
+}
+
+void encoder::encode_alu(const asm_command& command, const unsigned char extension) {
+    const auto a = make_operand(command.arg(0)), b = make_operand(command.arg(1));
+    const auto size = a.type == asm_operand::kind::reg || b.type != asm_operand::kind::reg ? a.size : b.size;
+    const unsigned char prefix = size == 2 ? 0x66 : 0;
+    if (b.type == asm_operand::kind::imm) {
+        if (size == 1)
+            instruction(prefix, false, { 0x80 }, extension, a, 1, &b);
+        else if (b.name.empty() && fits_byte(b.value))
+            instruction(prefix, size == 8, { 0x83 }, extension, a, 1, &b);
+        else
+            instruction(prefix, size == 8, { 0x81 }, extension, a, size == 2 ? 2 : 4, &b);
+    }
+    else if (b.type == asm_operand::kind::reg)
+        instruction(prefix, size == 8, { static_cast<unsigned char>(extension * 8 + (size == 1 ? 0 : 1)) }, b.reg, a);
+    else
+        instruction(prefix, size == 8, { static_cast<unsigned char>(extension * 8 + (size == 1 ? 2 : 3)) }, a.reg, b);
+}
+
+void encoder::encode_mov(const operand& destination, const operand& source) {
+    const auto size = destination.type == asm_operand::kind::reg || source.type != asm_operand::kind::reg ? destination.size : source.size;
+    const unsigned char prefix = size == 2 ? 0x66 : 0;
+    if (source.type == asm_operand::kind::imm)
+        instruction(prefix, size == 8, { static_cast<unsigned char>(size == 1 ? 0xc6 : 0xc7) }, 0, destination,
+            size == 1 ? 1 : size == 2 ? 2 : 4, &source);
+    else if (source.type == asm_operand::kind::reg)
+        instruction(prefix, size == 8, { static_cast<unsigned char>(size == 1 ? 0x88 : 0x89) }, source.reg, destination);
+    else
+        instruction(prefix, size == 8, { static_cast<unsigned char>(size == 1 ? 0x8a : 0x8b) }, destination.reg, source);
+}
+
+void encoder::encode_stack(const asm_command& command) {
+    const auto a = make_operand(command.arg(0));
+    const auto push = command.get_type() == asm_command::type::push;
+    if (a.type == asm_operand::kind::reg) {
+        if (a.reg >= 8)
+            emit(0x41, 1);
+        emit((push ? 0x50 : 0x58) + (a.reg & 7), 1);
+    }
+    else if (a.type == asm_operand::kind::imm && push) {
+        emit(0x68, 1);
+        immediate(a, 4);
+    }
+    else if (a.type == asm_operand::kind::mem)
+        instruction(0, false, { static_cast<unsigned char>(push ? 0xff : 0x8f) }, push ? 6 : 0, a);
+    else
+        throw std::logic_error("This point should never be reached");
+}
+
+void encoder::encode_sse(const asm_command& command) {
+    unsigned char prefix, load, store = 0;
+    switch (command.get_type()) {
+    case asm_command::type::movsd:
+        prefix = 0xf2, load = 0x10, store = 0x11;
+        break;
+    case asm_command::type::movupd:
+        prefix = 0x66, load = 0x10, store = 0x11;
+        break;
+    case asm_command::type::movdqu:
+        prefix = 0xf3, load = 0x6f, store = 0x7f;
+        break;
+    case asm_command::type::movd:
+        prefix = 0x66, load = 0x6e, store = 0x7e;
+        break;
+    case asm_command::type::addsd:
+        prefix = 0xf2, load = 0x58;
+        break;
+    case asm_command::type::mulsd:
+        prefix = 0xf2, load = 0x59;
+        break;
+    case asm_command::type::subsd:
+        prefix = 0xf2, load = 0x5c;
+        break;
+    case asm_command::type::divsd:
+        prefix = 0xf2, load = 0x5e;
+        break;
+    case asm_command::type::addpd:
+        prefix = 0x66, load = 0x58;
+        break;
+    case asm_command::type::mulpd:
+        prefix = 0x66, load = 0x59;
+        break;
+    case asm_command::type::subpd:
+        prefix = 0x66, load = 0x5c;
+        break;
+    case asm_command::type::divpd:
+        prefix = 0x66, load = 0x5e;
+        break;
+    case asm_command::type::paddd:
+        prefix = 0x66, load = 0xfe;
+        break;
+    case asm_command::type::psubd:
+        prefix = 0x66, load = 0xfa;
+        break;
+    case asm_command::type::pxor:
+        prefix = 0x66, load = 0xef;
+        break;
+    case asm_command::type::unpcklpd:
+        prefix = 0x66, load = 0x14;
+        break;
+    case asm_command::type::unpckhpd:
+        prefix = 0x66, load = 0x15;
+        break;
+    case asm_command::type::comisd:
+        prefix = 0x66, load = 0x2f;
+        break;
+    case asm_command::type::ucomisd:
+        prefix = 0x66, load = 0x2e;
+        break;
+    case asm_command::type::cvtsi2sd:
+        prefix = 0xf2, load = 0x2a;
+        break;
+    case asm_command::type::cvttsd2si:
+        prefix = 0xf2, load = 0x2c;
+        break;
+    case asm_command::type::pshufd:
+        prefix = 0x66, load = 0x70;
+        break;
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+    const auto a = make_operand(command.arg(0)), b = make_operand(command.arg(1));
+    if (command.args_count() == 3) {
+        const auto value = make_operand(command.arg(2));
+        instruction(prefix, false, { 0x0f, load }, a.reg, b, 1, &value);
+    }
+    else if (is_xmm(a) || command.get_type() == asm_command::type::cvttsd2si)
+        instruction(prefix, false, { 0x0f, load }, a.reg, b);
+    else if (store)
+        instruction(prefix, false, { 0x0f, store }, b.reg, a);
+    else
+        throw std::logic_error("This point should never be reached");
+}
+
+void encoder::encode_jump(const std::vector<unsigned char>& opcode, const std::string& target,
+    const relocation_type type, const size_t size) {
+    for (const auto it : opcode)
+        emit(it, 1);
+    references_.push_back({ text_.size(), size, target, type, -static_cast<long long>(size) });
+    emit(0, size);
+}
+
+void encoder::instruction(const unsigned char prefix, const bool wide, const std::vector<unsigned char>& opcode,
+    const int reg, const operand& rm, const size_t immediate_size, const operand* value) {
+    if (prefix)
+        emit(prefix, 1);
+    if (rm.type == asm_operand::kind::mem && rm.address32)
+        emit(0x67, 1);
+    auto rex = (wide ? 8 : 0) | (reg >= 8 ? 4 : 0) | (rm.reg >= 8 ? 1 : 0);
+    if (rm.type == asm_operand::kind::mem && rm.index >= 8)
+        rex |= 2;
+    if (rex)
+        emit(0x40 | rex, 1);
+    for (const auto it : opcode)
+        emit(it, 1);
+    const auto field = (reg & 7) << 3;
+    if (rm.type == asm_operand::kind::reg)
+        emit(0xc0 | field | (rm.reg & 7), 1);
+    else if (rm.reg == -1) {
+        emit(field | 5, 1);
+        references_.push_back({ text_.size(), 4, rm.name, relocation_type::pc_relative,
+            rm.value - 4 - static_cast<long long>(immediate_size) });
+        emit(0, 4);
+    }
+    else {
+        const auto mod = rm.value == 0 && (rm.reg & 7) != 5 ? 0 : fits_byte(rm.value) ? 1 : 2;
+        if (rm.index != -1 || (rm.reg & 7) == 4) {
+            const auto scale = rm.scale == 8 ? 3 : rm.scale == 4 ? 2 : rm.scale == 2 ? 1 : 0;
+            emit((mod << 6) | field | 4, 1);
+            emit((scale << 6) | ((rm.index == -1 ? 4 : rm.index & 7) << 3) | (rm.reg & 7), 1);
+        }
+        else
+            emit((mod << 6) | field | (rm.reg & 7), 1);
+        if (mod)
+            emit(rm.value, mod == 1 ? 1 : 4);
+    }
+    if (value)
+        immediate(*value, immediate_size);
+}
+
+void encoder::immediate(const operand& value, const size_t size) {
+    if (!value.name.empty()) {
+        references_.push_back({ text_.size(), size, value.name, relocation_type::absolute, value.value });
+        emit(0, size);
+    }
+    else
+        emit(value.value, size);
+}
+
+void encoder::resolve() {
+    for (const auto& it : references_) {
+        const auto label = labels_.find(it.name);
+        if (label != labels_.end() && label->second.first == section::text && it.type != relocation_type::absolute) {
+            const auto value = static_cast<long long>(label->second.second) + it.addend - static_cast<long long>(it.offset);
+            if (it.size == 1 && !fits_byte(value))
+                throw std::logic_error("This point should never be reached");
+            for (size_t i = 0; i < it.size; ++i)
+                text_[it.offset + i] = static_cast<unsigned char>(value >> 8 * i);
+            continue;
+        }
+        if (it.size != 4)
+            throw std::logic_error("This point should never be reached");
+        if (label != labels_.end())
+            relocations_.push_back({ it.offset, label->second.first, "",
+                it.type == relocation_type::plt ? relocation_type::pc_relative : it.type,
+                static_cast<long long>(label->second.second) + it.addend });
+        else
+            relocations_.push_back({ it.offset, section::external, it.name, it.type, it.addend });
+    }
+}
+
+void encoder::emit(const unsigned long long value, const size_t size) {
+    append(text_, value, size);
+}
+
+void encoder::write_elf(std::ostream& out) const {
+    static const std::string section_names[] = {
+        "", ".text", ".rodata", ".bss", ".note.GNU-stack", ".symtab", ".strtab", ".rela.text", ".shstrtab"
+    };
+    std::vector<unsigned char> symtab(24), strtab(1), rela, shstrtab;
+    const auto add_symbol = [&](const std::string& name, const unsigned char info, const size_t index, const size_t value) {
+        append(symtab, name.empty() ? 0 : strtab.size(), 4);
+        append(symtab, info, 1);
+        append(symtab, 0, 1);
+        append(symtab, index, 2);
+        append(symtab, value, 8);
+        append(symtab, 0, 8);
+        if (!name.empty()) {
+            append(strtab, name);
+            strtab.push_back(0);
+        }
+    };
+    for (size_t i = 1; i <= 3; ++i)
+        add_symbol("", 3, i, 0);
+    for (const auto& it : symbols_)
+        if (!it.global)
+            add_symbol(it.name, 2, static_cast<size_t>(it.segment) + 1, it.offset);
+    const auto first_global = symtab.size() / 24;
+    for (const auto& it : symbols_)
+        if (it.global)
+            add_symbol(it.name, 0x12, static_cast<size_t>(it.segment) + 1, it.offset);
+    std::unordered_map<std::string, size_t> externals;
+    for (const auto& it : relocations_) {
+        size_t index = static_cast<size_t>(it.segment) + 1;
+        if (it.segment == section::external) {
+            if (externals.find(it.name) == externals.end()) {
+                externals[it.name] = symtab.size() / 24;
+                add_symbol(it.name, 0x10, 0, 0);
+            }
+            index = externals[it.name];
+        }
+        append(rela, it.offset, 8);
+        append(rela, index << 32 | (it.type == relocation_type::absolute ? 10 : it.type == relocation_type::plt ? 4 : 2), 8);
+        append(rela, it.addend, 8);
+    }
+    std::vector<size_t> names;
+    for (const auto& it : section_names) {
+        names.push_back(shstrtab.size());
+        append(shstrtab, it);
+        shstrtab.push_back(0);
+    }
+    std::vector<unsigned char> file(64);
+    const std::vector<unsigned char>* contents[] = { nullptr, &text_, &rodata_, nullptr, nullptr, &symtab, &strtab, &rela, &shstrtab };
+    const size_t types[] = { 0, 1, 1, 8, 1, 2, 3, 4, 3 };
+    const size_t flags[] = { 0, 6, 2, 3, 0, 0, 0, 0x40, 0 };
+    const size_t aligns[] = { 0, 16, 16, 16, 1, 8, 1, 8, 1 };
+    size_t offsets[9] = {};
+    for (size_t i = 1; i < 9; ++i) {
+        while (file.size() % aligns[i])
+            file.push_back(0);
+        offsets[i] = file.size();
+        if (contents[i])
+            file.insert(file.end(), contents[i]->begin(), contents[i]->end());
+    }
+    while (file.size() % 8)
+        file.push_back(0);
+    const auto header_offset = file.size();
+    for (size_t i = 0; i < 9; ++i) {
+        append(file, names[i], 4);
+        append(file, types[i], 4);
+        append(file, flags[i], 8);
+        append(file, 0, 8);
+        append(file, offsets[i], 8);
+        append(file, contents[i] ? contents[i]->size() : i == 3 ? bss_size_ : 0, 8);
+        append(file, i == 5 ? 6 : i == 7 ? 5 : 0, 4);
+        append(file, i == 5 ? first_global : i == 7 ? 1 : 0, 4);
+        append(file, aligns[i], 8);
+        append(file, i == 5 || i == 7 ? 24 : 0, 8);
+    }
+    std::vector<unsigned char> header = { 0x7f, 'E', 'L', 'F', 2, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    append(header, 1, 2);
+    append(header, 62, 2);
+    append(header, 1, 4);
+    append(header, 0, 8);
+    append(header, 0, 8);
+    append(header, header_offset, 8);
+    append(header, 0, 4);
+    append(header, 64, 2);
+    append(header, 0, 2);
+    append(header, 0, 2);
+    append(header, 64, 2);
+    append(header, 9, 2);
+    append(header, 8, 2);
+    std::copy(header.begin(), header.end(), file.begin());
+    out.write(reinterpret_cast<const char*>(file.data()), file.size());
+}
+
+encoder::operand encoder::make_operand(const asm_operand& arg) {
+    operand result{ arg.get_kind() };
+    switch (arg.get_kind()) {
+    case asm_operand::kind::reg:
+        return make_register(arg.get_reg_type());
+    case asm_operand::kind::mem:
+        result.size = size_t(1) << static_cast<int>(arg.get_mem_size());
+        result.reg = register_code[static_cast<int>(arg.get_reg_type())];
+        result.address32 = register_size[static_cast<int>(arg.get_reg_type())] == 4;
+        if (arg.has_index()) {
+            result.index = register_code[static_cast<int>(arg.get_index())];
+            result.scale = arg.get_scale();
+        }
+        result.value = arg.get_offset();
+        return result;
+    case asm_operand::kind::imm:
+        result.value = arg.get_value();
+        return result;
+    case asm_operand::kind::label:
+    case asm_operand::kind::symbol:
+        result.type = asm_operand::kind::label;
+        result.name = arg.to_string();
+        return result;
+    case asm_operand::kind::constant:
+        result.type = asm_operand::kind::mem;
+        result.size = size_t(1) << static_cast<int>(arg.get_mem_size());
+        result.name = arg.get_name();
+        result.value = arg.get_offset();
+        return result;
+    case asm_operand::kind::address:
+        result.type = asm_operand::kind::imm;
+        result.name = arg.get_name();
+        return result;
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+encoder::operand encoder::make_register(const asm_reg::reg_type reg) {
+    operand result{ asm_operand::kind::reg, register_size[static_cast<int>(reg)], register_code[static_cast<int>(reg)] };
+    return result;
+}
+
+unsigned char encoder::condition_code(const asm_command::type type) {
+    switch (type) {
+    case asm_command::type::jb:
+    case asm_command::type::setb:
+        return 2;
+    case asm_command::type::jae:
+    case asm_command::type::setae:
+        return 3;
+    case asm_command::type::jz:
+    case asm_command::type::sete:
+        return 4;
+    case asm_command::type::jnz:
+    case asm_command::type::setne:
+        return 5;
+    case asm_command::type::jbe:
+    case asm_command::type::setbe:
+        return 6;
+    case asm_command::type::ja:
+    case asm_command::type::seta:
+        return 7;
+    case asm_command::type::jp:
+        return 10;
+    case asm_command::type::jnp:
+        return 11;
+    case asm_command::type::jl:
+    case asm_command::type::setl:
+        return 12;
+    case asm_command::type::jge:
+    case asm_command::type::setge:
+        return 13;
+    case asm_command::type::jle:
+    case asm_command::type::setle:
+        return 14;
+    case asm_command::type::jg:
+    case asm_command::type::setg:
+        return 15;
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+bool encoder::is_xmm(const operand& value) {
+    return value.type == asm_operand::kind::reg && value.size == 16;
+}
+
+bool encoder::fits_byte(const long long value) {
+    return value >= -128 && value <= 127;
+}
+
+void encoder::append(std::vector<unsigned char>& buffer, const unsigned long long value, const size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        buffer.push_back(static_cast<unsigned char>(value >> 8 * i));
+}
+
+void encoder::append(std::vector<unsigned char>& buffer, const std::string& value) {
+    buffer.insert(buffer.end(), value.begin(), value.end());
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "asm_code.hpp"
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace code {
+
+        class encoder {
+
+        public:
+
+            enum class section : unsigned char {
+                text, rodata, bss, external
+            };
+
+            enum class relocation_type : unsigned char {
+                absolute, pc_relative, plt
+            };
+
+            struct symbol {
+                std::string name;
+                section segment;
+                size_t offset;
+                bool global;
+            };
+
+            struct relocation {
+                size_t offset;
+                section segment;
+                std::string name;
+                relocation_type type;
+                long long addend;
+            };
+
+            explicit encoder(const asm_code& code);
+
+            const std::vector<unsigned char>& text() const;
+            const std::vector<unsigned char>& rodata() const;
+            size_t bss_size() const;
+            const std::vector<symbol>& symbols() const;
+            const std::vector<relocation>& relocations() const;
+            size_t entry() const;
+            void write_elf(std::ostream& out) const;
+
+        private:
+
+            struct operand {
+                asm_operand::kind type = asm_operand::kind::none;
+                size_t size = 0;
+                int reg = -1;
+                int index = -1;
+                long long scale = 1;
+                long long value = 0;
+                bool address32 = false;
+                std::string name = "";
+            };
+
+            struct reference {
+                size_t offset;
+                size_t size;
+                std::string name;
+                relocation_type type;
+                long long addend;
+            };
+
+            static const int register_code[];
+            static const size_t register_size[];
+
+            std::vector<unsigned char> text_, rodata_;
+            size_t bss_size_ = 0;
+            size_t entry_ = 0;
+            std::unordered_map<std::string, std::pair<section, size_t>> labels_;
+            std::vector<reference> references_;
+            std::vector<symbol> symbols_;
+            std::vector<relocation> relocations_;
+
+            void encode_data(const asm_code& code);
+            void encode_entry(const asm_code& code);
+            void encode(const asm_command& command);
+            void encode_alu(const asm_command& command, const unsigned char extension);
+            void encode_mov(const operand& destination, const operand& source);
+            void encode_stack(const asm_command& command);
+            void encode_sse(const asm_command& command);
+            void encode_jump(const std::vector<unsigned char>& opcode, const std::string& target,
+                const relocation_type type = relocation_type::pc_relative, const size_t size = 4);
+            void instruction(const unsigned char prefix, const bool wide, const std::vector<unsigned char>& opcode,
+                const int reg, const operand& rm, const size_t immediate_size = 0, const operand* value = nullptr);
+            void immediate(const operand& value, const size_t size);
+            void resolve();
+            void emit(const unsigned long long value, const size_t size);
+
+            static operand make_operand(const asm_operand& arg);
+            static operand make_register(const asm_reg::reg_type reg);
+            static unsigned char condition_code(const asm_command::type type);
+            static bool is_xmm(const operand& value);
+            static bool fits_byte(const long long value);
+            static void append(std::vector<unsigned char>& buffer, const unsigned long long value, const size_t size);
+            static void append(std::vector<unsigned char>& buffer, const std::string& value);
+
+        };// class encoder
+
+    }// namespace code
+
+}// namespace pascal_compiler
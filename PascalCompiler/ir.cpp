@@ -0,0 +1,446 @@
+#include "ir.hpp"
+#include "boost/format.hpp"
+#include <algorithm>
+
+using namespace pascal_compiler;
+using namespace ir;
+
+static const std::string value_type_str[] = { "none", "char", "integer", "real", "pointer", "packed integer", "packed real" };
+
+type_p ir::resolve_type(const type_p& type) {
+    auto result = type;
+    while (result->is_category(type::type_category::type) || result->is_category(type::type_category::modified))
+        result = base_type(result);
+    return result;
+}
+
+value_type ir::get_value_type(const type_p& type) {
+    switch (resolve_type(type)->category()) {
+    case type::type_category::character:
+        return value_type::character;
+    case type::type_category::integer:
+        return value_type::integer;
+    case type::type_category::real:
+        return value_type::real;
+    case type::type_category::array:
+    case type::type_category::record:
+    case type::type_category::pointer:
+        return value_type::pointer;
+    default:
+        return value_type::none;
+    }
+}
+
+bool ir::is_packed(const value_type type) {
+    return type == value_type::packed_integer || type == value_type::packed_real;
+}
+
+// class operand
+operand operand::make_temp(const size_t id, const value_type type) {
+    operand result(kind::temp, type);
+    result.id_ = id;
+    return result;
+}
+
+operand operand::make_variable(const size_t id, const value_type type) {
+    operand result(kind::variable, type);
+    result.id_ = id;
+    return result;
+}
+
+operand operand::make_integer(const long long value, const value_type type) {
+    operand result(kind::integer, type);
+    result.int_value_ = value;
+    return result;
+}
+
+operand operand::make_real(const double value) {
+    operand result(kind::real, value_type::real);
+    result.real_value_ = value;
+    return result;
+}
+
+operand operand::make_string(const size_t id) {
+    operand result(kind::string, value_type::pointer);
+    result.id_ = id;
+    return result;
+}
+
+operand operand::make_function(const size_t id) {
+    operand result(kind::function, value_type::none);
+    result.id_ = id;
+    return result;
+}
+
+operand operand::make_block(const size_t id) {
+    operand result(kind::block, value_type::none);
+    result.id_ = id;
+    return result;
+}
+
+operand::kind operand::get_kind() const { return kind_; }
+
+bool operand::is(const kind kind) const { return kind_ == kind; }
+
+bool operand::is_constant() const { return kind_ == kind::integer || kind_ == kind::real; }
+
+value_type operand::type() const { return type_; }
+
+size_t operand::id() const { return id_; }
+
+long long operand::int_value() const { return int_value_; }
+
+double operand::real_value() const { return real_value_; }
+
+std::string operand::to_string() const {
+    switch (kind_) {
+    case kind::none:
+        return "_";
+    case kind::temp:
+        return str(boost::format("t%1%") % id_);
+    case kind::variable:
+        return str(boost::format("v%1%") % id_);
+    case kind::integer:
+        return type_ == value_type::character
+            ? str(boost::format("#%1%") % int_value_)
+            : std::to_string(int_value_);
+    case kind::real:
+        return str(boost::format("%1%r") % real_value_);
+    case kind::string:
+        return str(boost::format("s%1%") % id_);
+    case kind::function:
+        return str(boost::format("f%1%") % id_);
+    case kind::block:
+        return str(boost::format("bb%1%") % id_);
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+bool operand::operator==(const operand& other) const {
+    if (kind_ != other.kind_ || type_ != other.type_)
+        return false;
+    switch (kind_) {
+    case kind::integer:
+        return int_value_ == other.int_value_;
+    case kind::real:
+        return real_value_ == other.real_value_;
+    default:
+        return id_ == other.id_;
+    }
+}
+
+bool operand::operator!=(const operand& other) const { return !(*this == other); }
+
+// class instruction
+const std::string instruction::opcode_str[] = {
+    "mov", "add", "sub", "mul", "div", "mod", "and", "or", "xor", "shl", "shr", "neg", "not",
+    "eq", "ne", "lt", "le", "gt", "ge", "cast", "addr", "load", "store", "copy",
+    "call", "write", "jmp", "br", "ret", "phi", "splat", "reduce"
+};
+
+instruction::opcode instruction::op() const { return op_; }
+
+const operand& instruction::result() const { return result_; }
+
+operand& instruction::result() { return result_; }
+
+const std::vector<operand>& instruction::args() const { return args_; }
+
+std::vector<operand>& instruction::args() { return args_; }
+
+bool instruction::is_terminator() const {
+    return op_ == opcode::jmp || op_ == opcode::br || op_ == opcode::ret;
+}
+
+bool instruction::is_phi() const { return op_ == opcode::phi; }
+
+bool instruction::has_side_effects() const {
+    switch (op_) {
+    case opcode::store:
+    case opcode::copy:
+    case opcode::call:
+    case opcode::write:
+    case opcode::jmp:
+    case opcode::br:
+    case opcode::ret:
+        return true;
+    case opcode::div:
+    case opcode::mod:
+        return !args_[1].is(operand::kind::integer) || args_[1].int_value() == 0;
+    default:
+        return result_.is(operand::kind::variable);
+    }
+}
+
+std::string instruction::to_string() const {
+    std::string result;
+    if (!result_.is(operand::kind::none))
+        result = result_.to_string() + " = ";
+    result += opcode_str[static_cast<unsigned char>(op_)];
+    if (op_ == opcode::cast)
+        result += ' ' + value_type_str[static_cast<unsigned char>(result_.type())];
+    for (size_t i = 0; i < args_.size(); ++i)
+        result += (i ? ", " : " ") + args_[i].to_string();
+    return result;
+}
+
+// class basic_block
+size_t basic_block::id() const { return id_; }
+
+const std::vector<instruction>& basic_block::instructions() const { return instructions_; }
+
+std::vector<instruction>& basic_block::instructions() { return instructions_; }
+
+const std::vector<size_t>& basic_block::successors() const { return successors_; }
+
+const std::vector<size_t>& basic_block::predecessors() const { return predecessors_; }
+
+bool basic_block::is_terminated() const {
+    return !instructions_.empty() && instructions_.back().is_terminator();
+}
+
+std::string basic_block::to_string() const {
+    auto result = str(boost::format("bb%1%:\n") % id_);
+    for (const auto& it : instructions_)
+        result += "    " + it.to_string() + '\n';
+    return result;
+}
+
+// class function
+function::function(const std::string& name, const std::string& label, const size_t depth,
+    const function_type_p& type, const std::pair<int, int>& position) :
+    name_(name), label_(label), depth_(depth), type_(type), position_(position),
+    return_type_(get_value_type(type->return_type())) {
+    for (const auto& it : type->parameters().vector()) {
+        const auto t = it.second.first;
+        const auto is_reference = t->is_category(type::type_category::modified) &&
+            std::dynamic_pointer_cast<modified_type>(t)->is_reference();
+        parameters_.push_back({ get_value_type(t), resolve_type(t)->data_size(), is_reference });
+    }
+}
+
+const std::string& function::name() const { return name_; }
+
+const std::string& function::label() const { return label_; }
+
+size_t function::depth() const { return depth_; }
+
+const function_type_p& function::type() const { return type_; }
+
+const std::pair<int, int>& function::position() const { return position_; }
+
+value_type function::return_type() const { return return_type_; }
+
+const std::vector<function::parameter_t>& function::parameters() const { return parameters_; }
+
+size_t function::add_block() {
+    blocks_.emplace_back(blocks_.size());
+    return blocks_.size() - 1;
+}
+
+basic_block& function::block(const size_t id) { return blocks_[id]; }
+
+const basic_block& function::block(const size_t id) const { return blocks_[id]; }
+
+std::vector<basic_block>& function::blocks() { return blocks_; }
+
+const std::vector<basic_block>& function::blocks() const { return blocks_; }
+
+operand function::new_temp(const value_type type) {
+    temps_.push_back(type);
+    return operand::make_temp(temps_.size() - 1, type);
+}
+
+const std::vector<value_type>& function::temps() const { return temps_; }
+
+size_t function::add_variable(const variable_t& variable) {
+    for (size_t i = 0; i < variables_.size(); ++i)
+        if (variables_[i].name == variable.name && variables_[i].level == variable.level)
+            return i;
+    variables_.push_back(variable);
+    return variables_.size() - 1;
+}
+
+const std::vector<function::variable_t>& function::variables() const { return variables_; }
+
+void function::add_nested(const size_t id) { nested_.push_back(id); }
+
+const std::vector<size_t>& function::nested() const { return nested_; }
+
+void function::update_cfg() {
+    for (auto& it : blocks_) {
+        it.successors_.clear();
+        it.predecessors_.clear();
+    }
+    for (auto& it : blocks_) {
+        if (it.instructions_.empty())
+            continue;
+        for (const auto& arg : it.instructions_.back().args())
+            if (arg.is(operand::kind::block) &&
+                find(it.successors_.begin(), it.successors_.end(), arg.id()) == it.successors_.end()) {
+                it.successors_.push_back(arg.id());
+                blocks_[arg.id()].predecessors_.push_back(it.id_);
+            }
+    }
+}
+
+void function::remove_unreachable_blocks() {
+    update_cfg();
+    std::vector<bool> reachable(blocks_.size(), false);
+    std::vector<size_t> stack = { 0 };
+    reachable[0] = true;
+    while (!stack.empty()) {
+        const auto id = stack.back(); stack.pop_back();
+        for (const auto it : blocks_[id].successors_)
+            if (!reachable[it]) {
+                reachable[it] = true;
+                stack.push_back(it);
+            }
+    }
+    std::vector<size_t> order;
+    for (size_t i = 0; i < blocks_.size(); ++i)
+        if (reachable[i])
+            order.push_back(i);
+    for (auto& it : blocks_)
+        for (auto& inst : it.instructions_) {
+            if (!inst.is_phi())
+                continue;
+            auto& args = inst.args();
+            for (size_t i = 0; i < args.size(); )
+                if (reachable[args[i].id()] && find(it.predecessors_.begin(), it.predecessors_.end(), args[i].id()) != it.predecessors_.end())
+                    i += 2;
+                else
+                    args.erase(args.begin() + i, args.begin() + i + 2);
+        }
+    reorder_blocks(order);
+}
+
+void function::reorder_blocks(const std::vector<size_t>& order) {
+    std::vector<size_t> ids(blocks_.size());
+    std::vector<basic_block> blocks;
+    for (const auto it : order) {
+        ids[it] = blocks.size();
+        blocks.push_back(std::move(blocks_[it]));
+        blocks.back().id_ = ids[it];
+    }
+    for (auto& it : blocks)
+        for (auto& inst : it.instructions_)
+            for (auto& arg : inst.args())
+                if (arg.is(operand::kind::block))
+                    arg = operand::make_block(ids[arg.id()]);
+    blocks_ = std::move(blocks);
+    update_cfg();
+}
+
+void function::simplify_cfg() {
+    update_cfg();
+    const auto has_phi = [this](const size_t id) {
+        return !blocks_[id].instructions_.empty() && blocks_[id].instructions_.front().is_phi();
+    };
+    for (auto& it : blocks_) {
+        auto& last = it.instructions_.back();
+        for (auto& arg : last.args()) {
+            if (!arg.is(operand::kind::block))
+                continue;
+            auto target = arg.id();
+            for (size_t i = 0; i < blocks_.size() && target != 0 && !has_phi(target) &&
+                blocks_[target].instructions_.size() == 1 && blocks_[target].instructions_[0].op() == instruction::opcode::jmp; ++i)
+                target = blocks_[target].instructions_[0].args()[0].id();
+            if (!has_phi(target))
+                arg = operand::make_block(target);
+        }
+        if (last.op() == instruction::opcode::br && last.args()[1] == last.args()[2])
+            last = instruction(instruction::opcode::jmp, operand(), { last.args()[1] });
+    }
+    update_cfg();
+    for (auto& it : blocks_)
+        while (it.instructions_.back().op() == instruction::opcode::jmp) {
+            const auto target = it.instructions_.back().args()[0].id();
+            if (target == 0 || target == it.id_ || blocks_[target].predecessors_.size() != 1 || has_phi(target))
+                break;
+            it.instructions_.pop_back();
+            for (const auto successor : blocks_[target].successors_)
+                for (auto& inst : blocks_[successor].instructions_)
+                    if (inst.is_phi())
+                        for (auto& arg : inst.args())
+                            if (arg == operand::make_block(target))
+                                arg = operand::make_block(it.id_);
+            auto& instructions = blocks_[target].instructions_;
+            it.instructions_.insert(it.instructions_.end(), instructions.begin(), instructions.end());
+            instructions.clear();
+            instructions.emplace_back(instruction::opcode::jmp, operand(), std::vector<operand>{ operand::make_block(target) });
+            update_cfg();
+        }
+    remove_unreachable_blocks();
+}
+
+void function::remove_unused_temps() {
+    std::vector<size_t> ids(temps_.size(), temps_.size());
+    for (const auto& block : blocks_)
+        for (const auto& inst : block.instructions_) {
+            if (inst.result().is(operand::kind::temp))
+                ids[inst.result().id()] = 0;
+            for (const auto& arg : inst.args())
+                if (arg.is(operand::kind::temp))
+                    ids[arg.id()] = 0;
+        }
+    std::vector<value_type> temps;
+    for (size_t i = 0; i < temps_.size(); ++i)
+        if (ids[i] != temps_.size()) {
+            ids[i] = temps.size();
+            temps.push_back(temps_[i]);
+        }
+    for (auto& block : blocks_)
+        for (auto& inst : block.instructions_) {
+            if (inst.result().is(operand::kind::temp))
+                inst.result() = operand::make_temp(ids[inst.result().id()], inst.result().type());
+            for (auto& arg : inst.args())
+                if (arg.is(operand::kind::temp))
+                    arg = operand::make_temp(ids[arg.id()], arg.type());
+        }
+    temps_ = std::move(temps);
+}
+
+std::string function::to_string() const {
+    auto result = str(boost::format("function %1% (%2%), depth %3%\n") % name_ % label_ % depth_);
+    for (size_t i = 0; i < variables_.size(); ++i)
+        result += str(boost::format("    v%1%: %2% %3% [level %4%, offset %5%]\n") % i % variables_[i].name %
+            value_type_str[static_cast<unsigned char>(variables_[i].type)] % variables_[i].level % variables_[i].offset);
+    for (size_t i = 0; i < temps_.size(); ++i)
+        result += str(boost::format("    t%1%: %2%\n") % i % value_type_str[static_cast<unsigned char>(temps_[i])]);
+    for (const auto& it : blocks_)
+        result += it.to_string();
+    return result;
+}
+
+// class module
+size_t module::add_function(const function_p& function) {
+    functions_.push_back(function);
+    return functions_.size() - 1;
+}
+
+const function_p& module::get_function(const size_t id) const { return functions_[id]; }
+
+const std::vector<function_p>& module::functions() const { return functions_; }
+
+const function_p& module::main() const { return functions_.front(); }
+
+size_t module::add_string(const std::string& value) {
+    const auto it = find(strings_.begin(), strings_.end(), value);
+    if (it != strings_.end())
+        return it - strings_.begin();
+    strings_.push_back(value);
+    return strings_.size() - 1;
+}
+
+const std::vector<std::string>& module::strings() const { return strings_; }
+
+std::string module::to_string() const {
+    std::string result;
+    for (size_t i = 0; i < strings_.size(); ++i)
+        result += str(boost::format("s%1% = \"%2%\"\n") % i % strings_[i]);
+    for (size_t i = 0; i < functions_.size(); ++i)
+        result += str(boost::format("f%1% = ") % i) + functions_[i]->to_string() + '\n';
+    return result;
+}
@@ -0,0 +1,210 @@
+#pragma once
+#include "type.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace ir {
+
+        using namespace syntax_analyzer::types;
+
+        enum class value_type : unsigned char {
+            none, character, integer, real, pointer, packed_integer, packed_real
+        };
+
+        value_type get_value_type(const type_p& type);
+        bool is_packed(const value_type type);
+        type_p resolve_type(const type_p& type);
+
+        class operand {
+
+        public:
+
+            enum class kind : unsigned char {
+                none, temp, variable, integer, real, string, function, block
+            };
+
+            operand() = default;
+
+            static operand make_temp(const size_t id, const value_type type);
+            static operand make_variable(const size_t id, const value_type type);
+            static operand make_integer(const long long value, const value_type type = value_type::integer);
+            static operand make_real(const double value);
+            static operand make_string(const size_t id);
+            static operand make_function(const size_t id);
+            static operand make_block(const size_t id);
+
+            kind get_kind() const;
+            bool is(const kind kind) const;
+            bool is_constant() const;
+            value_type type() const;
+            size_t id() const;
+            long long int_value() const;
+            double real_value() const;
+            std::string to_string() const;
+
+            bool operator==(const operand& other) const;
+            bool operator!=(const operand& other) const;
+
+        private:
+
+            operand(const kind kind, const value_type type) : kind_(kind), type_(type) {}
+
+            kind kind_ = kind::none;
+            value_type type_ = value_type::none;
+            size_t id_ = 0;
+            long long int_value_ = 0;
+            double real_value_ = 0;
+
+        };// class operand
+
+        class instruction {
+
+        public:
+
+            enum class opcode : unsigned char {
+                mov, add, sub, mul, div, mod, and, or, xor, shl, shr, neg, not,
+                eq, ne, lt, le, gt, ge, cast, addr, load, store, copy,
+                call, write, jmp, br, ret, phi, splat, reduce
+            };
+
+            static const std::string opcode_str[];
+
+            instruction(const opcode op, const operand& result, const std::vector<operand>& args = {}) :
+                op_(op), result_(result), args_(args) {}
+
+            opcode op() const;
+            const operand& result() const;
+            operand& result();
+            const std::vector<operand>& args() const;
+            std::vector<operand>& args();
+            bool is_terminator() const;
+            bool is_phi() const;
+            bool has_side_effects() const;
+            std::string to_string() const;
+
+        private:
+
+            opcode op_;
+            operand result_;
+            std::vector<operand> args_;
+
+        };// class instruction
+
+        class basic_block {
+
+        public:
+
+            explicit basic_block(const size_t id) : id_(id) {}
+
+            size_t id() const;
+            const std::vector<instruction>& instructions() const;
+            std::vector<instruction>& instructions();
+            const std::vector<size_t>& successors() const;
+            const std::vector<size_t>& predecessors() const;
+            bool is_terminated() const;
+            std::string to_string() const;
+
+        private:
+
+            friend class function;
+
+            size_t id_;
+            std::vector<instruction> instructions_;
+            std::vector<size_t> successors_, predecessors_;
+
+        };// class basic_block
+
+        class function;
+        typedef std::shared_ptr<function> function_p;
+
+        class function {
+
+        public:
+
+            struct variable_t {
+                std::string name;
+                value_type type;
+                size_t level;
+                long long offset;
+            };
+
+            struct parameter_t {
+                value_type type;
+                size_t size;
+                bool is_reference;
+            };
+
+            function(const std::string& name, const std::string& label, const size_t depth,
+                const function_type_p& type, const std::pair<int, int>& position);
+
+            const std::string& name() const;
+            const std::string& label() const;
+            size_t depth() const;
+            const function_type_p& type() const;
+            const std::pair<int, int>& position() const;
+            value_type return_type() const;
+            const std::vector<parameter_t>& parameters() const;
+
+            size_t add_block();
+            basic_block& block(const size_t id);
+            const basic_block& block(const size_t id) const;
+            std::vector<basic_block>& blocks();
+            const std::vector<basic_block>& blocks() const;
+
+            operand new_temp(const value_type type);
+            const std::vector<value_type>& temps() const;
+            size_t add_variable(const variable_t& variable);
+            const std::vector<variable_t>& variables() const;
+
+            void add_nested(const size_t id);
+            const std::vector<size_t>& nested() const;
+
+            void update_cfg();
+            void remove_unreachable_blocks();
+            void reorder_blocks(const std::vector<size_t>& order);
+            void simplify_cfg();
+            void remove_unused_temps();
+            std::string to_string() const;
+
+        private:
+
+            std::string name_, label_;
+            size_t depth_;
+            function_type_p type_;
+            std::pair<int, int> position_;
+            value_type return_type_;
+            std::vector<parameter_t> parameters_;
+            std::vector<basic_block> blocks_;
+            std::vector<value_type> temps_;
+            std::vector<variable_t> variables_;
+            std::vector<size_t> nested_;
+
+        };// class function
+
+        class module {
+
+        public:
+
+            module() = default;
+
+            size_t add_function(const function_p& function);
+            const function_p& get_function(const size_t id) const;
+            const std::vector<function_p>& functions() const;
+            const function_p& main() const;
+            size_t add_string(const std::string& value);
+            const std::vector<std::string>& strings() const;
+            std::string to_string() const;
+
+        private:
+
+            std::vector<function_p> functions_;
+            std::vector<std::string> strings_;
+
+        };// class module
+
+    }// namespace ir
+
+}// namespace pascal_compiler
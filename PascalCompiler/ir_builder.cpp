@@ -0,0 +1,765 @@
+#include "ir_builder.hpp"
+#include "operations.hpp"
+#include "asm_code.hpp"
+#include <algorithm>
+
+using namespace pascal_compiler;
+using namespace ir;
+
+static const std::unordered_map<tokenizer::token::sub_types, instruction::opcode> binary_opcodes = {
+    { tokenizer::token::sub_types::plus, instruction::opcode::add },
+    { tokenizer::token::sub_types::minus, instruction::opcode::sub },
+    { tokenizer::token::sub_types::mult, instruction::opcode::mul },
+    { tokenizer::token::sub_types::divide, instruction::opcode::div },
+    { tokenizer::token::sub_types::div, instruction::opcode::div },
+    { tokenizer::token::sub_types::mod, instruction::opcode::mod },
+    { tokenizer::token::sub_types::and, instruction::opcode::and },
+    { tokenizer::token::sub_types::or, instruction::opcode::or },
+    { tokenizer::token::sub_types::xor, instruction::opcode::xor },
+    { tokenizer::token::sub_types::shift_left, instruction::opcode::shl },
+    { tokenizer::token::sub_types::shift_right, instruction::opcode::shr },
+    { tokenizer::token::sub_types::equal, instruction::opcode::eq },
+    { tokenizer::token::sub_types::not_equal, instruction::opcode::ne },
+    { tokenizer::token::sub_types::less, instruction::opcode::lt },
+    { tokenizer::token::sub_types::less_equal, instruction::opcode::le },
+    { tokenizer::token::sub_types::greater, instruction::opcode::gt },
+    { tokenizer::token::sub_types::greater_equal, instruction::opcode::ge },
+    { tokenizer::token::sub_types::plus_assign, instruction::opcode::add },
+    { tokenizer::token::sub_types::minus_assign, instruction::opcode::sub },
+    { tokenizer::token::sub_types::mult_assign, instruction::opcode::mul },
+    { tokenizer::token::sub_types::divide_assign, instruction::opcode::div }
+};
+
+module builder::build(const symbols_table& table) {
+    module_ = module();
+    functions_.clear();
+    const auto& main = table.vector()[3];
+    build_function(main.first, main.second, std::make_pair(0, 0));
+    return std::move(module_);
+}
+
+void builder::build_function(const std::string& name, const symbols_table::symbol_t& symbol,
+    const std::pair<int, int>& position) {
+    const auto type = std::dynamic_pointer_cast<function_type>(symbol.first);
+    const auto f = std::make_shared<function>(name, asm_code::wrap_function_name(name, position.first, position.second),
+        scopes_.size() + 1, type, position);
+    const auto id = module_.add_function(f);
+    functions_[type.get()] = id;
+    scopes_.push_back(type);
+    for (const auto& it : type->table().vector())
+        if (it.second.first->is_category(type::type_category::function)) {
+            f->add_nested(module_.functions().size());
+            build_function(it.first, it.second, it.second.second->position());
+        }
+    function_ = f;
+    order_.clear();
+    set_block(new_block());
+    lower_statement(symbol.second);
+    finish_function();
+    scopes_.pop_back();
+}
+
+void builder::finish_function() {
+    if (!function_->block(block_).is_terminated())
+        emit(instruction::opcode::ret, operand());
+    function_->reorder_blocks(order_);
+    function_->remove_unreachable_blocks();
+}
+
+size_t builder::new_block() {
+    return function_->add_block();
+}
+
+void builder::set_block(const size_t id) {
+    block_ = id;
+    order_.push_back(id);
+}
+
+void builder::emit(const instruction::opcode op, const operand& result, const std::vector<operand>& args) {
+    if (function_->block(block_).is_terminated())
+        set_block(new_block());
+    function_->block(block_).instructions().emplace_back(op, result, args);
+}
+
+operand builder::emit_value(const instruction::opcode op, const value_type type, const std::vector<operand>& args) {
+    const auto result = function_->new_temp(type);
+    emit(op, result, args);
+    return result;
+}
+
+void builder::emit_jump(const size_t target) {
+    emit(instruction::opcode::jmp, operand(), { operand::make_block(target) });
+}
+
+bool builder::has_calls(const tree_node_p& node) {
+    if (!node)
+        return false;
+    if (node->category() == tree_node::node_category::call)
+        return true;
+    for (const auto& it : node->children())
+        if (has_calls(it))
+            return true;
+    return false;
+}
+
+bool builder::assigns(const tree_node_p& node, const std::string& name) {
+    if (!node)
+        return false;
+    if (node->category() == tree_node::node_category::for_op && node->children()[0]->name() == name)
+        return true;
+    const auto operation = std::dynamic_pointer_cast<operation_node>(node);
+    if (operation && operation->is_assign() && operation->left()->name() == name)
+        return true;
+    for (const auto& it : node->children())
+        if (assigns(it, name))
+            return true;
+    return false;
+}
+
+size_t builder::count_nodes(const tree_node_p& node) {
+    if (!node)
+        return 0;
+    size_t result = 1;
+    for (const auto& it : node->children())
+        result += count_nodes(it);
+    return result;
+}
+
+tree_node_p builder::get_single_statement(const tree_node_p& node) {
+    auto result = node;
+    while (result && result->category() == tree_node::node_category::null && result->name() != "read" &&
+        result->children().size() == 1)
+        result = result->children()[0];
+    return result;
+}
+
+tree_node_p builder::find_index(const tree_node_p& node) {
+    if (!node || node->category() == tree_node::node_category::index)
+        return node;
+    for (const auto& it : node->children()) {
+        const auto result = find_index(it);
+        if (result)
+            return result;
+    }
+    return nullptr;
+}
+
+bool builder::is_invariant(const tree_node_p& node, const std::string& counter, const std::string& target) {
+    switch (node->category()) {
+    case tree_node::node_category::constant:
+        return true;
+    case tree_node::node_category::variable:
+    {
+        const auto variable = std::dynamic_pointer_cast<variable_node>(node);
+        return variable->name() != counter && variable->name() != target && !is_reference(variable->type()) &&
+            resolve_type(variable->type())->is_scalar();
+    }
+    case tree_node::node_category::cast:
+        return is_invariant(node->children()[0], counter, target);
+    case tree_node::node_category::operation:
+    {
+        const auto operation = std::dynamic_pointer_cast<operation_node>(node);
+        return is_invariant(operation->left(), counter, target) &&
+            (!operation->right() || is_invariant(operation->right(), counter, target));
+    }
+    default:
+        return false;
+    }
+}
+
+bool builder::is_vectorizable(const tree_node_p& node, const std::string& counter, const std::string& target,
+    const value_type type) {
+    if (get_value_type(get_type(node)) != type)
+        return false;
+    if (is_invariant(node, counter, target))
+        return true;
+    if (node->category() == tree_node::node_category::index) {
+        const auto index = std::dynamic_pointer_cast<index_node>(node);
+        return index->index()->category() == tree_node::node_category::variable && index->index()->name() == counter &&
+            index->variable()->category() == tree_node::node_category::variable;
+    }
+    const auto operation = std::dynamic_pointer_cast<operation_node>(node);
+    if (!operation || !operation->right())
+        return false;
+    switch (operation->operation_type()) {
+    case tokenizer::token::sub_types::plus:
+    case tokenizer::token::sub_types::minus:
+        break;
+    case tokenizer::token::sub_types::mult:
+    case tokenizer::token::sub_types::divide:
+        if (type == value_type::real)
+            break;
+        [[fallthrough]];
+    default:
+        return false;
+    }
+    return is_vectorizable(operation->left(), counter, target, type) &&
+        is_vectorizable(operation->right(), counter, target, type);
+}
+
+operand builder::stabilize(const operand& value, const tree_node_p& next) {
+    if (!value.is(operand::kind::variable) || !has_calls(next))
+        return value;
+    return emit_value(instruction::opcode::mov, value.type(), { value });
+}
+
+bool builder::is_reference(const type_p& type) {
+    return type->is_category(type::type_category::modified) &&
+        std::dynamic_pointer_cast<modified_type>(type)->is_reference();
+}
+
+type_p builder::get_declaration(const std::string& name) const {
+    for (auto i = scopes_.size(); i > 0; --i) {
+        const auto& data = scopes_[i - 1]->table();
+        const auto& parameters = scopes_[i - 1]->parameters();
+        if (data.table().find(name) != data.table().end())
+            return data.get_type(name);
+        if (parameters.table().find(name) != parameters.table().end())
+            return parameters.get_type(name);
+    }
+    throw std::logic_error("This point should never be reached");
+}
+
+operand builder::get_variable(const std::string& name, const value_type type) {
+    for (auto i = scopes_.size(); i > 0; --i) {
+        const auto& data = scopes_[i - 1]->table();
+        const auto& parameters = scopes_[i - 1]->parameters();
+        long long offset;
+        if (data.table().find(name) != data.table().end())
+            offset = data.get_offset(name) + slot_size_ * static_cast<long long>(i);
+        else if (parameters.table().find(name) != parameters.table().end())
+            offset = parameters.get_offset(name) - 2 * slot_size_ - parameters.get_data_size();
+        else
+            continue;
+        return operand::make_variable(function_->add_variable({ name, type, i, offset }), type);
+    }
+    throw std::logic_error("This point should never be reached");
+}
+
+void builder::lower_statement(const tree_node_p& node) {
+    if (!node)
+        return;
+    switch (node->category()) {
+    case tree_node::node_category::null:
+        if (node->name() == "read")
+            return;
+        for (const auto& it : node->children())
+            lower_statement(it);
+        return;
+    case tree_node::node_category::operation:
+    {
+        const auto op = std::dynamic_pointer_cast<operation_node>(node);
+        if (op->is_assign())
+            lower_assignment(op);
+        else
+            lower_expression(node);
+        return;
+    }
+    case tree_node::node_category::write:
+        lower_write(node);
+        return;
+    case tree_node::node_category::if_op:
+        lower_if(std::dynamic_pointer_cast<if_node>(node));
+        return;
+    case tree_node::node_category::while_op:
+        lower_while(std::dynamic_pointer_cast<while_node>(node));
+        return;
+    case tree_node::node_category::repeat:
+        lower_repeat(std::dynamic_pointer_cast<repeat_node>(node));
+        return;
+    case tree_node::node_category::for_op:
+        lower_for(std::dynamic_pointer_cast<for_node>(node));
+        return;
+    case tree_node::node_category::break_op:
+        emit_jump(loops_.back().second);
+        return;
+    case tree_node::node_category::continue_op:
+        emit_jump(loops_.back().first);
+        return;
+    case tree_node::node_category::exit:
+        lower_exit(node);
+        return;
+    default:
+        lower_expression(node);
+    }
+}
+
+void builder::lower_assignment(const operation_node_p& node) {
+    const auto type = resolve_type(node->type());
+    const auto left = node->left();
+    if (!type->is_scalar()) {
+        const auto destination = lower_address(left);
+        if (node->right()->category() == tree_node::node_category::call) {
+            lower_call(std::dynamic_pointer_cast<call_node>(node->right()), destination);
+            return;
+        }
+        const auto source = lower_address(node->right());
+        emit(instruction::opcode::copy, operand(),
+            { destination, source, operand::make_integer(type->data_size()) });
+        return;
+    }
+    const auto op = node->operation_type() == tokenizer::token::sub_types::assign
+        ? instruction::opcode::mov
+        : binary_opcodes.at(node->operation_type());
+    if (left->category() == tree_node::node_category::variable &&
+        !is_reference(std::dynamic_pointer_cast<variable_node>(left)->type())) {
+        const auto target = lower_variable(std::dynamic_pointer_cast<variable_node>(left), false);
+        const auto value = lower_expression(node->right());
+        if (op == instruction::opcode::mov)
+            emit(op, target, { value });
+        else
+            emit(op, target, { target, value });
+        return;
+    }
+    const auto address = lower_address(left);
+    auto value = lower_expression(node->right());
+    if (op != instruction::opcode::mov) {
+        const auto old = emit_value(instruction::opcode::load, value.type(), { address });
+        value = emit_value(op, value.type(), { old, value });
+    }
+    emit(instruction::opcode::store, operand(), { address, value });
+}
+
+void builder::lower_write(const tree_node_p& node) {
+    std::vector<operand> args(node->children().size());
+    for (auto i = node->children().size(); i > 0; --i) {
+        args[i - 1] = lower_expression(node->children()[i - 1]);
+        for (size_t j = 0; j + 1 < i; ++j)
+            args[i - 1] = stabilize(args[i - 1], node->children()[j]);
+    }
+    emit(instruction::opcode::write, operand(), args);
+}
+
+void builder::lower_condition(const tree_node_p& node, const size_t on_true, const size_t on_false) {
+    const auto operation = std::dynamic_pointer_cast<operation_node>(node);
+    if (short_circuit_ && operation && operation->is_boolean())
+        switch (operation->operation_type()) {
+        case tokenizer::token::sub_types::not:
+            lower_condition(operation->left(), on_false, on_true);
+            return;
+        case tokenizer::token::sub_types::and:
+        case tokenizer::token::sub_types::or:
+        {
+            const auto next_block = new_block();
+            if (operation->operation_type() == tokenizer::token::sub_types::and)
+                lower_condition(operation->left(), next_block, on_false);
+            else
+                lower_condition(operation->left(), on_true, next_block);
+            set_block(next_block);
+            lower_condition(operation->right(), on_true, on_false);
+            return;
+        }
+        default:
+            break;
+        }
+    const auto condition = lower_expression(node);
+    emit(instruction::opcode::br, operand(),
+        { condition, operand::make_block(on_true), operand::make_block(on_false) });
+}
+
+void builder::lower_if(const if_node_p& node) {
+    const auto then_block = new_block(), end_block = new_block();
+    const auto else_block = node->else_branch() ? new_block() : end_block;
+    lower_condition(node->condition(), then_block, else_block);
+    set_block(then_block);
+    lower_statement(node->then_branch());
+    emit_jump(end_block);
+    if (node->else_branch()) {
+        set_block(else_block);
+        lower_statement(node->else_branch());
+        emit_jump(end_block);
+    }
+    set_block(end_block);
+}
+
+void builder::lower_while(const while_node_p& node) {
+    const auto body_block = new_block(), condition_block = new_block(), end_block = new_block();
+    emit_jump(condition_block);
+    set_block(body_block);
+    loops_.emplace_back(condition_block, end_block);
+    if (node->children().size() > 1)
+        lower_statement(node->body());
+    loops_.pop_back();
+    emit_jump(condition_block);
+    set_block(condition_block);
+    lower_condition(node->condition(), body_block, end_block);
+    set_block(end_block);
+}
+
+void builder::lower_repeat(const repeat_node_p& node) {
+    const auto body_block = new_block(), condition_block = new_block(), end_block = new_block();
+    emit_jump(body_block);
+    set_block(body_block);
+    loops_.emplace_back(condition_block, end_block);
+    lower_statement(node->body());
+    loops_.pop_back();
+    emit_jump(condition_block);
+    set_block(condition_block);
+    lower_condition(node->condition(), end_block, body_block);
+    set_block(end_block);
+}
+
+void builder::lower_for(const for_node_p& node) {
+    auto to = lower_expression(node->to());
+    if (!to.is_constant() && !to.is(operand::kind::temp))
+        to = emit_value(instruction::opcode::mov, to.type(), { to });
+    const auto from = lower_expression(node->from());
+    const auto variable = std::dynamic_pointer_cast<variable_node>(node->children()[0]);
+    const auto reference = is_reference(variable->type());
+    const auto counter = lower_variable(variable, reference);
+    if (!reference && (lower_vectorized_for(node, counter, from, to) || lower_unrolled_for(node, counter, from, to)))
+        return;
+    const auto step = node->is_downto() ? instruction::opcode::add : instruction::opcode::sub;
+    if (reference)
+        emit(instruction::opcode::store, operand(),
+            { counter, emit_value(step, value_type::integer, { from, operand::make_integer(1) }) });
+    else
+        emit(step, counter, { from, operand::make_integer(1) });
+    const auto body_block = new_block(), condition_block = new_block(), end_block = new_block();
+    emit_jump(condition_block);
+    set_block(body_block);
+    loops_.emplace_back(condition_block, end_block);
+    if (node->children().size() > 3)
+        lower_statement(node->body());
+    loops_.pop_back();
+    emit_jump(condition_block);
+    set_block(condition_block);
+    const auto next = node->is_downto() ? instruction::opcode::sub : instruction::opcode::add;
+    operand value = counter;
+    if (reference) {
+        value = emit_value(next, value_type::integer,
+            { emit_value(instruction::opcode::load, value_type::integer, { counter }), operand::make_integer(1) });
+        emit(instruction::opcode::store, operand(), { counter, value });
+    }
+    else
+        emit(next, counter, { counter, operand::make_integer(1) });
+    const auto condition = emit_value(node->is_downto() ? instruction::opcode::ge : instruction::opcode::le,
+        value_type::integer, { value, to });
+    emit(instruction::opcode::br, operand(),
+        { condition, operand::make_block(body_block), operand::make_block(end_block) });
+    set_block(end_block);
+}
+
+bool builder::lower_unrolled_for(const for_node_p& node, const operand& counter, const operand& from, const operand& to) {
+    if (unroll_factor_ < 2 || !from.is(operand::kind::integer) || !to.is(operand::kind::integer) ||
+        node->children().size() <= 3 || has_calls(node->body()) || assigns(node->body(), node->children()[0]->name()))
+        return false;
+    const auto trips = node->is_downto() ? from.int_value() - to.int_value() + 1 : to.int_value() - from.int_value() + 1;
+    const auto size = static_cast<long long>(count_nodes(node->body()));
+    const auto full = trips <= static_cast<long long>(max_unrolled_trips) && trips * size <= static_cast<long long>(max_unrolled_size);
+    auto factor = static_cast<long long>(unroll_factor_);
+    while (factor > 1 && factor * size > static_cast<long long>(max_unrolled_size))
+        factor /= 2;
+    if (!full && factor < 2)
+        return false;
+    const auto end_block = new_block();
+    emit(instruction::opcode::mov, counter, { from });
+    if (full) {
+        lower_unrolled_body(node, counter, trips > 0 ? static_cast<size_t>(trips) : 0, end_block);
+        emit_jump(end_block);
+        set_block(end_block);
+        return true;
+    }
+    const auto iterations = trips / factor * factor;
+    const auto body_block = new_block(), remainder_block = new_block();
+    emit_jump(body_block);
+    set_block(body_block);
+    lower_unrolled_body(node, counter, static_cast<size_t>(factor), end_block);
+    const auto condition = emit_value(node->is_downto() ? instruction::opcode::gt : instruction::opcode::lt,
+        value_type::integer, { counter, operand::make_integer(node->is_downto()
+            ? from.int_value() - iterations
+            : from.int_value() + iterations, counter.type()) });
+    emit(instruction::opcode::br, operand(),
+        { condition, operand::make_block(body_block), operand::make_block(remainder_block) });
+    set_block(remainder_block);
+    lower_unrolled_body(node, counter, static_cast<size_t>(trips - iterations), end_block);
+    emit_jump(end_block);
+    set_block(end_block);
+    return true;
+}
+
+void builder::lower_unrolled_body(const for_node_p& node, const operand& counter, const size_t count, const size_t end_block) {
+    const auto next = node->is_downto() ? instruction::opcode::sub : instruction::opcode::add;
+    for (size_t i = 0; i < count; ++i) {
+        const auto continue_block = new_block();
+        loops_.emplace_back(continue_block, end_block);
+        lower_statement(node->body());
+        loops_.pop_back();
+        emit_jump(continue_block);
+        set_block(continue_block);
+        emit(next, counter, { counter, operand::make_integer(1) });
+    }
+}
+
+bool builder::lower_vectorized_for(const for_node_p& node, const operand& counter, const operand& from, const operand& to) {
+    if (!vectorize_ || node->is_downto() || node->children().size() <= 3 || has_calls(node->body()))
+        return false;
+    const auto statement = std::dynamic_pointer_cast<operation_node>(get_single_statement(node->body()));
+    if (!statement || !statement->is_assign())
+        return false;
+    const auto& name = node->children()[0]->name();
+    const auto left = statement->left();
+    const auto type = get_value_type(get_type(left));
+    if (type != value_type::integer && type != value_type::real)
+        return false;
+    auto op = statement->operation_type() == tokenizer::token::sub_types::assign
+        ? instruction::opcode::mov
+        : binary_opcodes.at(statement->operation_type());
+    auto value = statement->right();
+    tree_node_p aligned;
+    std::string target;
+    if (left->category() == tree_node::node_category::index) {
+        if (!is_vectorizable(left, name, target, type) ||
+            (type != value_type::real && (op == instruction::opcode::mul || op == instruction::opcode::div)))
+            return false;
+        aligned = left;
+    }
+    else if (left->category() == tree_node::node_category::variable && left->name() != name &&
+        !is_reference(std::dynamic_pointer_cast<variable_node>(left)->type())) {
+        if (op == instruction::opcode::mov) {
+            const auto sum = std::dynamic_pointer_cast<operation_node>(value);
+            if (!sum || !sum->right() || sum->left()->category() != tree_node::node_category::variable ||
+                sum->left()->name() != left->name() || (sum->operation_type() != tokenizer::token::sub_types::plus &&
+                sum->operation_type() != tokenizer::token::sub_types::minus))
+                return false;
+            op = binary_opcodes.at(sum->operation_type());
+            value = sum->right();
+        }
+        if ((op != instruction::opcode::add && op != instruction::opcode::sub) || (type == value_type::real && !fast_math_))
+            return false;
+        target = left->name();
+        aligned = find_index(value);
+    }
+    if (!aligned || !is_vectorizable(value, name, target, type))
+        return false;
+    const auto lanes = type == value_type::real ? 2 : 4;
+    if (from.is(operand::kind::integer) && to.is(operand::kind::integer) && to.int_value() - from.int_value() < 2 * lanes - 1)
+        return false;
+    const auto packed = type == value_type::real ? value_type::packed_real : value_type::packed_integer;
+    const auto peel_block = new_block(), align_block = new_block(), peel_body_block = new_block(),
+        vector_condition_block = new_block(), vector_block = new_block(), epilogue_condition_block = new_block(),
+        epilogue_block = new_block(), end_block = new_block();
+    emit(instruction::opcode::mov, counter, { from });
+    const auto limit = emit_value(instruction::opcode::add, value_type::integer, { from, operand::make_integer(lanes - 1) });
+    emit_jump(peel_block);
+    set_block(peel_block);
+    emit(instruction::opcode::br, operand(), { emit_value(instruction::opcode::le, value_type::integer, { counter, to }),
+        operand::make_block(align_block), operand::make_block(end_block) });
+    set_block(align_block);
+    const auto misaligned = emit_value(instruction::opcode::ne, value_type::integer, {
+        emit_value(instruction::opcode::and, value_type::integer, { lower_address(aligned), operand::make_integer(15) }),
+        operand::make_integer(0) });
+    const auto peel = emit_value(instruction::opcode::and, value_type::integer,
+        { misaligned, emit_value(instruction::opcode::lt, value_type::integer, { counter, limit }) });
+    emit(instruction::opcode::br, operand(),
+        { peel, operand::make_block(peel_body_block), operand::make_block(vector_condition_block) });
+    set_block(peel_body_block);
+    lower_statement(statement);
+    emit(instruction::opcode::add, counter, { counter, operand::make_integer(1) });
+    emit_jump(peel_block);
+    set_block(vector_condition_block);
+    const auto last = emit_value(instruction::opcode::add, value_type::integer, { counter, operand::make_integer(lanes - 1) });
+    emit(instruction::opcode::br, operand(), { emit_value(instruction::opcode::le, value_type::integer, { last, to }),
+        operand::make_block(vector_block), operand::make_block(epilogue_condition_block) });
+    set_block(vector_block);
+    if (target.empty()) {
+        const auto address = lower_address(left);
+        auto result = lower_vector_expression(value, packed);
+        if (op != instruction::opcode::mov)
+            result = emit_value(op, packed, { emit_value(instruction::opcode::load, packed, { address }), result });
+        emit(instruction::opcode::store, operand(), { address, result });
+    }
+    else {
+        const auto sum = emit_value(instruction::opcode::reduce, type, { lower_vector_expression(value, packed) });
+        const auto variable = lower_variable(std::dynamic_pointer_cast<variable_node>(left), false);
+        emit(op, variable, { variable, sum });
+    }
+    emit(instruction::opcode::add, counter, { counter, operand::make_integer(lanes) });
+    emit_jump(vector_condition_block);
+    set_block(epilogue_condition_block);
+    emit(instruction::opcode::br, operand(), { emit_value(instruction::opcode::le, value_type::integer, { counter, to }),
+        operand::make_block(epilogue_block), operand::make_block(end_block) });
+    set_block(epilogue_block);
+    lower_statement(statement);
+    emit(instruction::opcode::add, counter, { counter, operand::make_integer(1) });
+    emit_jump(epilogue_condition_block);
+    set_block(end_block);
+    return true;
+}
+
+operand builder::lower_vector_expression(const tree_node_p& node, const value_type type) {
+    if (!find_index(node))
+        return emit_value(instruction::opcode::splat, type, { lower_expression(node) });
+    if (node->category() == tree_node::node_category::index)
+        return emit_value(instruction::opcode::load, type, { lower_address(node) });
+    const auto operation = std::dynamic_pointer_cast<operation_node>(node);
+    const auto left = lower_vector_expression(operation->left(), type);
+    const auto right = lower_vector_expression(operation->right(), type);
+    return emit_value(binary_opcodes.at(operation->operation_type()), type, { left, right });
+}
+
+void builder::lower_exit(const tree_node_p& node) {
+    if (!node->children().empty()) {
+        emit(instruction::opcode::ret, operand(), { lower_expression(node->children()[0]) });
+        return;
+    }
+    const auto type = function_->type()->return_type();
+    if (type->is_category(type::type_category::nil)) {
+        emit(instruction::opcode::ret, operand());
+        return;
+    }
+    const auto result = get_variable("result", type->is_scalar() ? get_value_type(type) : value_type::none);
+    emit(instruction::opcode::ret, operand(), { type->is_scalar()
+        ? result
+        : emit_value(instruction::opcode::addr, value_type::pointer, { result }) });
+}
+
+operand builder::lower_expression(const tree_node_p& node) {
+    switch (node->category()) {
+    case tree_node::node_category::variable:
+        return lower_variable(std::dynamic_pointer_cast<variable_node>(node), false);
+    case tree_node::node_category::constant:
+        return lower_constant(std::dynamic_pointer_cast<constant_node>(node));
+    case tree_node::node_category::operation:
+        return lower_operation(std::dynamic_pointer_cast<operation_node>(node));
+    case tree_node::node_category::cast:
+        return lower_cast(std::dynamic_pointer_cast<cast_node>(node));
+    case tree_node::node_category::call:
+        return lower_call(std::dynamic_pointer_cast<call_node>(node));
+    case tree_node::node_category::index:
+    case tree_node::node_category::field_access:
+    {
+        const auto address = lower_address(node);
+        const auto type = get_value_type(get_type(node));
+        if (type == value_type::pointer)
+            return address;
+        return emit_value(instruction::opcode::load, type, { address });
+    }
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+operand builder::lower_address(const tree_node_p& node) {
+    switch (node->category()) {
+    case tree_node::node_category::variable:
+        return lower_variable(std::dynamic_pointer_cast<variable_node>(node), true);
+    case tree_node::node_category::call:
+        return lower_call(std::dynamic_pointer_cast<call_node>(node));
+    case tree_node::node_category::index:
+    {
+        const auto n = std::dynamic_pointer_cast<index_node>(node);
+        const auto index = stabilize(lower_expression(n->index()), n->variable());
+        const auto base = lower_address(n->variable());
+        const auto a = std::dynamic_pointer_cast<array_type>(resolve_type(get_type(n->variable())));
+        auto offset = index;
+        if (a->min() != 0)
+            offset = emit_value(instruction::opcode::sub, value_type::integer,
+                { offset, operand::make_integer(a->min()) });
+        const auto size = resolve_type(n->type())->data_size();
+        if (size != 1)
+            offset = emit_value(instruction::opcode::mul, value_type::integer,
+                { offset, operand::make_integer(size) });
+        return emit_value(instruction::opcode::add, value_type::pointer, { base, offset });
+    }
+    case tree_node::node_category::field_access:
+    {
+        const auto n = std::dynamic_pointer_cast<field_access_node>(node);
+        const auto base = lower_address(n->variable());
+        const auto r = std::dynamic_pointer_cast<record_type>(resolve_type(get_type(n->variable())));
+        const auto offset = r->get_field_offset(n->field()->name());
+        if (offset == 0)
+            return base;
+        return emit_value(instruction::opcode::add, value_type::pointer, { base, operand::make_integer(offset) });
+    }
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+operand builder::lower_variable(const variable_node_p& node, const bool address) {
+    const auto type = node->type();
+    if (is_reference(get_declaration(node->name()))) {
+        const auto pointer = get_variable(node->name(), value_type::pointer);
+        const auto result_type = get_value_type(type);
+        if (address || result_type == value_type::pointer)
+            return pointer;
+        return emit_value(instruction::opcode::load, result_type, { pointer });
+    }
+    if (!address && type->is_category(type::type_category::modified) && node->value() &&
+        node->value()->category() == tree_node::node_category::constant) {
+        const auto value = lower_constant(std::dynamic_pointer_cast<constant_node>(node->value()));
+        const auto result_type = get_value_type(type);
+        if (value.type() == result_type)
+            return value;
+        return emit_value(instruction::opcode::cast, result_type, { value });
+    }
+    const auto resolved = resolve_type(type);
+    if (resolved->is_scalar() && !address)
+        return get_variable(node->name(), get_value_type(resolved));
+    const auto variable = get_variable(node->name(), resolved->is_scalar() ? get_value_type(resolved) : value_type::none);
+    return emit_value(instruction::opcode::addr, value_type::pointer, { variable });
+}
+
+operand builder::lower_constant(const constant_node_p& node) {
+    switch (node->type()->category()) {
+    case type::type_category::integer:
+        return operand::make_integer(node->get_value<long long>());
+    case type::type_category::real:
+        return operand::make_real(node->get_value<double>());
+    case type::type_category::character:
+        return operand::make_integer(node->get_value<char>(), value_type::character);
+    case type::type_category::string:
+        return operand::make_string(module_.add_string(node->value_string()));
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+operand builder::lower_operation(const operation_node_p& node) {
+    const auto left = lower_expression(node->left());
+    if (!node->right()) {
+        switch (node->operation_type()) {
+        case tokenizer::token::sub_types::minus:
+            return emit_value(instruction::opcode::neg, left.type(), { left });
+        case tokenizer::token::sub_types::not:
+            return emit_value(instruction::opcode::not, left.type(), { left });
+        default:
+            return left;
+        }
+    }
+    const auto stable = stabilize(left, node->right());
+    const auto right = lower_expression(node->right());
+    const auto op = binary_opcodes.at(node->operation_type());
+    return emit_value(op, is_relational(node->operation_type()) ? value_type::integer : get_value_type(node->type()),
+        { stable, right });
+}
+
+operand builder::lower_cast(const cast_node_p& node) {
+    const auto value = lower_expression(node->children()[0]);
+    const auto type = get_value_type(node->type());
+    if (value.type() == type)
+        return value;
+    return emit_value(instruction::opcode::cast, type, { value });
+}
+
+operand builder::lower_call(const call_node_p& node, const operand& destination) {
+    const auto type = std::dynamic_pointer_cast<function_type>(std::dynamic_pointer_cast<typed>(node->variable())->type());
+    const auto id = functions_.at(type.get());
+    const auto& parameters = module_.get_function(id)->parameters();
+    const auto& args = node->children()[1]->children();
+    std::vector<operand> operands = { operand::make_function(id) };
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        const auto arg = i < args.size() ? args[i] : type->parameters().vector()[i].second.second;
+        auto value = parameters[i].is_reference ? lower_address(arg) : lower_expression(arg);
+        for (auto j = i + 1; j < args.size(); ++j)
+            value = stabilize(value, args[j]);
+        operands.push_back(value);
+    }
+    if (!destination.is(operand::kind::none))
+        operands.push_back(destination);
+    const auto result_type = get_value_type(type->return_type());
+    const auto result = result_type == value_type::none ? operand() : function_->new_temp(result_type);
+    emit(instruction::opcode::call, result, operands);
+    return result;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "ir.hpp"
+#include "tree.hpp"
+#include "symbols_table.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace ir {
+
+        using namespace syntax_analyzer;
+        using namespace syntax_analyzer::tree;
+
+        class builder {
+
+        public:
+
+            explicit builder(const bool short_circuit = false, const size_t unroll_factor = 0,
+                const bool vectorize = false, const bool fast_math = false, const long long slot_size = 4) :
+                short_circuit_(short_circuit), unroll_factor_(unroll_factor), vectorize_(vectorize), fast_math_(fast_math),
+                slot_size_(slot_size) {}
+
+            module build(const symbols_table& table);
+
+        private:
+
+            static const size_t max_unrolled_trips = 16;
+            static const size_t max_unrolled_size = 256;
+
+            bool short_circuit_;
+            size_t unroll_factor_;
+            bool vectorize_;
+            bool fast_math_;
+            long long slot_size_;
+            module module_;
+            function_p function_;
+            size_t block_ = 0;
+            std::vector<size_t> order_;
+            std::vector<function_type_p> scopes_;
+            std::unordered_map<const type*, size_t> functions_;
+            std::vector<std::pair<size_t, size_t>> loops_;
+
+            void build_function(const std::string& name, const symbols_table::symbol_t& symbol,
+                const std::pair<int, int>& position);
+            void finish_function();
+
+            size_t new_block();
+            void set_block(const size_t id);
+            void emit(const instruction::opcode op, const operand& result, const std::vector<operand>& args = {});
+            operand emit_value(const instruction::opcode op, const value_type type, const std::vector<operand>& args);
+            void emit_jump(const size_t target);
+
+            static bool has_calls(const tree_node_p& node);
+            static bool assigns(const tree_node_p& node, const std::string& name);
+            static size_t count_nodes(const tree_node_p& node);
+            static tree_node_p get_single_statement(const tree_node_p& node);
+            static tree_node_p find_index(const tree_node_p& node);
+            static bool is_invariant(const tree_node_p& node, const std::string& counter, const std::string& target);
+            static bool is_vectorizable(const tree_node_p& node, const std::string& counter, const std::string& target,
+                const value_type type);
+            operand stabilize(const operand& value, const tree_node_p& next);
+            operand get_variable(const std::string& name, const value_type type);
+            static bool is_reference(const type_p& type);
+            type_p get_declaration(const std::string& name) const;
+
+            void lower_statement(const tree_node_p& node);
+            void lower_assignment(const operation_node_p& node);
+            void lower_write(const tree_node_p& node);
+            void lower_condition(const tree_node_p& node, const size_t on_true, const size_t on_false);
+            void lower_if(const if_node_p& node);
+            void lower_while(const while_node_p& node);
+            void lower_repeat(const repeat_node_p& node);
+            void lower_for(const for_node_p& node);
+            bool lower_unrolled_for(const for_node_p& node, const operand& counter, const operand& from, const operand& to);
+            void lower_unrolled_body(const for_node_p& node, const operand& counter, const size_t count, const size_t end_block);
+            bool lower_vectorized_for(const for_node_p& node, const operand& counter, const operand& from, const operand& to);
+            operand lower_vector_expression(const tree_node_p& node, const value_type type);
+            void lower_exit(const tree_node_p& node);
+            operand lower_expression(const tree_node_p& node);
+            operand lower_address(const tree_node_p& node);
+            operand lower_variable(const variable_node_p& node, const bool address);
+            operand lower_constant(const constant_node_p& node);
+            operand lower_operation(const operation_node_p& node);
+            operand lower_cast(const cast_node_p& node);
+            operand lower_call(const call_node_p& node, const operand& destination = operand());
+
+        };// class builder
+
+    }// namespace ir
+
+}// namespace pascal_compiler
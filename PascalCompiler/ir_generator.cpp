@@ -0,0 +1,848 @@
+#include "ir_generator.hpp"
+
+using namespace pascal_compiler;
+using namespace ir;
+
+void generator::generate(const module& module) {
+    module_ = &module;
+    generate_function(0);
+}
+
+void generator::generate_function(const size_t id) {
+    const auto f = module_->get_function(id);
+    code_.start_function(f->name(), f->position().first, f->position().second, f->type()->table(), f->type()->parameters());
+    for (const auto it : f->nested())
+        generate_function(it);
+    function_ = f;
+    allocator_ = allocate_registers_
+        ? std::make_shared<register_allocator>(*f, code_.get_target() == asm_code::target::x86_64)
+        : nullptr;
+    temp_offsets_.clear();
+    saved_registers_.clear();
+    stack_pointer_slot_ = 0;
+    block_labels_.clear();
+    for (const auto& it : f->blocks())
+        block_labels_.emplace(it.id(), code_.new_label());
+    const auto base = code_.slot_size() * static_cast<long long>(f->depth()) + f->type()->table().get_data_size();
+    long long size = 0;
+    for (size_t i = 0; i < f->temps().size(); ++i) {
+        const auto type = f->temps()[i];
+        if (!allocator_ || !allocator_->has_register(operand::make_temp(i, type)))
+            size += type == value_type::real ? 8 : is_packed(type) ? 16 : 4;
+        temp_offsets_.push_back(base + size);
+    }
+    if (allocator_)
+        for (const auto it : allocator_->used_registers())
+            if (!register_allocator::is_real_register(it)) {
+                size += 4;
+                saved_registers_.push_back({ it, base + size });
+            }
+    code_.add_frame_size(size);
+    for (const auto& it : saved_registers_)
+        code_.push_back({ asm_command::type::mov, { code_.frame_pointer(), asm_mem::mem_size::dword, -it.second }, it.first });
+    for (const auto& it : f->blocks()) {
+        block_ = it.id();
+        code_.push_back({ asm_command::type::label, block_label(it.id()) });
+        for (const auto& inst : it.instructions())
+            generate_instruction(inst);
+    }
+    code_.end_function();
+}
+
+asm_label generator::block_label(const size_t id) const {
+    return block_labels_.at(id);
+}
+
+asm_mem::mem_size generator::get_mem_size(const value_type type) {
+    switch (type) {
+    case value_type::character:
+        return asm_mem::mem_size::byte;
+    case value_type::real:
+        return asm_mem::mem_size::qword;
+    case value_type::packed_integer:
+    case value_type::packed_real:
+        return asm_mem::mem_size::xmmword;
+    default:
+        return asm_mem::mem_size::dword;
+    }
+}
+
+asm_command::type generator::get_packed_move(const value_type type) {
+    return type == value_type::packed_real ? asm_command::type::movupd : asm_command::type::movdqu;
+}
+
+asm_operand generator::location(const operand& value, const asm_mem::mem_size size, const long long offset) {
+    if (value.is(operand::kind::temp))
+        return { code_.frame_pointer(), size, offset - temp_offsets_[value.id()] };
+    const auto& variable = function_->variables()[value.id()];
+    if (variable.level == function_->depth())
+        return { code_.frame_pointer(), size, offset - variable.offset };
+    code_.push_back({ asm_command::type::mov, asm_reg::reg_type::ecx,
+        { code_.frame_pointer(), asm_mem::mem_size::dword, -code_.slot_size() * static_cast<long long>(variable.level) } });
+    return { asm_reg::reg_type::ecx, size, offset - variable.offset };
+}
+
+bool generator::in_register(const operand& value) const {
+    return allocator_ && allocator_->has_register(value);
+}
+
+asm_reg::reg_type generator::target(const operand& result, const asm_reg::reg_type scratch, const operand& other) const {
+    if (!in_register(result))
+        return scratch;
+    const auto reg = allocator_->get_register(result);
+    return in_register(other) && allocator_->get_register(other) == reg ? scratch : reg;
+}
+
+void generator::emit_source(const asm_command::type op, const asm_reg::reg_type reg, const operand& value) {
+    if (value.is(operand::kind::integer))
+        code_.push_back({ op, reg, value.int_value() });
+    else if (in_register(value))
+        code_.push_back({ op, reg, allocator_->get_register(value) });
+    else if (value.type() == value_type::character || value.is(operand::kind::string)) {
+        load(asm_reg::reg_type::ecx, value);
+        code_.push_back({ op, reg, asm_reg::reg_type::ecx });
+    }
+    else
+        code_.push_back({ op, reg, location(value, asm_mem::mem_size::dword) });
+}
+
+void generator::emit_real_source(const asm_command::type op, const asm_reg::reg_type reg, const operand& value) {
+    if (value.is(operand::kind::real))
+        code_.push_back({ op, reg, { asm_mem::mem_size::qword, code_.add_double_constant(value.real_value()), 0 } });
+    else if (in_register(value))
+        code_.push_back({ op, reg, allocator_->get_register(value) });
+    else
+        code_.push_back({ op, reg, location(value, asm_mem::mem_size::qword) });
+}
+
+void generator::load(const asm_reg::reg_type reg, const operand& value) {
+    switch (value.get_kind()) {
+    case operand::kind::integer:
+        code_.push_back({ asm_command::type::mov, reg, value.int_value() });
+        return;
+    case operand::kind::string:
+        code_.push_back({ asm_command::type::mov, reg,
+            asm_operand::address(code_.add_string_constant(module_->strings()[value.id()])) });
+        return;
+    case operand::kind::temp:
+    case operand::kind::variable:
+        if (in_register(value)) {
+            if (allocator_->get_register(value) != reg)
+                code_.push_back({ asm_command::type::mov, reg, allocator_->get_register(value) });
+        }
+        else if (value.type() == value_type::character)
+            code_.push_back({ asm_command::type::movsx, reg, location(value, asm_mem::mem_size::byte) });
+        else
+            code_.push_back({ asm_command::type::mov, reg, location(value, asm_mem::mem_size::dword) });
+        return;
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+void generator::load_real(const asm_reg::reg_type reg, const operand& value) {
+    if (in_register(value)) {
+        if (allocator_->get_register(value) != reg)
+            code_.push_back({ asm_command::type::movsd, reg, allocator_->get_register(value) });
+    }
+    else
+        emit_real_source(asm_command::type::movsd, reg, value);
+}
+
+void generator::load_packed(const asm_reg::reg_type reg, const operand& value) {
+    if (!in_register(value))
+        code_.push_back({ get_packed_move(value.type()), reg, location(value, asm_mem::mem_size::xmmword) });
+    else if (allocator_->get_register(value) != reg)
+        code_.push_back({ get_packed_move(value.type()), reg, allocator_->get_register(value) });
+}
+
+void generator::store(const operand& result, const asm_reg::reg_type reg) {
+    if (result.type() == value_type::none)
+        return;
+    if (in_register(result)) {
+        const auto target = allocator_->get_register(result);
+        if (result.type() == value_type::character)
+            code_.push_back({ asm_command::type::movsx, target, asm_reg::reg_type::al });
+        else if (is_packed(result.type()) && target != reg)
+            code_.push_back({ get_packed_move(result.type()), target, reg });
+        else if (target != reg)
+            code_.push_back({ result.type() == value_type::real ? asm_command::type::movsd : asm_command::type::mov, target, reg });
+        return;
+    }
+    switch (result.type()) {
+    case value_type::real:
+        code_.push_back({ asm_command::type::movsd, location(result, asm_mem::mem_size::qword), reg });
+        return;
+    case value_type::packed_integer:
+    case value_type::packed_real:
+        code_.push_back({ get_packed_move(result.type()), location(result, asm_mem::mem_size::xmmword), reg });
+        return;
+    case value_type::character:
+        code_.push_back({ asm_command::type::mov, location(result, asm_mem::mem_size::byte), asm_reg::reg_type::al });
+        return;
+    default:
+        code_.push_back({ asm_command::type::mov, location(result, asm_mem::mem_size::dword), reg });
+    }
+}
+
+void generator::generate_instruction(const instruction& instruction) {
+    const auto& args = instruction.args();
+    const auto& result = instruction.result();
+    switch (instruction.op()) {
+    case instruction::opcode::mov:
+        if (is_packed(result.type())) {
+            const auto reg = in_register(result)
+                ? allocator_->get_register(result)
+                : in_register(args[0]) ? allocator_->get_register(args[0]) : asm_reg::reg_type::xmm0;
+            load_packed(reg, args[0]);
+            store(result, reg);
+        }
+        else if (in_register(result)) {
+            if (result.type() == value_type::real)
+                load_real(allocator_->get_register(result), args[0]);
+            else
+                load(allocator_->get_register(result), args[0]);
+        }
+        else if (result.type() == value_type::real) {
+            const auto reg = in_register(args[0]) ? allocator_->get_register(args[0]) : asm_reg::reg_type::xmm0;
+            load_real(reg, args[0]);
+            store(result, reg);
+        }
+        else if (args[0].is(operand::kind::integer))
+            code_.push_back({ asm_command::type::mov, location(result, get_mem_size(result.type())), args[0].int_value() });
+        else if (in_register(args[0]) && result.type() != value_type::character)
+            store(result, allocator_->get_register(args[0]));
+        else {
+            load(asm_reg::reg_type::eax, args[0]);
+            store(result, asm_reg::reg_type::eax);
+        }
+        return;
+    case instruction::opcode::add:
+    case instruction::opcode::sub:
+    case instruction::opcode::mul:
+    case instruction::opcode::div:
+    case instruction::opcode::mod:
+    case instruction::opcode::and:
+    case instruction::opcode::or:
+    case instruction::opcode::xor:
+    case instruction::opcode::shl:
+    case instruction::opcode::shr:
+        generate_binary(instruction);
+        return;
+    case instruction::opcode::neg:
+        if (result.type() == value_type::real) {
+            load_real(asm_reg::reg_type::xmm0, args[0]);
+            if (!in_register(result)) {
+                store(result, asm_reg::reg_type::xmm0);
+                code_.push_back({ asm_command::type::xor, location(result, asm_mem::mem_size::byte, 7), 128 });
+                return;
+            }
+            code_.push_back({ asm_command::type::sub, code_.stack_pointer(), 8 });
+            code_.push_back({ asm_command::type::movsd, { code_.stack_pointer(), asm_mem::mem_size::qword }, asm_reg::reg_type::xmm0 });
+            code_.push_back({ asm_command::type::xor, { code_.stack_pointer(), asm_mem::mem_size::byte, 7 }, 128 });
+            code_.push_back({ asm_command::type::movsd, allocator_->get_register(result), { code_.stack_pointer(), asm_mem::mem_size::qword } });
+            code_.push_back({ asm_command::type::add, code_.stack_pointer(), 8 });
+            return;
+        }
+        [[fallthrough]];
+    case instruction::opcode::not:
+    {
+        const auto reg = target(result, asm_reg::reg_type::eax);
+        load(reg, args[0]);
+        code_.push_back({ instruction.op() == instruction::opcode::neg ? asm_command::type::neg : asm_command::type::not, reg });
+        if (reg == asm_reg::reg_type::eax)
+            store(result, asm_reg::reg_type::eax);
+        return;
+    }
+    case instruction::opcode::eq:
+    case instruction::opcode::ne:
+    case instruction::opcode::lt:
+    case instruction::opcode::le:
+    case instruction::opcode::gt:
+    case instruction::opcode::ge:
+        generate_compare(instruction);
+        return;
+    case instruction::opcode::cast:
+        generate_cast(instruction);
+        return;
+    case instruction::opcode::addr:
+    {
+        const auto& variable = function_->variables()[args[0].id()];
+        const auto reg = target(result, asm_reg::reg_type::eax);
+        if (variable.level == function_->depth())
+            code_.push_back({ asm_command::type::lea, reg,
+                { code_.frame_pointer(), asm_mem::mem_size::dword, -variable.offset } });
+        else {
+            code_.push_back({ asm_command::type::mov, reg,
+                { code_.frame_pointer(), asm_mem::mem_size::dword, -code_.slot_size() * static_cast<long long>(variable.level) } });
+            code_.push_back({ asm_command::type::sub, reg, variable.offset });
+        }
+        if (reg == asm_reg::reg_type::eax)
+            store(result, asm_reg::reg_type::eax);
+        return;
+    }
+    case instruction::opcode::load:
+    {
+        auto base = asm_reg::reg_type::edx;
+        if (in_register(args[0]))
+            base = allocator_->get_register(args[0]);
+        else
+            load(base, args[0]);
+        switch (result.type()) {
+        case value_type::real:
+        {
+            const auto reg = in_register(result) ? allocator_->get_register(result) : asm_reg::reg_type::xmm0;
+            code_.push_back({ asm_command::type::movsd, reg, { base, asm_mem::mem_size::qword } });
+            if (reg == asm_reg::reg_type::xmm0)
+                store(result, asm_reg::reg_type::xmm0);
+            return;
+        }
+        case value_type::packed_integer:
+        case value_type::packed_real:
+        {
+            const auto reg = in_register(result) ? allocator_->get_register(result) : asm_reg::reg_type::xmm0;
+            code_.push_back({ get_packed_move(result.type()), reg, { base, asm_mem::mem_size::xmmword } });
+            if (reg == asm_reg::reg_type::xmm0)
+                store(result, asm_reg::reg_type::xmm0);
+            return;
+        }
+        case value_type::character:
+        {
+            const auto reg = target(result, asm_reg::reg_type::eax);
+            code_.push_back({ asm_command::type::movsx, reg, { base, asm_mem::mem_size::byte } });
+            if (reg == asm_reg::reg_type::eax)
+                store(result, asm_reg::reg_type::eax);
+            return;
+        }
+        default:
+        {
+            const auto reg = target(result, asm_reg::reg_type::eax);
+            code_.push_back({ asm_command::type::mov, reg, { base, asm_mem::mem_size::dword } });
+            if (reg == asm_reg::reg_type::eax)
+                store(result, asm_reg::reg_type::eax);
+            return;
+        }
+        }
+    }
+    case instruction::opcode::store:
+    {
+        auto base = asm_reg::reg_type::edx;
+        if (in_register(args[0]))
+            base = allocator_->get_register(args[0]);
+        else
+            load(base, args[0]);
+        const auto& value = args[1];
+        switch (value.type()) {
+        case value_type::real:
+        {
+            const auto reg = in_register(value) ? allocator_->get_register(value) : asm_reg::reg_type::xmm0;
+            load_real(reg, value);
+            code_.push_back({ asm_command::type::movsd, { base, asm_mem::mem_size::qword }, reg });
+            return;
+        }
+        case value_type::packed_integer:
+        case value_type::packed_real:
+        {
+            const auto reg = in_register(value) ? allocator_->get_register(value) : asm_reg::reg_type::xmm0;
+            load_packed(reg, value);
+            code_.push_back({ get_packed_move(value.type()), { base, asm_mem::mem_size::xmmword }, reg });
+            return;
+        }
+        case value_type::character:
+            if (value.is(operand::kind::integer))
+                code_.push_back({ asm_command::type::mov, { base, asm_mem::mem_size::byte }, value.int_value() });
+            else {
+                load(asm_reg::reg_type::eax, value);
+                code_.push_back({ asm_command::type::mov, { base, asm_mem::mem_size::byte }, asm_reg::reg_type::al });
+            }
+            return;
+        default:
+            if (value.is(operand::kind::integer))
+                code_.push_back({ asm_command::type::mov, { base, asm_mem::mem_size::dword }, value.int_value() });
+            else {
+                const auto reg = in_register(value) ? allocator_->get_register(value) : asm_reg::reg_type::eax;
+                load(reg, value);
+                code_.push_back({ asm_command::type::mov, { base, asm_mem::mem_size::dword }, reg });
+            }
+            return;
+        }
+    }
+    case instruction::opcode::copy:
+        load(asm_reg::reg_type::eax, args[1]);
+        load(asm_reg::reg_type::edx, args[0]);
+        generate_copy(args[2].int_value());
+        return;
+    case instruction::opcode::call:
+        generate_call(instruction);
+        return;
+    case instruction::opcode::write:
+        generate_write(instruction);
+        return;
+    case instruction::opcode::jmp:
+        if (args[0].id() != block_ + 1)
+            code_.push_back({ asm_command::type::jmp, block_label(args[0].id()) });
+        return;
+    case instruction::opcode::br:
+        generate_branch(instruction);
+        return;
+    case instruction::opcode::ret:
+        generate_return(instruction);
+        return;
+    case instruction::opcode::splat:
+        generate_splat(instruction);
+        return;
+    case instruction::opcode::reduce:
+        generate_reduce(instruction);
+        return;
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+void generator::generate_binary(const instruction& instruction) {
+    static const asm_command::type ops[] = {
+        asm_command::type::mov, asm_command::type::add, asm_command::type::sub, asm_command::type::imul,
+        asm_command::type::idiv, asm_command::type::idiv, asm_command::type::and, asm_command::type::or,
+        asm_command::type::xor, asm_command::type::shl, asm_command::type::shr
+    };
+    static const asm_command::type f_ops[] = {
+        asm_command::type::movsd, asm_command::type::addsd, asm_command::type::subsd, asm_command::type::mulsd,
+        asm_command::type::divsd
+    };
+    static const asm_command::type pd_ops[] = {
+        asm_command::type::movupd, asm_command::type::addpd, asm_command::type::subpd, asm_command::type::mulpd,
+        asm_command::type::divpd
+    };
+    static const asm_command::type pi_ops[] = {
+        asm_command::type::movdqu, asm_command::type::paddd, asm_command::type::psubd
+    };
+    const auto& args = instruction.args();
+    const auto& result = instruction.result();
+    const auto op = static_cast<unsigned char>(instruction.op());
+    if (is_packed(result.type())) {
+        const auto reg = target(result, asm_reg::reg_type::xmm0, args[1]);
+        const auto source = in_register(args[1]) ? allocator_->get_register(args[1]) : asm_reg::reg_type::xmm1;
+        load_packed(reg, args[0]);
+        load_packed(source, args[1]);
+        code_.push_back({ (result.type() == value_type::packed_real ? pd_ops : pi_ops)[op], reg, source });
+        if (reg == asm_reg::reg_type::xmm0)
+            store(result, asm_reg::reg_type::xmm0);
+        return;
+    }
+    if (result.type() == value_type::real) {
+        const auto reg = target(result, asm_reg::reg_type::xmm0, args[1]);
+        load_real(reg, args[0]);
+        emit_real_source(f_ops[op], reg, args[1]);
+        if (reg == asm_reg::reg_type::xmm0)
+            store(result, asm_reg::reg_type::xmm0);
+        return;
+    }
+    switch (instruction.op()) {
+    case instruction::opcode::div:
+    case instruction::opcode::mod:
+        load(asm_reg::reg_type::eax, args[0]);
+        load(asm_reg::reg_type::ecx, args[1]);
+        code_.push_back({ asm_command::type::cdq });
+        code_.push_back({ asm_command::type::idiv, asm_reg::reg_type::ecx });
+        store(result, instruction.op() == instruction::opcode::mod ? asm_reg::reg_type::edx : asm_reg::reg_type::eax);
+        return;
+    case instruction::opcode::shl:
+    case instruction::opcode::shr:
+    {
+        const auto reg = target(result, asm_reg::reg_type::eax, args[1]);
+        load(reg, args[0]);
+        if (args[1].is(operand::kind::integer))
+            code_.push_back({ ops[op], reg, args[1].int_value() });
+        else {
+            load(asm_reg::reg_type::ecx, args[1]);
+            code_.push_back({ ops[op], reg, asm_reg::reg_type::cl });
+        }
+        if (reg == asm_reg::reg_type::eax)
+            store(result, asm_reg::reg_type::eax);
+        return;
+    }
+    default:
+    {
+        const auto reg = target(result, asm_reg::reg_type::eax, args[1]);
+        load(reg, args[0]);
+        emit_source(ops[op], reg, args[1]);
+        if (reg == asm_reg::reg_type::eax)
+            store(result, asm_reg::reg_type::eax);
+    }
+    }
+}
+
+void generator::generate_compare(const instruction& instruction) {
+    static const asm_command::type ops[] = {
+        asm_command::type::sete, asm_command::type::setne, asm_command::type::setl,
+        asm_command::type::setle, asm_command::type::setg, asm_command::type::setge
+    };
+    static const asm_command::type f_ops[] = {
+        asm_command::type::jp, asm_command::type::jnp, asm_command::type::seta,
+        asm_command::type::setae, asm_command::type::seta, asm_command::type::setae
+    };
+    const auto& args = instruction.args();
+    const auto op = static_cast<unsigned char>(instruction.op()) - static_cast<unsigned char>(instruction::opcode::eq);
+    if (args[0].type() == value_type::real) {
+        const auto reg = in_register(args[0]) ? allocator_->get_register(args[0]) : asm_reg::reg_type::xmm0;
+        if (instruction.op() == instruction::opcode::eq || instruction.op() == instruction::opcode::ne) {
+            load_real(reg, args[0]);
+            const auto fail = code_.new_label(), end = code_.new_label();
+            emit_real_source(asm_command::type::ucomisd, reg, args[1]);
+            code_.push_back(asm_command::type::lahf);
+            code_.push_back({ asm_command::type::test, asm_reg::reg_type::ah, 68 });
+            code_.push_back({ f_ops[op], { fail } });
+            code_.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, -1 });
+            code_.push_back({ asm_command::type::jmp, { end } });
+            code_.push_back({ asm_command::type::label, { fail } });
+            code_.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, 0 });
+            code_.push_back({ asm_command::type::label, { end } });
+            store(instruction.result(), asm_reg::reg_type::eax);
+            return;
+        }
+        // a < b is compared as b > a, so an unordered result is false
+        const auto swap = instruction.op() == instruction::opcode::lt || instruction.op() == instruction::opcode::le;
+        const auto left = swap ? asm_reg::reg_type::xmm0 : reg;
+        load_real(left, args[swap ? 1 : 0]);
+        emit_real_source(asm_command::type::comisd, left, args[swap ? 0 : 1]);
+        code_.push_back({ f_ops[op], asm_reg::reg_type::al });
+    }
+    else {
+        const auto reg = in_register(args[0]) ? allocator_->get_register(args[0]) : asm_reg::reg_type::eax;
+        load(reg, args[0]);
+        emit_source(asm_command::type::cmp, reg, args[1]);
+        code_.push_back({ ops[op], asm_reg::reg_type::al });
+    }
+    code_.push_back({ asm_command::type::movsx, asm_reg::reg_type::eax, asm_reg::reg_type::al });
+    code_.push_back({ asm_command::type::neg, asm_reg::reg_type::eax });
+    store(instruction.result(), asm_reg::reg_type::eax);
+}
+
+void generator::generate_cast(const instruction& instruction) {
+    const auto& value = instruction.args()[0];
+    const auto& result = instruction.result();
+    if (result.type() == value_type::real) {
+        const auto reg = target(result, asm_reg::reg_type::xmm0);
+        if (in_register(value))
+            code_.push_back({ asm_command::type::cvtsi2sd, reg, allocator_->get_register(value) });
+        else {
+            load(asm_reg::reg_type::eax, value);
+            code_.push_back({ asm_command::type::cvtsi2sd, reg, asm_reg::reg_type::eax });
+        }
+        if (reg == asm_reg::reg_type::xmm0)
+            store(result, asm_reg::reg_type::xmm0);
+        return;
+    }
+    if (value.type() == value_type::real) {
+        const auto reg = in_register(value) ? allocator_->get_register(value) : asm_reg::reg_type::xmm0;
+        load_real(reg, value);
+        code_.push_back({ asm_command::type::cvttsd2si, asm_reg::reg_type::eax, reg });
+    }
+    else
+        load(asm_reg::reg_type::eax, value);
+    store(result, asm_reg::reg_type::eax);
+}
+
+void generator::generate_splat(const instruction& instruction) {
+    const auto& value = instruction.args()[0];
+    const auto& result = instruction.result();
+    const auto reg = target(result, asm_reg::reg_type::xmm0);
+    if (result.type() == value_type::packed_real) {
+        load_real(reg, value);
+        code_.push_back({ asm_command::type::unpcklpd, reg, reg });
+    }
+    else {
+        load(asm_reg::reg_type::eax, value);
+        code_.push_back({ asm_command::type::movd, reg, asm_reg::reg_type::eax });
+        code_.push_back({ asm_command::type::pshufd, reg, reg, 0 });
+    }
+    if (reg == asm_reg::reg_type::xmm0)
+        store(result, asm_reg::reg_type::xmm0);
+}
+
+void generator::generate_reduce(const instruction& instruction) {
+    const auto& value = instruction.args()[0];
+    load_packed(asm_reg::reg_type::xmm0, value);
+    if (value.type() == value_type::packed_real) {
+        code_.push_back({ asm_command::type::movupd, asm_reg::reg_type::xmm1, asm_reg::reg_type::xmm0 });
+        code_.push_back({ asm_command::type::unpckhpd, asm_reg::reg_type::xmm1, asm_reg::reg_type::xmm1 });
+        code_.push_back({ asm_command::type::addsd, asm_reg::reg_type::xmm0, asm_reg::reg_type::xmm1 });
+        store(instruction.result(), asm_reg::reg_type::xmm0);
+        return;
+    }
+    code_.push_back({ asm_command::type::pshufd, asm_reg::reg_type::xmm1, asm_reg::reg_type::xmm0, 78 });
+    code_.push_back({ asm_command::type::paddd, asm_reg::reg_type::xmm0, asm_reg::reg_type::xmm1 });
+    code_.push_back({ asm_command::type::pshufd, asm_reg::reg_type::xmm1, asm_reg::reg_type::xmm0, 177 });
+    code_.push_back({ asm_command::type::paddd, asm_reg::reg_type::xmm0, asm_reg::reg_type::xmm1 });
+    code_.push_back({ asm_command::type::movd, asm_reg::reg_type::eax, asm_reg::reg_type::xmm0 });
+    store(instruction.result(), asm_reg::reg_type::eax);
+}
+
+void generator::generate_call(const instruction& instruction) {
+    const auto& args = instruction.args();
+    const auto f = module_->get_function(args[0].id());
+    const auto result = resolve_type(f->type()->return_type());
+    if (result->is_category(type::type_category::array) || result->is_category(type::type_category::record)) {
+        if (args.size() > f->parameters().size() + 1)
+            load(asm_reg::reg_type::eax, args.back());
+        else
+            code_.push_back({ asm_command::type::lea, asm_reg::reg_type::eax,
+                { code_.frame_pointer(), asm_mem::mem_size::dword, -code_.add_frame_slot(result->data_size()) } });
+        push(asm_reg::reg_type::eax);
+    }
+    for (size_t i = 0; i < f->parameters().size(); ++i) {
+        const auto& parameter = f->parameters()[i];
+        const auto& value = args[i + 1];
+        if (parameter.is_reference) {
+            if (in_register(value))
+                push(allocator_->get_register(value));
+            else {
+                load(asm_reg::reg_type::eax, value);
+                push(asm_reg::reg_type::eax);
+            }
+            continue;
+        }
+        switch (parameter.type) {
+        case value_type::real:
+        {
+            const auto reg = in_register(value) ? allocator_->get_register(value) : asm_reg::reg_type::xmm0;
+            load_real(reg, value);
+            code_.push_back({ asm_command::type::sub, code_.stack_pointer(), 8 });
+            code_.push_back({ asm_command::type::movsd, { code_.stack_pointer(), asm_mem::mem_size::qword }, reg });
+            break;
+        }
+        case value_type::character:
+            load(asm_reg::reg_type::eax, value);
+            code_.push_back({ asm_command::type::sub, code_.stack_pointer(), 1 });
+            code_.push_back({ asm_command::type::mov, { code_.stack_pointer(), asm_mem::mem_size::byte }, asm_reg::reg_type::al });
+            break;
+        case value_type::pointer:
+        {
+            load(asm_reg::reg_type::eax, value);
+            code_.push_back({ asm_command::type::sub, code_.stack_pointer(), static_cast<int>(parameter.size) });
+            if (code_.get_target() == asm_code::target::x86_64) {
+                code_.push_back({ asm_command::type::mov, asm_reg::reg_type::edx, asm_reg::reg_type::esp });
+                code_.add_block_copy(asm_reg::reg_type::eax, asm_reg::reg_type::edx, parameter.size, code_.new_label());
+            }
+            else
+                code_.add_block_copy(asm_reg::reg_type::eax, code_.stack_pointer(), parameter.size, code_.new_label());
+            break;
+        }
+        default:
+            if (value.is(operand::kind::integer))
+                push(value.int_value());
+            else if (in_register(value))
+                push(allocator_->get_register(value));
+            else {
+                load(asm_reg::reg_type::eax, value);
+                push(asm_reg::reg_type::eax);
+            }
+        }
+    }
+    const auto parameters_size = f->type()->parameters().get_data_size();
+    if (parameters_size % 4 != 0)
+        code_.push_back({ asm_command::type::sub, code_.stack_pointer(), static_cast<int>(parameters_size % 4) });
+    code_.push_back({ asm_command::type::call, f->label() });
+    store(instruction.result(), instruction.result().type() == value_type::real
+        ? asm_reg::reg_type::xmm0
+        : asm_reg::reg_type::eax);
+}
+
+void generator::generate_write(const instruction& instruction) {
+    const auto& args = instruction.args();
+    std::string format;
+    for (const auto& it : args)
+        switch (it.type()) {
+        case value_type::character:
+            if (!it.is(operand::kind::integer))
+                format += "%c";
+            else if (it.int_value() == '%')
+                format += "%%";
+            else
+                format += static_cast<char>(it.int_value());
+            break;
+        case value_type::integer:
+            format += "%d";
+            break;
+        case value_type::real:
+            format += "%f";
+            break;
+        default:
+            format += "%s";
+        }
+    if (code_.get_target() == asm_code::target::x86_64) {
+        generate_sysv_write(args, format);
+        return;
+    }
+    long long size = 0;
+    for (auto it = args.rbegin(); it != args.rend(); ++it)
+        switch (it->type()) {
+        case value_type::character:
+            if (it->is(operand::kind::integer))
+                break;
+            load(asm_reg::reg_type::eax, *it);
+            code_.push_back({ asm_command::type::push, asm_reg::reg_type::eax });
+            size += 4;
+            break;
+        case value_type::real:
+        {
+            const auto reg = in_register(*it) ? allocator_->get_register(*it) : asm_reg::reg_type::xmm0;
+            load_real(reg, *it);
+            code_.push_back({ asm_command::type::sub, code_.stack_pointer(), 8 });
+            code_.push_back({ asm_command::type::movsd, { code_.stack_pointer(), asm_mem::mem_size::qword }, reg });
+            size += 8;
+            break;
+        }
+        case value_type::pointer:
+            code_.push_back({ asm_command::type::push,
+                asm_operand::address(code_.add_string_constant(module_->strings()[it->id()])) });
+            size += 4;
+            break;
+        default:
+            if (it->is(operand::kind::integer))
+                code_.push_back({ asm_command::type::push, it->int_value() });
+            else if (in_register(*it))
+                code_.push_back({ asm_command::type::push, allocator_->get_register(*it) });
+            else {
+                load(asm_reg::reg_type::eax, *it);
+                code_.push_back({ asm_command::type::push, asm_reg::reg_type::eax });
+            }
+            size += 4;
+        }
+    const auto s = code_.add_string_constant(format + '\n');
+    code_.push_back({ asm_command::type::push, asm_operand::address(s) });
+    code_.push_back({ asm_command::type::call, { "crt_printf" } });
+    code_.push_back({ asm_command::type::add, code_.stack_pointer(), static_cast<int>(size + 4) });
+}
+
+void generator::generate_sysv_write(const std::vector<operand>& args, const std::string& format) {
+    static const asm_reg::reg_type integer_arguments[] = {
+        asm_reg::reg_type::esi, asm_reg::reg_type::edx, asm_reg::reg_type::ecx,
+        asm_reg::reg_type::r8d, asm_reg::reg_type::r9d
+    };
+    static const asm_reg::reg_type real_arguments[] = {
+        asm_reg::reg_type::xmm0, asm_reg::reg_type::xmm1, asm_reg::reg_type::xmm2, asm_reg::reg_type::xmm3,
+        asm_reg::reg_type::xmm4, asm_reg::reg_type::xmm5, asm_reg::reg_type::xmm6, asm_reg::reg_type::xmm7
+    };
+    std::vector<const operand*> values;
+    for (const auto& it : args)
+        if (it.type() != value_type::character || !it.is(operand::kind::integer))
+            values.push_back(&it);
+    std::vector<int> registers;
+    size_t integers = 0, reals = 0, stack = 0;
+    for (const auto it : values)
+        if (it->type() == value_type::real ? reals < std::size(real_arguments) : integers < std::size(integer_arguments))
+            registers.push_back(static_cast<int>(it->type() == value_type::real ? reals++ : integers++));
+        else {
+            registers.push_back(-1);
+            ++stack;
+        }
+    if (!stack_pointer_slot_)
+        stack_pointer_slot_ = code_.add_frame_slot(8);
+    code_.push_back({ asm_command::type::mov, { code_.frame_pointer(), asm_mem::mem_size::qword, -stack_pointer_slot_ },
+        asm_reg::reg_type::rsp });
+    code_.push_back({ asm_command::type::and, asm_reg::reg_type::rsp, -16 });
+    if (!values.empty())
+        code_.push_back({ asm_command::type::sub, asm_reg::reg_type::rsp, static_cast<int>((values.size() + 1) / 2 * 16) });
+    std::vector<long long> slots;
+    for (size_t i = 0, saved = stack, passed = 0; i < values.size(); ++i)
+        slots.push_back(8 * static_cast<long long>(registers[i] < 0 ? passed++ : saved++));
+    for (size_t i = 0; i < values.size(); ++i) {
+        const auto& value = *values[i];
+        if (value.type() == value_type::real) {
+            const auto reg = in_register(value) ? allocator_->get_register(value) : asm_reg::reg_type::xmm0;
+            load_real(reg, value);
+            code_.push_back({ asm_command::type::movsd, { asm_reg::reg_type::rsp, asm_mem::mem_size::qword, slots[i] }, reg });
+        }
+        else if (value.type() == value_type::pointer)
+            code_.push_back({ asm_command::type::mov, { asm_reg::reg_type::rsp, asm_mem::mem_size::dword, slots[i] },
+                asm_operand::address(code_.add_string_constant(module_->strings()[value.id()])) });
+        else if (value.is(operand::kind::integer))
+            code_.push_back({ asm_command::type::mov, { asm_reg::reg_type::rsp, asm_mem::mem_size::dword, slots[i] },
+                value.int_value() });
+        else {
+            const auto reg = in_register(value) ? allocator_->get_register(value) : asm_reg::reg_type::eax;
+            load(reg, value);
+            code_.push_back({ asm_command::type::mov, { asm_reg::reg_type::rsp, asm_mem::mem_size::dword, slots[i] }, reg });
+        }
+    }
+    for (size_t i = 0; i < values.size(); ++i)
+        if (registers[i] >= 0 && values[i]->type() == value_type::real)
+            code_.push_back({ asm_command::type::movsd, real_arguments[registers[i]],
+                { asm_reg::reg_type::rsp, asm_mem::mem_size::qword, slots[i] } });
+        else if (registers[i] >= 0)
+            code_.push_back({ asm_command::type::mov, integer_arguments[registers[i]],
+                { asm_reg::reg_type::rsp, asm_mem::mem_size::dword, slots[i] } });
+    code_.push_back({ asm_command::type::mov, asm_reg::reg_type::edi, asm_operand::address(code_.add_string_constant(format + '\n')) });
+    code_.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, static_cast<int>(reals) });
+    code_.push_back({ asm_command::type::call, { "printf" } });
+    code_.push_back({ asm_command::type::mov, asm_reg::reg_type::rsp,
+        { code_.frame_pointer(), asm_mem::mem_size::qword, -stack_pointer_slot_ } });
+}
+
+void generator::push(const asm_reg::reg_type reg) {
+    if (code_.get_target() == asm_code::target::x86) {
+        code_.push_back({ asm_command::type::push, reg });
+        return;
+    }
+    code_.push_back({ asm_command::type::sub, asm_reg::reg_type::rsp, 4 });
+    code_.push_back({ asm_command::type::mov, { asm_reg::reg_type::rsp, asm_mem::mem_size::dword }, reg });
+}
+
+void generator::push(const long long value) {
+    if (code_.get_target() == asm_code::target::x86) {
+        code_.push_back({ asm_command::type::push, value });
+        return;
+    }
+    code_.push_back({ asm_command::type::sub, asm_reg::reg_type::rsp, 4 });
+    code_.push_back({ asm_command::type::mov, { asm_reg::reg_type::rsp, asm_mem::mem_size::dword }, value });
+}
+
+void generator::generate_return(const instruction& instruction) {
+    if (!instruction.args().empty()) {
+        const auto& value = instruction.args()[0];
+        switch (value.type()) {
+        case value_type::real:
+            load_real(asm_reg::reg_type::xmm0, value);
+            break;
+        case value_type::pointer:
+            load(asm_reg::reg_type::eax, value);
+            code_.push_back({ asm_command::type::mov, asm_reg::reg_type::edx,
+                { code_.frame_pointer(), asm_mem::mem_size::dword, code_.get_return_slot_offset() } });
+            generate_copy(resolve_type(function_->type()->return_type())->data_size());
+            code_.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, asm_reg::reg_type::edx });
+            break;
+        default:
+            load(asm_reg::reg_type::eax, value);
+        }
+    }
+    for (const auto& it : saved_registers_)
+        code_.push_back({ asm_command::type::mov, it.first, { code_.frame_pointer(), asm_mem::mem_size::dword, -it.second } });
+    code_.push_back({ asm_command::type::leave });
+    code_.push_back({ asm_command::type::ret, static_cast<int>(code_.get_current_function_param_size()) });
+}
+
+void generator::generate_branch(const instruction& instruction) {
+    const auto& args = instruction.args();
+    const auto on_true = args[1].id(), on_false = args[2].id();
+    if (args[0].is(operand::kind::integer)) {
+        const auto target = args[0].int_value() ? on_true : on_false;
+        if (target != block_ + 1)
+            code_.push_back({ asm_command::type::jmp, block_label(target) });
+        return;
+    }
+    const auto reg = in_register(args[0]) ? allocator_->get_register(args[0]) : asm_reg::reg_type::eax;
+    load(reg, args[0]);
+    code_.push_back({ asm_command::type::test, reg, reg });
+    if (on_true == block_ + 1) {
+        code_.push_back({ asm_command::type::jz, block_label(on_false) });
+        return;
+    }
+    code_.push_back({ asm_command::type::jnz, block_label(on_true) });
+    if (on_false != block_ + 1)
+        code_.push_back({ asm_command::type::jmp, block_label(on_false) });
+}
+
+void generator::generate_copy(const size_t size) {
+    code_.add_block_copy(asm_reg::reg_type::eax, asm_reg::reg_type::edx, size, code_.new_label());
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "ir.hpp"
+#include "asm_code.hpp"
+#include "register_allocator.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace ir {
+
+        using namespace code;
+
+        class generator {
+
+        public:
+
+            explicit generator(asm_code& code, const bool allocate_registers = false) :
+                code_(code), allocate_registers_(allocate_registers) {}
+
+            void generate(const module& module);
+
+        private:
+
+            asm_code& code_;
+            bool allocate_registers_;
+            const module* module_ = nullptr;
+            function_p function_;
+            std::shared_ptr<register_allocator> allocator_;
+            std::vector<long long> temp_offsets_;
+            std::vector<std::pair<asm_reg::reg_type, long long>> saved_registers_;
+            long long stack_pointer_slot_ = 0;
+            size_t block_ = 0;
+            std::unordered_map<size_t, asm_label> block_labels_;
+
+            void generate_function(const size_t id);
+            void generate_instruction(const instruction& instruction);
+            void generate_binary(const instruction& instruction);
+            void generate_compare(const instruction& instruction);
+            void generate_cast(const instruction& instruction);
+            void generate_splat(const instruction& instruction);
+            void generate_reduce(const instruction& instruction);
+            void generate_call(const instruction& instruction);
+            void generate_write(const instruction& instruction);
+            void generate_sysv_write(const std::vector<operand>& args, const std::string& format);
+            void generate_return(const instruction& instruction);
+            void generate_branch(const instruction& instruction);
+            void generate_copy(const size_t size);
+
+            asm_label block_label(const size_t id) const;
+            static asm_mem::mem_size get_mem_size(const value_type type);
+            static asm_command::type get_packed_move(const value_type type);
+            asm_operand location(const operand& value, const asm_mem::mem_size size, const long long offset = 0);
+            bool in_register(const operand& value) const;
+            asm_reg::reg_type target(const operand& result, const asm_reg::reg_type scratch, const operand& other = operand()) const;
+            void emit_source(const asm_command::type op, const asm_reg::reg_type reg, const operand& value);
+            void emit_real_source(const asm_command::type op, const asm_reg::reg_type reg, const operand& value);
+            void load(const asm_reg::reg_type reg, const operand& value);
+            void load_real(const asm_reg::reg_type reg, const operand& value);
+            void load_packed(const asm_reg::reg_type reg, const operand& value);
+            void store(const operand& result, const asm_reg::reg_type reg);
+            void push(const asm_reg::reg_type reg);
+            void push(const long long value);
+
+        };// class generator
+
+    }// namespace ir
+
+}// namespace pascal_compiler
@@ -0,0 +1,1024 @@
+#include "ir_optimizer.hpp"
+#include "optimizer.hpp"
+#include "boost/format.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace pascal_compiler;
+using namespace ir;
+
+static long long to_int(const long long value) {
+    return static_cast<int>(static_cast<unsigned int>(value));
+}
+
+static long long to_char(const long long value) {
+    return static_cast<signed char>(value);
+}
+
+// class basic_pass
+const basic_pass::statistics_t& basic_pass::statistics() const { return statistics_; }
+
+void basic_pass::replace_uses(function& function, const std::vector<operand>& replacements) {
+    for (auto& block : function.blocks())
+        for (auto& inst : block.instructions())
+            for (auto& arg : inst.args())
+                while (arg.is(operand::kind::temp) && !replacements[arg.id()].is(operand::kind::none))
+                    arg = replacements[arg.id()];
+}
+
+std::vector<basic_pass::loop_t> basic_pass::find_loops(const function& function) {
+    const auto tree = dominator_tree::dominators(function);
+    const auto& blocks = function.blocks();
+    std::vector<bool> reachable(blocks.size(), false);
+    for (const auto it : tree.order())
+        reachable[it] = true;
+    std::vector<loop_t> loops;
+    std::vector<size_t> index(blocks.size(), static_cast<size_t>(-1));
+    for (const auto id : tree.order())
+        for (const auto header : blocks[id].successors()) {
+            if (!tree.dominates(header, id))
+                continue;
+            if (index[header] == static_cast<size_t>(-1)) {
+                index[header] = loops.size();
+                loops.push_back({ header, std::vector<bool>(blocks.size(), false), 1 });
+                loops.back().blocks[header] = true;
+            }
+            auto& loop = loops[index[header]];
+            std::vector<size_t> work;
+            if (!loop.blocks[id]) {
+                loop.blocks[id] = true;
+                ++loop.size;
+                work.push_back(id);
+            }
+            while (!work.empty()) {
+                const auto it = work.back();
+                work.pop_back();
+                for (const auto p : blocks[it].predecessors())
+                    if (reachable[p] && !loop.blocks[p]) {
+                        loop.blocks[p] = true;
+                        ++loop.size;
+                        work.push_back(p);
+                    }
+            }
+        }
+    sort(loops.begin(), loops.end(), [](const loop_t& a, const loop_t& b) { return a.size < b.size; });
+    return loops;
+}
+
+bool basic_pass::insert_preheaders(function& function, const std::vector<loop_t>& loops) {
+    std::vector<size_t> order;
+    for (const auto& it : function.blocks())
+        order.push_back(it.id());
+    auto inserted = false;
+    for (const auto& loop : loops) {
+        std::vector<size_t> outside;
+        for (const auto p : function.block(loop.header).predecessors())
+            if (!loop.blocks[p])
+                outside.push_back(p);
+        if (outside.size() != 1 || function.block(outside[0]).successors().size() == 1)
+            continue;
+        const auto from = outside[0], preheader = function.add_block();
+        function.block(preheader).instructions().emplace_back(instruction::opcode::jmp, operand(),
+            std::vector<operand>{ operand::make_block(loop.header) });
+        for (auto& arg : function.block(from).instructions().back().args())
+            if (arg == operand::make_block(loop.header))
+                arg = operand::make_block(preheader);
+        for (auto& it : function.block(loop.header).instructions()) {
+            if (!it.is_phi())
+                break;
+            for (auto& arg : it.args())
+                if (arg == operand::make_block(from))
+                    arg = operand::make_block(preheader);
+        }
+        order.insert(find(order.begin(), order.end(), loop.header), preheader);
+        inserted = true;
+    }
+    if (inserted)
+        function.reorder_blocks(order);
+    return inserted;
+}
+
+size_t basic_pass::get_preheader(const function& function, const loop_t& loop) {
+    auto result = static_cast<size_t>(-1);
+    for (const auto p : function.block(loop.header).predecessors())
+        if (!loop.blocks[p]) {
+            if (result != static_cast<size_t>(-1))
+                return static_cast<size_t>(-1);
+            result = p;
+        }
+    return result != static_cast<size_t>(-1) && function.block(result).successors().size() == 1
+        ? result
+        : static_cast<size_t>(-1);
+}
+
+// class sccp_pass
+void sccp_pass::run(function& function) {
+    function_ = &function;
+    function.update_cfg();
+    values_.assign(function.temps().size(), lattice_t());
+    executable_.assign(function.blocks().size(), false);
+    edges_.clear();
+    flow_work_.clear();
+    ssa_work_.clear();
+    uses_.assign(function.temps().size(), {});
+    for (const auto& block : function.blocks())
+        for (size_t i = 0; i < block.instructions().size(); ++i)
+            for (const auto& arg : block.instructions()[i].args())
+                if (arg.is(operand::kind::temp))
+                    uses_[arg.id()].emplace_back(block.id(), i);
+    executable_[0] = true;
+    for (size_t i = 0; i < function.block(0).instructions().size(); ++i)
+        visit(0, i);
+    while (!flow_work_.empty() || !ssa_work_.empty()) {
+        if (!flow_work_.empty()) {
+            const auto edge = flow_work_.back(); flow_work_.pop_back();
+            const auto& instructions = function.block(edge.second).instructions();
+            const auto first = !executable_[edge.second];
+            executable_[edge.second] = true;
+            for (size_t i = 0; i < instructions.size() && (first || instructions[i].is_phi()); ++i)
+                visit(edge.second, i);
+            continue;
+        }
+        const auto temp = ssa_work_.back(); ssa_work_.pop_back();
+        for (const auto& it : uses_[temp])
+            if (executable_[it.first])
+                visit(it.first, it.second);
+    }
+    std::vector<operand> replacements(function.temps().size());
+    for (size_t i = 0; i < values_.size(); ++i)
+        if (values_[i].kind == state::constant) {
+            replacements[i] = values_[i].value;
+            ++statistics_.values_folded;
+        }
+    for (auto& block : function.blocks()) {
+        auto& instructions = block.instructions();
+        const auto size = instructions.size();
+        instructions.erase(remove_if(instructions.begin(), instructions.end(), [&replacements](const instruction& it) {
+            return it.result().is(operand::kind::temp) && !replacements[it.result().id()].is(operand::kind::none) &&
+                !it.has_side_effects();
+        }), instructions.end());
+        statistics_.instructions_removed += size - instructions.size();
+    }
+    replace_uses(function, replacements);
+    for (auto& block : function.blocks()) {
+        auto& last = block.instructions().back();
+        if (last.op() != instruction::opcode::br || !last.args()[0].is(operand::kind::integer))
+            continue;
+        last = instruction(instruction::opcode::jmp, operand(),
+            { last.args()[0].int_value() ? last.args()[1] : last.args()[2] });
+        ++statistics_.values_folded;
+    }
+    function.remove_unreachable_blocks();
+}
+
+sccp_pass::lattice_t sccp_pass::get_value(const operand& value) const {
+    lattice_t result;
+    if (value.is_constant()) {
+        result.kind = state::constant;
+        result.value = value;
+    }
+    else if (value.is(operand::kind::temp))
+        result = values_[value.id()];
+    else
+        result.kind = state::bottom;
+    return result;
+}
+
+void sccp_pass::add_edge(const size_t from, const size_t to) {
+    const auto edge = std::make_pair(from, to);
+    if (find(edges_.begin(), edges_.end(), edge) != edges_.end())
+        return;
+    edges_.push_back(edge);
+    flow_work_.push_back(edge);
+}
+
+void sccp_pass::visit(const size_t block, const size_t index) {
+    const auto& instruction = function_->block(block).instructions()[index];
+    if (instruction.is_phi()) {
+        visit_phi(block, instruction);
+        return;
+    }
+    const auto& args = instruction.args();
+    switch (instruction.op()) {
+    case instruction::opcode::jmp:
+        add_edge(block, args[0].id());
+        return;
+    case instruction::opcode::br:
+    {
+        const auto condition = get_value(args[0]);
+        if (condition.kind == state::constant)
+            add_edge(block, condition.value.int_value() ? args[1].id() : args[2].id());
+        else if (condition.kind == state::bottom) {
+            add_edge(block, args[1].id());
+            add_edge(block, args[2].id());
+        }
+        return;
+    }
+    default:
+        if (instruction.result().is(operand::kind::temp))
+            set_value(instruction.result(), evaluate(instruction));
+    }
+}
+
+void sccp_pass::visit_phi(const size_t block, const instruction& instruction) {
+    lattice_t result;
+    const auto& args = instruction.args();
+    for (size_t i = 0; i < args.size() && result.kind != state::bottom; i += 2) {
+        if (find(edges_.begin(), edges_.end(), std::make_pair(args[i].id(), block)) == edges_.end())
+            continue;
+        const auto value = get_value(args[i + 1]);
+        if (value.kind == state::top)
+            continue;
+        if (value.kind == state::bottom || (result.kind == state::constant && result.value != value.value))
+            result.kind = state::bottom;
+        else
+            result = value;
+    }
+    set_value(instruction.result(), result);
+}
+
+void sccp_pass::set_value(const operand& result, const lattice_t& value) {
+    auto& current = values_[result.id()];
+    if (current.kind == state::bottom || (current.kind == value.kind && current.value == value.value))
+        return;
+    current = value.kind == state::constant && current.kind == state::constant ? lattice_t{ state::bottom, operand() } : value;
+    ssa_work_.push_back(result.id());
+}
+
+sccp_pass::lattice_t sccp_pass::evaluate(const instruction& instruction) const {
+    switch (instruction.op()) {
+    case instruction::opcode::mov:
+    case instruction::opcode::add:
+    case instruction::opcode::sub:
+    case instruction::opcode::mul:
+    case instruction::opcode::div:
+    case instruction::opcode::mod:
+    case instruction::opcode::and:
+    case instruction::opcode::or:
+    case instruction::opcode::xor:
+    case instruction::opcode::shl:
+    case instruction::opcode::shr:
+    case instruction::opcode::neg:
+    case instruction::opcode::not:
+    case instruction::opcode::eq:
+    case instruction::opcode::ne:
+    case instruction::opcode::lt:
+    case instruction::opcode::le:
+    case instruction::opcode::gt:
+    case instruction::opcode::ge:
+    case instruction::opcode::cast:
+        break;
+    default:
+        return { state::bottom, operand() };
+    }
+    std::vector<operand> args;
+    for (const auto& it : instruction.args()) {
+        const auto value = get_value(it);
+        if (value.kind != state::constant)
+            return { value.kind, operand() };
+        args.push_back(value.value);
+    }
+    operand result;
+    if (!fold(instruction.op(), instruction.result().type(), args, result))
+        return { state::bottom, operand() };
+    return { state::constant, result };
+}
+
+bool sccp_pass::fold(const instruction::opcode op, const value_type type, const std::vector<operand>& args, operand& result) {
+    const auto is_real = args[0].type() == value_type::real;
+    switch (op) {
+    case instruction::opcode::mov:
+        result = is_real ? args[0] : operand::make_integer(args[0].int_value(), type);
+        return true;
+    case instruction::opcode::cast:
+        if (type == value_type::real) {
+            result = is_real ? args[0] : operand::make_real(static_cast<double>(args[0].int_value()));
+            return true;
+        }
+        if (is_real) {
+            if (!(args[0].real_value() > -2147483649.0 && args[0].real_value() < 2147483648.0))
+                return false;
+            const auto value = static_cast<long long>(args[0].real_value());
+            result = operand::make_integer(type == value_type::character ? to_char(value) : value, type);
+            return true;
+        }
+        result = operand::make_integer(type == value_type::character ? to_char(args[0].int_value()) : args[0].int_value(), type);
+        return true;
+    case instruction::opcode::neg:
+        result = is_real ? operand::make_real(-args[0].real_value()) : operand::make_integer(to_int(-args[0].int_value()));
+        return true;
+    case instruction::opcode::not:
+        result = operand::make_integer(to_int(~args[0].int_value()));
+        return true;
+    case instruction::opcode::eq:
+    case instruction::opcode::ne:
+    case instruction::opcode::lt:
+    case instruction::opcode::le:
+    case instruction::opcode::gt:
+    case instruction::opcode::ge:
+    {
+        int compare;
+        if (is_real && (std::isnan(args[0].real_value()) || std::isnan(args[1].real_value())))
+            return false;
+        if (is_real)
+            compare = args[0].real_value() < args[1].real_value() ? -1 : args[0].real_value() > args[1].real_value() ? 1 : 0;
+        else
+            compare = args[0].int_value() < args[1].int_value() ? -1 : args[0].int_value() > args[1].int_value() ? 1 : 0;
+        bool value;
+        switch (op) {
+        case instruction::opcode::eq: value = compare == 0; break;
+        case instruction::opcode::ne: value = compare != 0; break;
+        case instruction::opcode::lt: value = compare < 0; break;
+        case instruction::opcode::le: value = compare <= 0; break;
+        case instruction::opcode::gt: value = compare > 0; break;
+        default: value = compare >= 0;
+        }
+        result = operand::make_integer(value ? -1 : 0);
+        return true;
+    }
+    default:
+        break;
+    }
+    if (type == value_type::real) {
+        const auto a = args[0].real_value(), b = args[1].real_value();
+        switch (op) {
+        case instruction::opcode::add: result = operand::make_real(a + b); return true;
+        case instruction::opcode::sub: result = operand::make_real(a - b); return true;
+        case instruction::opcode::mul: result = operand::make_real(a * b); return true;
+        case instruction::opcode::div:
+            if (b == 0)
+                return false;
+            result = operand::make_real(a / b);
+            return true;
+        default: return false;
+        }
+    }
+    const auto a = args[0].int_value(), b = args[1].int_value();
+    switch (op) {
+    case instruction::opcode::add: result = operand::make_integer(to_int(a + b), type); return true;
+    case instruction::opcode::sub: result = operand::make_integer(to_int(a - b), type); return true;
+    case instruction::opcode::mul: result = operand::make_integer(to_int(a * b), type); return true;
+    case instruction::opcode::div:
+    case instruction::opcode::mod:
+        if (b == 0 || (a == to_int(0x80000000LL) && b == -1))
+            return false;
+        result = operand::make_integer(op == instruction::opcode::div ? a / b : a % b, type);
+        return true;
+    case instruction::opcode::and: result = operand::make_integer(a & b, type); return true;
+    case instruction::opcode::or: result = operand::make_integer(a | b, type); return true;
+    case instruction::opcode::xor: result = operand::make_integer(a ^ b, type); return true;
+    case instruction::opcode::shl:
+        result = operand::make_integer(to_int(static_cast<unsigned int>(a) << (b & 31)), type);
+        return true;
+    case instruction::opcode::shr:
+        result = operand::make_integer(to_int(static_cast<unsigned int>(a) >> (b & 31)), type);
+        return true;
+    default:
+        return false;
+    }
+}
+
+// class gvn_pass
+void gvn_pass::run(function& function) {
+    function_ = &function;
+    function.update_cfg();
+    replacements_.assign(function.temps().size(), operand());
+    values_.clear();
+    visit(dominator_tree::dominators(function), 0);
+    replace_uses(function, replacements_);
+}
+
+operand gvn_pass::replacement(const operand& value) const {
+    auto result = value;
+    while (result.is(operand::kind::temp) && !replacements_[result.id()].is(operand::kind::none))
+        result = replacements_[result.id()];
+    return result;
+}
+
+void gvn_pass::visit(const dominator_tree& tree, const size_t id) {
+    std::vector<std::string> keys;
+    std::unordered_map<std::string, operand> memory;
+    auto& instructions = function_->block(id).instructions();
+    for (size_t i = 0; i < instructions.size(); ) {
+        auto& it = instructions[i];
+        for (auto& arg : it.args())
+            arg = replacement(arg);
+        if (it.op() == instruction::opcode::load ||
+            (it.op() == instruction::opcode::mov && it.args()[0].is(operand::kind::variable))) {
+            const auto k = it.args()[0].to_string() + std::to_string(static_cast<unsigned char>(it.result().type()));
+            const auto found = memory.find(k);
+            if (found != memory.end() && it.result().is(operand::kind::temp)) {
+                replacements_[it.result().id()] = found->second;
+                instructions.erase(instructions.begin() + i);
+                ++statistics_.values_numbered;
+                ++statistics_.instructions_removed;
+                continue;
+            }
+            if (it.result().is(operand::kind::temp))
+                memory[k] = it.result();
+        }
+        else if (it.op() == instruction::opcode::store || it.op() == instruction::opcode::copy ||
+            it.op() == instruction::opcode::call || it.result().is(operand::kind::variable))
+            memory.clear();
+        operand value;
+        if (it.result().is(operand::kind::temp) && simplify(it, value)) {
+            replacements_[it.result().id()] = value;
+            instructions.erase(instructions.begin() + i);
+            ++statistics_.values_numbered;
+            ++statistics_.instructions_removed;
+            continue;
+        }
+        const auto k = it.result().is(operand::kind::temp) ? key(it) : std::string();
+        if (!k.empty()) {
+            const auto found = values_.find(it.is_phi() ? std::to_string(id) + k : k);
+            if (found != values_.end()) {
+                replacements_[it.result().id()] = found->second;
+                instructions.erase(instructions.begin() + i);
+                ++statistics_.values_numbered;
+                ++statistics_.instructions_removed;
+                continue;
+            }
+            keys.push_back(it.is_phi() ? std::to_string(id) + k : k);
+            values_[keys.back()] = it.result();
+        }
+        ++i;
+    }
+    for (const auto it : tree.children(id))
+        visit(tree, it);
+    for (const auto& it : keys)
+        values_.erase(it);
+}
+
+bool gvn_pass::simplify(const instruction& instruction, operand& result) const {
+    const auto& args = instruction.args();
+    if (instruction.is_phi()) {
+        for (size_t i = 1; i < args.size(); i += 2) {
+            if (args[i] == instruction.result())
+                continue;
+            if (!result.is(operand::kind::none) && result != args[i])
+                return false;
+            result = args[i];
+        }
+        return !result.is(operand::kind::none);
+    }
+    if (instruction.op() == instruction::opcode::mov && !args[0].is(operand::kind::variable) &&
+        args[0].type() == instruction.result().type()) {
+        result = args[0];
+        return true;
+    }
+    if (instruction.result().type() == value_type::real || args.size() != 2)
+        return false;
+    const auto is_zero = [](const operand& value) { return value.is(operand::kind::integer) && value.int_value() == 0; };
+    const auto is_one = [](const operand& value) { return value.is(operand::kind::integer) && value.int_value() == 1; };
+    switch (instruction.op()) {
+    case instruction::opcode::add:
+    case instruction::opcode::or:
+    case instruction::opcode::xor:
+        if (is_zero(args[0]) && args[1].type() == instruction.result().type()) {
+            result = args[1];
+            return true;
+        }
+        [[fallthrough]];
+    case instruction::opcode::sub:
+    case instruction::opcode::shl:
+    case instruction::opcode::shr:
+        if (is_zero(args[1]) && args[0].type() == instruction.result().type()) {
+            result = args[0];
+            return true;
+        }
+        return false;
+    case instruction::opcode::mul:
+        if (is_one(args[0]) && args[1].type() == instruction.result().type()) {
+            result = args[1];
+            return true;
+        }
+        [[fallthrough]];
+    case instruction::opcode::div:
+        if (is_one(args[1]) && args[0].type() == instruction.result().type()) {
+            result = args[0];
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+std::string gvn_pass::key(const instruction& instruction) {
+    switch (instruction.op()) {
+    case instruction::opcode::div:
+    case instruction::opcode::mod:
+        if (instruction.has_side_effects())
+            return "";
+    case instruction::opcode::add:
+    case instruction::opcode::sub:
+    case instruction::opcode::mul:
+    case instruction::opcode::and:
+    case instruction::opcode::or:
+    case instruction::opcode::xor:
+    case instruction::opcode::shl:
+    case instruction::opcode::shr:
+    case instruction::opcode::neg:
+    case instruction::opcode::not:
+    case instruction::opcode::eq:
+    case instruction::opcode::ne:
+    case instruction::opcode::lt:
+    case instruction::opcode::le:
+    case instruction::opcode::gt:
+    case instruction::opcode::ge:
+    case instruction::opcode::cast:
+    case instruction::opcode::addr:
+    case instruction::opcode::phi:
+    case instruction::opcode::splat:
+    case instruction::opcode::reduce:
+        break;
+    default:
+        return "";
+    }
+    std::vector<std::string> args;
+    for (const auto& it : instruction.args())
+        args.push_back(it.to_string() + (it.type() == value_type::real ? "r" : ""));
+    switch (instruction.op()) {
+    case instruction::opcode::add:
+    case instruction::opcode::mul:
+    case instruction::opcode::and:
+    case instruction::opcode::or:
+    case instruction::opcode::xor:
+    case instruction::opcode::eq:
+    case instruction::opcode::ne:
+        sort(args.begin(), args.end());
+        break;
+    default:
+        break;
+    }
+    auto result = instruction::opcode_str[static_cast<unsigned char>(instruction.op())] +
+        std::to_string(static_cast<unsigned char>(instruction.result().type()));
+    for (const auto& it : args)
+        result += ' ' + it;
+    return result;
+}
+
+// class adce_pass
+void adce_pass::run(function& function) {
+    function.update_cfg();
+    const auto tree = dominator_tree::post_dominators(function);
+    const auto exit = tree.root();
+    auto& blocks = function.blocks();
+    std::vector<std::vector<bool>> live(blocks.size());
+    std::vector<bool> block_live(blocks.size(), false);
+    std::vector<std::pair<size_t, size_t>> definitions(function.temps().size()), work;
+    for (const auto& block : blocks) {
+        live[block.id()].assign(block.instructions().size(), false);
+        for (size_t i = 0; i < block.instructions().size(); ++i)
+            if (block.instructions()[i].result().is(operand::kind::temp))
+                definitions[block.instructions()[i].result().id()] = { block.id(), i };
+    }
+    const auto mark = [&live, &work](const size_t block, const size_t index) {
+        if (live[block][index])
+            return;
+        live[block][index] = true;
+        work.emplace_back(block, index);
+    };
+    for (const auto& block : blocks)
+        for (size_t i = 0; i < block.instructions().size(); ++i) {
+            const auto& it = block.instructions()[i];
+            if (it.op() == instruction::opcode::br ? tree.idom(block.id()) == exit :
+                it.op() != instruction::opcode::jmp && it.has_side_effects())
+                mark(block.id(), i);
+        }
+    const auto find_target = [&tree, &blocks, &block_live, exit](const size_t id) {
+        auto target = tree.idom(id);
+        while (target != exit && !block_live[target])
+            target = tree.idom(target);
+        return target == exit || blocks[target].instructions().front().is_phi() ? exit : target;
+    };
+    while (!work.empty()) {
+        while (!work.empty()) {
+            const auto current = work.back(); work.pop_back();
+            const auto& it = blocks[current.first].instructions()[current.second];
+            for (const auto& arg : it.args())
+                if (arg.is(operand::kind::temp))
+                    mark(definitions[arg.id()].first, definitions[arg.id()].second);
+                else if (it.is_phi() && arg.is(operand::kind::block))
+                    mark(arg.id(), blocks[arg.id()].instructions().size() - 1);
+            if (block_live[current.first])
+                continue;
+            block_live[current.first] = true;
+            for (const auto c : tree.frontier(current.first))
+                if (c != exit)
+                    mark(c, blocks[c].instructions().size() - 1);
+        }
+        for (const auto& block : blocks)
+            if (block.instructions().back().op() == instruction::opcode::br && !live[block.id()].back() &&
+                find_target(block.id()) == exit)
+                mark(block.id(), block.instructions().size() - 1);
+    }
+    for (auto& block : blocks) {
+        auto& last = block.instructions().back();
+        if (last.op() != instruction::opcode::br || live[block.id()].back())
+            continue;
+        last = instruction(instruction::opcode::jmp, operand(), { operand::make_block(find_target(block.id())) });
+        ++statistics_.instructions_removed;
+    }
+    for (auto& block : blocks) {
+        auto& instructions = block.instructions();
+        std::vector<instruction> result;
+        for (size_t i = 0; i < instructions.size(); ++i)
+            if (live[block.id()][i] || instructions[i].is_terminator())
+                result.push_back(instructions[i]);
+        statistics_.instructions_removed += instructions.size() - result.size();
+        instructions = std::move(result);
+    }
+    function.remove_unreachable_blocks();
+}
+
+// class licm_pass
+void licm_pass::run(function& function) {
+    function.update_cfg();
+    if (insert_preheaders(function, find_loops(function)))
+        function.update_cfg();
+    const auto loops = find_loops(function);
+    const auto tree = dominator_tree::dominators(function);
+    std::vector<size_t> definitions(function.temps().size(), static_cast<size_t>(-1));
+    for (const auto& block : function.blocks())
+        for (const auto& it : block.instructions())
+            if (it.result().is(operand::kind::temp))
+                definitions[it.result().id()] = block.id();
+    for (const auto& loop : loops) {
+        const auto preheader = get_preheader(function, loop);
+        if (preheader == static_cast<size_t>(-1))
+            continue;
+        auto memory_written = false;
+        for (const auto& block : function.blocks())
+            if (loop.blocks[block.id()])
+                for (const auto& it : block.instructions())
+                    memory_written = memory_written || it.op() == instruction::opcode::store ||
+                        it.op() == instruction::opcode::copy || it.op() == instruction::opcode::call ||
+                        it.result().is(operand::kind::variable);
+        const auto is_invariant = [&](const operand& value) {
+            if (value.is(operand::kind::temp))
+                return !loop.blocks[definitions[value.id()]];
+            return !value.is(operand::kind::variable) || !memory_written;
+        };
+        auto changed = true;
+        while (changed) {
+            changed = false;
+            for (const auto id : tree.order()) {
+                if (!loop.blocks[id])
+                    continue;
+                auto& instructions = function.block(id).instructions();
+                for (size_t i = 0; i < instructions.size(); ) {
+                    const auto& it = instructions[i];
+                    if (!it.result().is(operand::kind::temp) || !is_hoistable(it, memory_written) ||
+                        (it.op() != instruction::opcode::addr && !all_of(it.args().begin(), it.args().end(), is_invariant))) {
+                        ++i;
+                        continue;
+                    }
+                    auto& target = function.block(preheader).instructions();
+                    target.insert(target.end() - 1, it);
+                    definitions[it.result().id()] = preheader;
+                    instructions.erase(instructions.begin() + i);
+                    ++statistics_.instructions_hoisted;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+bool licm_pass::is_hoistable(const instruction& instruction, const bool memory_written) {
+    switch (instruction.op()) {
+    case instruction::opcode::mov:
+    case instruction::opcode::add:
+    case instruction::opcode::sub:
+    case instruction::opcode::mul:
+    case instruction::opcode::and:
+    case instruction::opcode::or:
+    case instruction::opcode::xor:
+    case instruction::opcode::shl:
+    case instruction::opcode::shr:
+    case instruction::opcode::neg:
+    case instruction::opcode::not:
+    case instruction::opcode::eq:
+    case instruction::opcode::ne:
+    case instruction::opcode::lt:
+    case instruction::opcode::le:
+    case instruction::opcode::gt:
+    case instruction::opcode::ge:
+    case instruction::opcode::cast:
+    case instruction::opcode::addr:
+    case instruction::opcode::splat:
+    case instruction::opcode::reduce:
+        return true;
+    case instruction::opcode::div:
+    case instruction::opcode::mod:
+        return instruction.args()[1].is(operand::kind::integer) && instruction.args()[1].int_value() != 0;
+    case instruction::opcode::load:
+        return !memory_written;
+    default:
+        return false;
+    }
+}
+
+// class strength_reduction_pass
+void strength_reduction_pass::run(function& function) {
+    const auto none = static_cast<size_t>(-1);
+    function_ = &function;
+    function.update_cfg();
+    if (insert_preheaders(function, find_loops(function)))
+        function.update_cfg();
+    const auto loops = find_loops(function);
+    const auto order = dominator_tree::dominators(function).order();
+    for (const auto& loop : loops) {
+        const auto preheader = get_preheader(function, loop);
+        auto latch = none;
+        size_t latches = 0;
+        for (const auto p : function.block(loop.header).predecessors())
+            if (loop.blocks[p]) {
+                latch = p;
+                ++latches;
+            }
+        if (preheader == none || latches != 1)
+            continue;
+        std::vector<size_t> definitions(function.temps().size(), none);
+        for (const auto& block : function.blocks())
+            for (const auto& it : block.instructions())
+                if (it.result().is(operand::kind::temp))
+                    definitions[it.result().id()] = block.id();
+        analyze(loop, definitions, order);
+        std::vector<bool> used(function.temps().size(), false);
+        for (const auto& block : function.blocks())
+            for (const auto& it : block.instructions())
+                if (!loop.blocks[block.id()] || it.is_phi() || !it.result().is(operand::kind::temp) ||
+                    values_[it.result().id()].iv == none)
+                    for (const auto& arg : it.args())
+                        if (arg.is(operand::kind::temp))
+                            used[arg.id()] = true;
+        std::vector<instruction> candidates;
+        for (const auto id : order)
+            if (loop.blocks[id])
+                for (const auto& it : function.block(id).instructions()) {
+                    if (it.is_phi() || !it.result().is(operand::kind::temp) || !used[it.result().id()])
+                        continue;
+                    const auto& value = values_[it.result().id()];
+                    if (value.iv != none && (value.scale != 1 || !value.base.is(operand::kind::none)))
+                        candidates.push_back(it);
+                }
+        if (candidates.empty())
+            continue;
+        std::vector<operand> replacements(function.temps().size());
+        for (const auto& it : candidates) {
+            const auto value = values_[it.result().id()];
+            operand init, next;
+            for (const auto& phi : function.block(loop.header).instructions()) {
+                if (!phi.is_phi())
+                    break;
+                if (phi.result().id() != value.iv)
+                    continue;
+                for (size_t i = 0; i + 1 < phi.args().size(); i += 2)
+                    (phi.args()[i].id() == preheader ? init : next) = phi.args()[i + 1];
+            }
+            const auto step = to_int(values_[next.id()].offset * value.scale);
+            const auto type = it.result().type();
+            const auto start = reduce(value, type, init, preheader);
+            const auto current = function.new_temp(type), advanced = function.new_temp(type);
+            auto& header = function.block(loop.header).instructions();
+            header.insert(header.begin(), instruction(instruction::opcode::phi, current, {
+                operand::make_block(preheader), start, operand::make_block(latch), advanced }));
+            auto& tail = function.block(latch).instructions();
+            tail.insert(tail.end() - 1, instruction(instruction::opcode::add, advanced,
+                { current, operand::make_integer(step) }));
+            replacements[it.result().id()] = current;
+            ++statistics_.values_reduced;
+        }
+        replacements.resize(function.temps().size());
+        replace_uses(function, replacements);
+    }
+}
+
+void strength_reduction_pass::analyze(const loop_t& loop, const std::vector<size_t>& definitions, const std::vector<size_t>& order) {
+    const auto none = static_cast<size_t>(-1);
+    std::vector<size_t> ivs;
+    for (const auto& it : function_->block(loop.header).instructions()) {
+        if (!it.is_phi())
+            break;
+        if (it.result().type() == value_type::integer || it.result().type() == value_type::pointer)
+            ivs.push_back(it.result().id());
+    }
+    for (auto round = 0; round < 2; ++round) {
+        values_.assign(function_->temps().size(), affine_t());
+        for (const auto it : ivs)
+            values_[it] = { it, 1, operand(), 0 };
+        for (const auto id : order)
+            if (loop.blocks[id])
+                for (const auto& it : function_->block(id).instructions()) {
+                    affine_t value;
+                    if (!it.is_phi() && it.result().is(operand::kind::temp) && evaluate(it, loop, definitions, value))
+                        values_[it.result().id()] = value;
+                }
+        std::vector<size_t> valid;
+        for (const auto& it : function_->block(loop.header).instructions()) {
+            if (!it.is_phi())
+                break;
+            if (find(ivs.begin(), ivs.end(), it.result().id()) == ivs.end())
+                continue;
+            auto induction = true;
+            for (size_t i = 0; i + 1 < it.args().size(); i += 2) {
+                const auto& arg = it.args()[i + 1];
+                if (!loop.blocks[it.args()[i].id()])
+                    continue;
+                induction = induction && arg.is(operand::kind::temp) && values_[arg.id()].iv == it.result().id() &&
+                    values_[arg.id()].scale == 1 && values_[arg.id()].base.is(operand::kind::none);
+            }
+            if (induction)
+                valid.push_back(it.result().id());
+        }
+        if (valid.size() == ivs.size() && round > 0)
+            break;
+        ivs = valid;
+    }
+    for (auto& it : values_)
+        if (it.iv != none && find(ivs.begin(), ivs.end(), it.iv) == ivs.end())
+            it = affine_t();
+}
+
+bool strength_reduction_pass::evaluate(const instruction& instruction, const loop_t& loop, const std::vector<size_t>& definitions, affine_t& result) const {
+    const auto none = static_cast<size_t>(-1);
+    const auto type = instruction.result().type();
+    if (type != value_type::integer && type != value_type::pointer)
+        return false;
+    const auto get = [this, none](const operand& value) {
+        return value.is(operand::kind::temp) && values_[value.id()].iv != none ? &values_[value.id()] : nullptr;
+    };
+    const auto is_invariant = [&loop, &definitions, none](const operand& value) {
+        return value.is(operand::kind::temp) && definitions[value.id()] != none && !loop.blocks[definitions[value.id()]];
+    };
+    const auto& args = instruction.args();
+    switch (instruction.op()) {
+    case instruction::opcode::mov:
+        if (const auto a = get(args[0])) {
+            result = *a;
+            return true;
+        }
+        return false;
+    case instruction::opcode::add:
+    case instruction::opcode::sub:
+    {
+        const auto sign = instruction.op() == instruction::opcode::add ? 1 : -1;
+        for (size_t i = 0; i < 2; ++i) {
+            const auto a = get(args[i]);
+            const auto& other = args[1 - i];
+            if (!a || (i == 1 && sign < 0))
+                continue;
+            if (other.is(operand::kind::integer)) {
+                result = *a;
+                result.offset = to_int(result.offset + sign * other.int_value());
+                return true;
+            }
+            if (sign > 0 && a->base.is(operand::kind::none) && is_invariant(other)) {
+                result = *a;
+                result.base = other;
+                return true;
+            }
+        }
+        return false;
+    }
+    case instruction::opcode::mul:
+    case instruction::opcode::shl:
+        for (size_t i = 0; i < 2; ++i) {
+            const auto a = get(args[i]);
+            const auto& other = args[1 - i];
+            if (!a || !a->base.is(operand::kind::none) || !other.is(operand::kind::integer) ||
+                (instruction.op() == instruction::opcode::shl && (i == 1 || other.int_value() < 0 || other.int_value() > 30)))
+                continue;
+            const auto factor = instruction.op() == instruction::opcode::mul ? other.int_value() : 1ll << other.int_value();
+            result = *a;
+            result.scale = to_int(result.scale * factor);
+            result.offset = to_int(result.offset * factor);
+            return true;
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+operand strength_reduction_pass::reduce(const affine_t& value, const value_type type, const operand& init, const size_t preheader) {
+    const auto emit = [this, preheader](const instruction::opcode op, const operand& a, const operand& b, const value_type type) {
+        const auto result = function_->new_temp(type);
+        auto& instructions = function_->block(preheader).instructions();
+        instructions.insert(instructions.end() - 1, instruction(op, result, { a, b }));
+        return result;
+    };
+    const auto offset_type = value.base.is(operand::kind::none) ? type : value_type::integer;
+    auto result = init;
+    if (init.is(operand::kind::integer))
+        result = operand::make_integer(to_int(init.int_value() * value.scale + value.offset), offset_type);
+    else {
+        if (value.scale != 1)
+            result = emit(instruction::opcode::mul, result, operand::make_integer(value.scale), offset_type);
+        if (value.offset != 0)
+            result = emit(instruction::opcode::add, result, operand::make_integer(value.offset), offset_type);
+    }
+    if (value.base.is(operand::kind::none))
+        return result;
+    if (result.is(operand::kind::integer) && result.int_value() == 0)
+        return value.base;
+    return emit(instruction::opcode::add, value.base, result, type);
+}
+
+// class pass_manager
+const pass_manager::passes_t& pass_manager::registered_passes() {
+    static const passes_t passes = {
+        { "sccp", [] { return std::make_shared<sccp_pass>(); } },
+        { "gvn", [] { return std::make_shared<gvn_pass>(); } },
+        { "adce", [] { return std::make_shared<adce_pass>(); } },
+        { "licm", [] { return std::make_shared<licm_pass>(); } },
+        { "strength", [] { return std::make_shared<strength_reduction_pass>(); } }
+    };
+    return passes;
+}
+
+pass_manager::pass_manager(const level level) {
+    switch (level) {
+    case level::full:
+        add_pass("sccp");
+        add_pass("gvn");
+        add_pass("licm");
+        add_pass("strength");
+        add_pass("adce");
+        break;
+    case level::basic:
+        add_pass("sccp");
+        break;
+    case level::none:
+        break;
+    }
+}
+
+pass_manager::pass_manager(const std::string& passes) {
+    size_t start = 0;
+    while (start <= passes.size()) {
+        auto end = passes.find(',', start);
+        if (end == std::string::npos)
+            end = passes.size();
+        if (end > start)
+            add_pass(passes.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+void pass_manager::add_pass(const std::string& name) {
+    for (const auto& it : registered_passes())
+        if (it.first == name) {
+            passes_.push_back({ name, it.second() });
+            return;
+        }
+    throw pascal_compiler::optimizer::unknown_pass_exception(name);
+}
+
+void pass_manager::optimize(module& module, const bool keep_ssa) {
+    iterations_ = 0;
+    if (passes_.empty())
+        return;
+    for (const auto& f : module.functions()) {
+        construct_ssa(*f, module);
+        size_t iterations = 0;
+        auto changed = true;
+        while (changed && iterations < max_iterations) {
+            ++iterations;
+            changed = false;
+            for (auto& it : passes_)
+                changed = run_pass(it, *f) || changed;
+        }
+        iterations_ = std::max(iterations_, iterations);
+        if (keep_ssa)
+            continue;
+        destruct_ssa(*f);
+        f->simplify_cfg();
+        f->remove_unused_temps();
+    }
+}
+
+bool pass_manager::run_pass(pass_t& pass, function& function) {
+    const auto before = pass.pass->statistics();
+    const auto start = std::chrono::steady_clock::now();
+    pass.pass->run(function);
+    pass.time += std::chrono::steady_clock::now() - start;
+    const auto& after = pass.pass->statistics();
+    return after.instructions_removed != before.instructions_removed ||
+        after.values_folded != before.values_folded || after.values_numbered != before.values_numbered ||
+        after.instructions_hoisted != before.instructions_hoisted || after.values_reduced != before.values_reduced;
+}
+
+std::string pass_manager::to_string() const {
+    std::string result = str(boost::format("%-12s %10s %10s %10s %10s %10s %10s\n") %
+        "pass" % "time, ms" % "removed" % "folded" % "numbered" % "hoisted" % "reduced");
+    for (const auto& it : passes_)
+        result += str(boost::format("%-12s %10.3f %10d %10d %10d %10d %10d\n") % it.name % it.time.count() %
+            it.pass->statistics().instructions_removed % it.pass->statistics().values_folded %
+            it.pass->statistics().values_numbered % it.pass->statistics().instructions_hoisted %
+            it.pass->statistics().values_reduced);
+    result += str(boost::format("iterations: %1%\n") % iterations_);
+    return result;
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include "ir.hpp"
+#include "ssa.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace ir {
+
+        class basic_pass {
+
+        public:
+
+            struct statistics_t {
+                size_t instructions_removed = 0;
+                size_t values_folded = 0;
+                size_t values_numbered = 0;
+                size_t instructions_hoisted = 0;
+                size_t values_reduced = 0;
+            };
+
+            virtual ~basic_pass() = default;
+
+            virtual void run(function& function) = 0;
+
+            const statistics_t& statistics() const;
+
+        protected:
+
+            struct loop_t {
+                size_t header;
+                std::vector<bool> blocks;
+                size_t size;
+            };
+
+            statistics_t statistics_;
+
+            static void replace_uses(function& function, const std::vector<operand>& replacements);
+            static std::vector<loop_t> find_loops(const function& function);
+            static bool insert_preheaders(function& function, const std::vector<loop_t>& loops);
+            static size_t get_preheader(const function& function, const loop_t& loop);
+
+        };// class basic_pass
+
+        class sccp_pass : public basic_pass {
+
+        public:
+
+            void run(function& function) override;
+
+        private:
+
+            enum class state : unsigned char {
+                top, constant, bottom
+            };
+
+            struct lattice_t {
+                state kind = state::top;
+                operand value;
+            };
+
+            function* function_ = nullptr;
+            std::vector<lattice_t> values_;
+            std::vector<bool> executable_;
+            std::vector<std::pair<size_t, size_t>> edges_, flow_work_;
+            std::vector<size_t> ssa_work_;
+            std::vector<std::vector<std::pair<size_t, size_t>>> uses_;
+
+            lattice_t get_value(const operand& value) const;
+            void add_edge(const size_t from, const size_t to);
+            void visit(const size_t block, const size_t index);
+            void visit_phi(const size_t block, const instruction& instruction);
+            void set_value(const operand& result, const lattice_t& value);
+            lattice_t evaluate(const instruction& instruction) const;
+            static bool fold(const instruction::opcode op, const value_type type, const std::vector<operand>& args, operand& result);
+
+        };// class sccp_pass
+
+        class gvn_pass : public basic_pass {
+
+        public:
+
+            void run(function& function) override;
+
+        private:
+
+            function* function_ = nullptr;
+            std::vector<operand> replacements_;
+            std::unordered_map<std::string, operand> values_;
+
+            void visit(const dominator_tree& tree, const size_t id);
+            operand replacement(const operand& value) const;
+            bool simplify(const instruction& instruction, operand& result) const;
+            static std::string key(const instruction& instruction);
+
+        };// class gvn_pass
+
+        class adce_pass : public basic_pass {
+
+        public:
+
+            void run(function& function) override;
+
+        };// class adce_pass
+
+        class licm_pass : public basic_pass {
+
+        public:
+
+            void run(function& function) override;
+
+        private:
+
+            static bool is_hoistable(const instruction& instruction, const bool memory_written);
+
+        };// class licm_pass
+
+        class strength_reduction_pass : public basic_pass {
+
+        public:
+
+            void run(function& function) override;
+
+        private:
+
+            struct affine_t {
+                size_t iv = static_cast<size_t>(-1);
+                long long scale = 0;
+                operand base;
+                long long offset = 0;
+            };
+
+            function* function_ = nullptr;
+            std::vector<affine_t> values_;
+
+            void analyze(const loop_t& loop, const std::vector<size_t>& definitions, const std::vector<size_t>& order);
+            bool evaluate(const instruction& instruction, const loop_t& loop, const std::vector<size_t>& definitions, affine_t& result) const;
+            operand reduce(const affine_t& value, const value_type type, const operand& init, const size_t preheader);
+
+        };// class strength_reduction_pass
+
+        class pass_manager {
+
+        public:
+
+            enum class level {
+                none, basic, full
+            };
+
+            pass_manager() = default;
+            explicit pass_manager(const level level);
+            explicit pass_manager(const std::string& passes);
+
+            void add_pass(const std::string& name);
+            void optimize(module& module, const bool keep_ssa = false);
+
+            std::string to_string() const;
+
+        private:
+
+            typedef std::vector<std::pair<std::string, std::function<std::shared_ptr<basic_pass>()>>> passes_t;
+
+            struct pass_t {
+                std::string name;
+                std::shared_ptr<basic_pass> pass;
+                std::chrono::duration<double, std::milli> time = std::chrono::duration<double, std::milli>::zero();
+            };
+
+            static const size_t max_iterations = 16;
+
+            std::vector<pass_t> passes_;
+            size_t iterations_ = 0;
+
+            static const passes_t& registered_passes();
+            static bool run_pass(pass_t& pass, function& function);
+
+        };// class pass_manager
+
+    }// namespace ir
+
+}// namespace pascal_compiler
@@ -0,0 +1,110 @@
+#include "jit.hpp"
+#include "boost/format.hpp"
+#include <cstdio>
+#include <cstring>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace pascal_compiler;
+using namespace code;
+
+const std::unordered_map<std::string, void*> jit::runtime = {
+    { "printf", reinterpret_cast<void*>(&std::printf) }
+};
+
+jit_exception::jit_exception(const std::string& message) {
+    message_ = message;
+}
+
+jit::jit(const encoder& code) {
+#ifdef __linux__
+    std::unordered_map<std::string, size_t> trampolines;
+    for (const auto& it : code.relocations())
+        if (it.segment == encoder::section::external && trampolines.find(it.name) == trampolines.end()) {
+            if (runtime.find(it.name) == runtime.end())
+                throw jit_exception(str(boost::format("Unresolved runtime symbol \"%1%\"") % it.name));
+            trampolines[it.name] = code.text().size() + trampolines.size() * trampoline_size;
+        }
+    gate_ = code.text().size() + trampolines.size() * trampoline_size;
+    const auto text_size = align(gate_ + gate_size);
+    const auto rodata_size = align(code.rodata().size());
+    size_ = text_size + rodata_size + align(code.bss_size() + 8);
+    const auto memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (memory == MAP_FAILED)
+        throw jit_exception("Cannot allocate executable memory");
+    memory_ = static_cast<unsigned char*>(memory);
+    entry_ = code.entry();
+    for (const auto& it : code.symbols())
+        if (it.segment == encoder::section::text)
+            symbols_[it.name] = it.offset;
+    const size_t bases[] = { 0, text_size, text_size + rodata_size };
+    std::memcpy(memory_, code.text().data(), code.text().size());
+    std::memcpy(memory_ + text_size, code.rodata().data(), code.rodata().size());
+    for (const auto& it : trampolines) {
+        const unsigned char jump[] = { 0xff, 0x25, 0, 0, 0, 0 };
+        const auto address = reinterpret_cast<unsigned long long>(runtime.at(it.first));
+        std::memcpy(memory_ + it.second, jump, sizeof jump);
+        std::memcpy(memory_ + it.second + sizeof jump, &address, sizeof address);
+    }
+    write_gate(gate_, reinterpret_cast<unsigned long long>(memory_) + text_size + rodata_size + code.bss_size());
+    for (const auto& it : code.relocations()) {
+        const auto target = it.segment == encoder::section::external
+            ? trampolines[it.name]
+            : bases[static_cast<size_t>(it.segment)];
+        auto value = reinterpret_cast<long long>(memory_) + static_cast<long long>(target) + it.addend;
+        if (it.type != encoder::relocation_type::absolute)
+            value -= reinterpret_cast<long long>(memory_) + static_cast<long long>(it.offset);
+        const auto field = static_cast<int>(value);
+        std::memcpy(memory_ + it.offset, &field, sizeof field);
+    }
+    if (mprotect(memory_, text_size, PROT_READ | PROT_EXEC) != 0 ||
+        mprotect(memory_ + text_size, rodata_size, PROT_READ) != 0) {
+        munmap(memory_, size_);
+        throw jit_exception("Cannot protect executable memory");
+    }
+#else
+    throw jit_exception("Run mode is supported on Linux only");
+#endif
+}
+
+jit::~jit() {
+#ifdef __linux__
+    if (memory_)
+        munmap(memory_, size_);
+#endif
+}
+
+int jit::run() const {
+    const auto result = reinterpret_cast<int(*)()>(memory_ + entry_)();
+    std::fflush(stdout);
+    return result;
+}
+
+const void* jit::gate() const {
+    return memory_ + gate_;
+}
+
+const void* jit::symbol(const std::string& name) const {
+    const auto it = symbols_.find(name);
+    if (it == symbols_.end())
+        throw jit_exception(str(boost::format("Unresolved symbol \"%1%\"") % name));
+    return memory_ + it->second;
+}
+
+void jit::write_gate(const size_t offset, const unsigned long long stack_pointer) {
+    static const unsigned char save[] = { 0x55, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57, 0x48, 0xb8 };
+    static const unsigned char call[] = { 0x48, 0x89, 0x20, 0x48, 0x89, 0xf4, 0x48, 0x89, 0xd5, 0xff, 0xd7, 0x48, 0xb9 };
+    static const unsigned char restore[] = { 0x48, 0x8b, 0x21, 0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5b, 0x5d, 0xc3 };
+    auto position = memory_ + offset;
+    for (const auto& it : { std::make_pair(save, sizeof save), std::make_pair(call, sizeof call) }) {
+        std::memcpy(position, it.first, it.second);
+        std::memcpy(position + it.second, &stack_pointer, sizeof stack_pointer);
+        position += it.second + sizeof stack_pointer;
+    }
+    std::memcpy(position, restore, sizeof restore);
+}
+
+size_t jit::align(const size_t value) {
+    return (value + page_size - 1) / page_size * page_size;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "encoder.hpp"
+#include "exceptions.hpp"
+#include <string>
+#include <unordered_map>
+
+namespace pascal_compiler {
+
+    namespace code {
+
+        class jit_exception : public exception {
+
+        public:
+
+            explicit jit_exception(const std::string& message);
+
+        };
+
+        class jit {
+
+        public:
+
+            explicit jit(const encoder& code);
+            jit(const jit&) = delete;
+            jit& operator=(const jit&) = delete;
+            ~jit();
+
+            int run() const;
+            const void* gate() const;
+            const void* symbol(const std::string& name) const;
+
+        private:
+
+            static const size_t page_size = 4096;
+            static const size_t trampoline_size = 16;
+            static const size_t gate_size = 56;
+            static const std::unordered_map<std::string, void*> runtime;
+
+            unsigned char* memory_ = nullptr;
+            size_t size_ = 0;
+            size_t entry_ = 0;
+            size_t gate_ = 0;
+            std::unordered_map<std::string, size_t> symbols_;
+
+            void write_gate(const size_t offset, const unsigned long long stack_pointer);
+
+            static size_t align(const size_t value);
+
+        };// class jit
+
+    }// namespace code
+
+}// namespace pascal_compiler
@@ -5,6 +5,17 @@
 #include "exceptions.hpp"
 #include "asm_code.hpp"
 #include "operations.hpp"
+#include "ir_builder.hpp"
+#include "ir_generator.hpp"
+#include "ir_optimizer.hpp"
+#include "peephole.hpp"
+#include "encoder.hpp"
+#include "jit.hpp"
+#include "bytecode_generator.hpp"
+#include "vm.hpp"
+#include "tiering.hpp"
+#include <vector>
+#include <algorithm>
 
 void tokenizer_output(const std::string in_file, const std::string out_file) {
     std::ofstream out(out_file);
@@ -34,16 +45,106 @@ void syntax_analyzer_output(const std::string in_file, const std::string out_fil
     }
 }
 
-void generator_output(const std::string in_file, const std::string out_file, bool optimize = false) {
+void ir_output(const std::string in_file, const std::string out_file,
+    const std::shared_ptr<pascal_compiler::ir::pass_manager> ir_optimizer = nullptr, const bool keep_ssa = false,
+    const bool short_circuit = false, const size_t unroll_factor = 0, const bool vectorize = false, const bool fast_math = false) {
     std::ofstream out(out_file);
     pascal_compiler::syntax_analyzer::syntax_analyzer syntax_analyzer(in_file);
-    if (optimize)
-        syntax_analyzer.set_optimizer(std::make_shared<pascal_compiler::optimizer::unreachable_code_optimizer>());
+    try {
+        syntax_analyzer.parse();
+        auto module = pascal_compiler::ir::builder(short_circuit, unroll_factor, vectorize, fast_math).build(syntax_analyzer.tables().back());
+        if (ir_optimizer)
+            ir_optimizer->optimize(module, keep_ssa);
+        out << module.to_string();
+    }
+    catch (const pascal_compiler::exception e) {
+        out << e.what();
+    }
+    catch (const pascal_compiler::syntax_analyzer::tree::convertion_error e) {
+        out << e.what();
+    }
+}
+
+void generator_output(const std::string in_file, const std::string out_file, 
+    const std::shared_ptr<pascal_compiler::optimizer::basic_optimizer> optimizer = nullptr, const bool use_ir = false,
+    const std::shared_ptr<pascal_compiler::ir::pass_manager> ir_optimizer = nullptr, const bool allocate_registers = false,
+    const std::shared_ptr<pascal_compiler::code::peephole_optimizer> peephole_optimizer = nullptr,
+    const bool short_circuit = false, const size_t unroll_factor = 0, const bool vectorize = false, const bool fast_math = false,
+    const pascal_compiler::code::asm_code::target target = pascal_compiler::code::asm_code::target::x86,
+    const bool object_file = false, const bool run = false) {
+    std::ofstream file;
+    if (!run)
+        file.open(out_file, object_file ? std::ios::out | std::ios::binary : std::ios::out);
+    std::ostream& out = run ? std::cout : file;
+    pascal_compiler::syntax_analyzer::syntax_analyzer syntax_analyzer(in_file);
+    if (optimizer)
+        syntax_analyzer.set_optimizer(optimizer);
     try {
         syntax_analyzer.parse();
         pascal_compiler::code::asm_code code;
-        syntax_analyzer.to_asm_code(code);
-        out << code.to_string();
+        code.set_peephole_optimizer(peephole_optimizer);
+        code.set_short_circuit(short_circuit);
+        code.set_target(target);
+        if (!run && !object_file)
+            code.set_output(out);
+        if (use_ir) {
+            auto module = pascal_compiler::ir::builder(short_circuit, unroll_factor, vectorize, fast_math,
+                code.slot_size()).build(syntax_analyzer.tables().back());
+            if (ir_optimizer)
+                ir_optimizer->optimize(module);
+            pascal_compiler::ir::generator(code, allocate_registers).generate(module);
+        }
+        else
+            syntax_analyzer.to_asm_code(code);
+        if (run)
+            pascal_compiler::code::jit(pascal_compiler::code::encoder(code)).run();
+        else if (object_file)
+            pascal_compiler::code::encoder(code).write_elf(out);
+        else
+            code.end_program();
+    }
+    catch (const pascal_compiler::exception e) {
+        out << e.what();
+    }
+    catch (const pascal_compiler::syntax_analyzer::tree::convertion_error e) {
+        out << e.what();
+    }
+
+}
+
+void bytecode_output(const std::string in_file, const std::string out_file,
+    const std::shared_ptr<pascal_compiler::optimizer::basic_optimizer> optimizer = nullptr,
+    const std::shared_ptr<pascal_compiler::ir::pass_manager> ir_optimizer = nullptr, const bool short_circuit = false,
+    const size_t unroll_factor = 0, const bool fast_math = false, const bool run = false, const bool tiered = false,
+    const bool stats = false, const std::pair<size_t, size_t>& thresholds = std::make_pair(
+        size_t(pascal_compiler::bytecode::tiering::default_call_threshold),
+        size_t(pascal_compiler::bytecode::tiering::default_back_edge_threshold))) {
+    std::ofstream file;
+    if (!run)
+        file.open(out_file);
+    std::ostream& out = run ? std::cout : file;
+    pascal_compiler::syntax_analyzer::syntax_analyzer syntax_analyzer(in_file);
+    if (optimizer)
+        syntax_analyzer.set_optimizer(optimizer);
+    try {
+        syntax_analyzer.parse();
+        const auto slot_size = tiered ? 8 : 4;
+        auto module = pascal_compiler::ir::builder(short_circuit, unroll_factor, false, fast_math, slot_size)
+            .build(syntax_analyzer.tables().back());
+        if (ir_optimizer)
+            ir_optimizer->optimize(module);
+        pascal_compiler::bytecode::program code;
+        pascal_compiler::bytecode::generator(code, slot_size).generate(module);
+        if (tiered) {
+            pascal_compiler::bytecode::tiering tiering(module, code, thresholds.first, thresholds.second);
+            tiering.run();
+            if (stats)
+                std::cout << tiering.to_string();
+        }
+        else if (run)
+            pascal_compiler::bytecode::machine(code).run();
+        else
+            out << code.to_string();
     }
     catch (const pascal_compiler::exception e) {
         out << e.what();
@@ -51,7 +152,77 @@ void generator_output(const std::string in_file, const std::string out_file, boo
     catch (const pascal_compiler::syntax_analyzer::tree::convertion_error e) {
         out << e.what();
     }
+}
+
+std::shared_ptr<pascal_compiler::optimizer::pass_manager> make_pass_manager(const std::vector<std::string>& options) {
+    auto result = std::make_shared<pascal_compiler::optimizer::pass_manager>();
+    for (const auto& it : options)
+        if (it == "-O0")
+            result = std::make_shared<pascal_compiler::optimizer::pass_manager>(pascal_compiler::optimizer::pass_manager::level::none);
+        else if (it == "-O1")
+            result = std::make_shared<pascal_compiler::optimizer::pass_manager>(pascal_compiler::optimizer::pass_manager::level::basic);
+        else if (it == "-O2")
+            result = std::make_shared<pascal_compiler::optimizer::pass_manager>(pascal_compiler::optimizer::pass_manager::level::full);
+        else if (it.compare(0, 9, "--passes=") == 0)
+            result = std::make_shared<pascal_compiler::optimizer::pass_manager>(it.substr(9));
+    return result;
+}
+
+std::shared_ptr<pascal_compiler::ir::pass_manager> make_ir_pass_manager(const std::vector<std::string>& options) {
+    auto result = std::make_shared<pascal_compiler::ir::pass_manager>();
+    for (const auto& it : options)
+        if (it == "-O0")
+            result = std::make_shared<pascal_compiler::ir::pass_manager>(pascal_compiler::ir::pass_manager::level::none);
+        else if (it == "-O1")
+            result = std::make_shared<pascal_compiler::ir::pass_manager>(pascal_compiler::ir::pass_manager::level::basic);
+        else if (it == "-O2")
+            result = std::make_shared<pascal_compiler::ir::pass_manager>(pascal_compiler::ir::pass_manager::level::full);
+        else if (it.compare(0, 12, "--ir-passes=") == 0)
+            result = std::make_shared<pascal_compiler::ir::pass_manager>(it.substr(12));
+    return result;
+}
 
+size_t get_unroll_factor(const std::vector<std::string>& options) {
+    size_t result = 0;
+    for (const auto& it : options)
+        if (it == "-O0" || it == "-O1")
+            result = 0;
+        else if (it == "-O2")
+            result = 4;
+        else if (it.compare(0, 9, "--unroll=") == 0)
+            result = std::stoul(it.substr(9));
+    return result;
+}
+
+pascal_compiler::code::asm_code::target get_target(const std::vector<std::string>& options) {
+    auto result = pascal_compiler::code::asm_code::target::x86;
+    for (const auto& it : options)
+        if (it == "--target=x86")
+            result = pascal_compiler::code::asm_code::target::x86;
+        else if (it == "--target=x86-64" || it == "--object")
+            result = pascal_compiler::code::asm_code::target::x86_64;
+    return result;
+}
+
+std::pair<size_t, size_t> get_tier_thresholds(const std::vector<std::string>& options) {
+    auto result = std::make_pair(size_t(pascal_compiler::bytecode::tiering::default_call_threshold),
+        size_t(pascal_compiler::bytecode::tiering::default_back_edge_threshold));
+    for (const auto& it : options)
+        if (it.compare(0, 13, "--tier-calls=") == 0)
+            result.first = std::stoul(it.substr(13));
+        else if (it.compare(0, 18, "--tier-back-edges=") == 0)
+            result.second = std::stoul(it.substr(18));
+    return result;
+}
+
+bool get_vectorize(const std::vector<std::string>& options) {
+    auto result = false;
+    for (const auto& it : options)
+        if (it == "-O0" || it == "-O1" || it == "--no-vectorize")
+            result = false;
+        else if (it == "-O2" || it == "--vectorize")
+            result = true;
+    return result;
 }
 
 int main(const int argc, char* argv[]) {
@@ -60,20 +231,92 @@ int main(const int argc, char* argv[]) {
         return 0;
     }
     const std::string key(argv[1]);
-    if (argc < 3) {
+    std::vector<std::string> args, options;
+    for (auto i = 2; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg.compare(0, 2, "-O") == 0 || arg.compare(0, 2, "--") == 0)
+            options.push_back(arg);
+        else
+            args.push_back(arg);
+    }
+    if (args.empty()) {
         std::cout << "File is not specified";
         return 0;
     }
-    const std::string in_file = argc < 4 ? "output.txt" : argv[3];
+    const std::string in_file = args.size() < 2 ? "output.txt" : args[1];
     if (key == "-l")
-        tokenizer_output(argv[2], in_file);
+        tokenizer_output(args[0], in_file);
     else if (key == "-p")
-        syntax_analyzer_output(argv[2], in_file);
-    else if (key == "-g")
-        generator_output(argv[2], in_file);
+        syntax_analyzer_output(args[0], in_file);
+    else if (key == "-i") {
+        std::shared_ptr<pascal_compiler::ir::pass_manager> ir_manager;
+        try {
+            ir_manager = make_ir_pass_manager(options);
+        }
+        catch (const pascal_compiler::exception& e) {
+            std::cout << e.what();
+            return 0;
+        }
+        ir_output(args[0], in_file, ir_manager, find(options.begin(), options.end(), "--ssa") != options.end(),
+            find(options.begin(), options.end(), "--short-circuit") != options.end(), get_unroll_factor(options),
+            get_vectorize(options), find(options.begin(), options.end(), "--fast-math") != options.end());
+    }
+    else if (key == "-g" || key == "-r") {
+        std::shared_ptr<pascal_compiler::optimizer::pass_manager> manager;
+        std::shared_ptr<pascal_compiler::ir::pass_manager> ir_manager;
+        const auto run = key == "-r";
+        const auto target = run ? pascal_compiler::code::asm_code::target::x86_64 : get_target(options);
+        const auto use_ir = find(options.begin(), options.end(), "--ir") != options.end() ||
+            target == pascal_compiler::code::asm_code::target::x86_64;
+        try {
+            manager = make_pass_manager(options);
+            if (use_ir)
+                ir_manager = make_ir_pass_manager(options);
+        }
+        catch (const pascal_compiler::exception& e) {
+            std::cout << e.what();
+            return 0;
+        }
+        std::shared_ptr<pascal_compiler::code::peephole_optimizer> peephole;
+        if (find(options.begin(), options.end(), "-O2") != options.end() ||
+            find(options.begin(), options.end(), "--peephole") != options.end())
+            peephole = std::make_shared<pascal_compiler::code::peephole_optimizer>();
+        generator_output(args[0], in_file, manager, use_ir, ir_manager,
+            find(options.begin(), options.end(), "--no-regalloc") == options.end(), peephole,
+            find(options.begin(), options.end(), "--short-circuit") != options.end(), get_unroll_factor(options),
+            get_vectorize(options), find(options.begin(), options.end(), "--fast-math") != options.end(), target,
+            find(options.begin(), options.end(), "--object") != options.end(), run);
+        if (find(options.begin(), options.end(), "--stats") != options.end()) {
+            std::cout << manager->to_string();
+            if (ir_manager)
+                std::cout << ir_manager->to_string();
+            if (peephole)
+                std::cout << peephole->to_string();
+        }
+    }
+    else if (key == "-b" || key == "-vm" || key == "-t") {
+        std::shared_ptr<pascal_compiler::optimizer::pass_manager> manager;
+        std::shared_ptr<pascal_compiler::ir::pass_manager> ir_manager;
+        try {
+            manager = make_pass_manager(options);
+            ir_manager = make_ir_pass_manager(options);
+        }
+        catch (const pascal_compiler::exception& e) {
+            std::cout << e.what();
+            return 0;
+        }
+        bytecode_output(args[0], in_file, manager, ir_manager,
+            find(options.begin(), options.end(), "--short-circuit") != options.end(), get_unroll_factor(options),
+            find(options.begin(), options.end(), "--fast-math") != options.end(), key != "-b", key == "-t",
+            find(options.begin(), options.end(), "--stats") != options.end(), get_tier_thresholds(options));
+        if (find(options.begin(), options.end(), "--stats") != options.end())
+            std::cout << manager->to_string() << ir_manager->to_string();
+    }
     else if (key == "-o") {
-        generator_output(argv[2], in_file, true);
+        generator_output(args[0], in_file, std::make_shared<pascal_compiler::optimizer::unreachable_code_optimizer>());
     }
+    else if (key == "-c")
+        generator_output(args[0], in_file, std::make_shared<pascal_compiler::optimizer::constant_folding_optimizer>());
     else
         std::cout << "Unknown key " << key;
 	return 0;
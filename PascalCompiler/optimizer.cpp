@@ -1,8 +1,25 @@
 #include "optimizer.hpp"
+#include "operations.hpp"
+#include "boost/format.hpp"
+#include <cmath>
+#include <cstdint>
 #include <vector>
 
 using namespace pascal_compiler;
 using namespace optimizer;
+using namespace syntax_analyzer::operations;
+
+// class unknown_pass_exception
+unknown_pass_exception::unknown_pass_exception(const std::string& name) {
+    message_ = str(boost::format("Unknown optimization pass \"%1%\"") % name);
+}
+
+// class basic_optimizer
+const basic_optimizer::statistics_t& basic_optimizer::statistics() const {
+    return statistics_;
+}
+
+// class unreachable_code_optimizer
 
 void unreachable_code_optimizer::optimize(const tree_node_p node) {
     if (!node) return;
@@ -33,6 +50,8 @@ void unreachable_code_optimizer::optimize(symbols_table& table) {
                         }
                     if (used.find(v.first) != used.end())
                         used.erase(v.first);
+                    if (v.second.first != nil())
+                        ++statistics_.symbols_dropped;
                     v.second = make_pair(nil(), nullptr);
                     t->table_.table_[v.first] = v.second;
                     remove_assignments(v.first, it.second.second, t->table_);
@@ -94,11 +113,14 @@ void unreachable_code_optimizer::optimization_switch(const tree_node_p node, con
     case tree_node::node_category::function:
     case tree_node::node_category::field_access:
         used_symbols_.insert(std::dynamic_pointer_cast<applied>(node->children_[i])->variable()->name());
+        optimize(node->children_[i]);
         break;
     case tree_node::node_category::operation:
     {
         const auto op = std::dynamic_pointer_cast<operation_node>(node->children_[i]);
         if (op->is_assign()) {
+            if (op->left()->category() != tree_node::node_category::variable)
+                optimization_switch(op, 0);
             optimization_switch(op, 1);
             break;
         }
@@ -109,12 +131,16 @@ void unreachable_code_optimizer::optimization_switch(const tree_node_p node, con
 }
 
 void unreachable_code_optimizer::remove_assignments(const std::string name, const tree_node_p node, const symbols_table& table) const {
+    if (!node)
+        return;
     for (size_t i = 0; i < node->children_.size(); ++i)
         if (node->children_[i] && node->children_[i]->category() == tree_node::node_category::operation) {
             const auto op = std::dynamic_pointer_cast<operation_node>(node->children_[i]);
-            if (op->left()->name() == name)
-                node->children_[i] = nullptr;
+            if (op->is_assign() && op->left()->name() == name)
+                node->children_[i] = std::make_shared<tree_node>("statements", tree_node::node_category::null, op->position());
         }
+        else if (node->children_[i] && node->children_[i]->category() != tree_node::node_category::call)
+            remove_assignments(name, node->children_[i], symbols_table());
     for (const auto it : table.vector())
         if (it.second.first->is_category(type::type_category::function)) {
             const auto f = std::dynamic_pointer_cast<function_type>(it.second.first);
@@ -175,7 +201,7 @@ tree_node_p unreachable_code_optimizer::optimize_loop_body(const tree_node_p loo
             if (loop_node->category() == tree_node::node_category::repeat)
                 return body;
             if (enters)
-                return body;
+                return init_loop_variable(loop_node, body);
             return optimize_if(make_if_from_loop(loop_node));
         }
         return loop_node;
@@ -194,7 +220,7 @@ tree_node_p unreachable_code_optimizer::optimize_loop_body(const tree_node_p loo
         if(loop_node->category() == tree_node::node_category::repeat)
             return body;
         if (enters)
-            return body;
+            return init_loop_variable(loop_node, body);
         return optimize_if(make_if_from_loop(loop_node));
     default:
         return loop_node;
@@ -217,6 +243,15 @@ tree_node_p unreachable_code_optimizer::remove_break_continue(const tree_node_p
     return node;
 }
 
+tree_node_p unreachable_code_optimizer::init_loop_variable(const tree_node_p loop_node, const tree_node_p body) const {
+    if (loop_node->category() != tree_node::node_category::for_op)
+        return body;
+    const auto for_n = std::dynamic_pointer_cast<for_node>(loop_node);
+    return std::make_shared<tree_node>("statements", tree_node::node_category::null, loop_node->position_,
+        std::make_shared<operation_node>(tokenizer::token::sub_types::assign, for_n->from()->position(), integer(),
+            loop_node->children_.front(), for_n->from(), ":="), body);
+}
+
 if_node_p unreachable_code_optimizer::make_if_from_loop(const tree_node_p loop_node) const {
     auto if_n = std::make_shared<if_node>(loop_node->position_);
     switch (loop_node->category()) {
@@ -226,7 +261,7 @@ if_node_p unreachable_code_optimizer::make_if_from_loop(const tree_node_p loop_n
         if_n->push_back(std::make_shared<operation_node>(
             for_n->is_downto() ? tokenizer::token::sub_types::greater_equal : tokenizer::token::sub_types::less_equal,
             for_n->from()->position(), integer(), for_n->from(), for_n->to(), for_n->is_downto() ? ">=" : "<="));
-        if_n->set_then_branch(for_n->body());
+        if_n->set_then_branch(init_loop_variable(for_n, for_n->body()));
         break;
     }
     case tree_node::node_category::while_op:
@@ -238,3 +273,518 @@ if_node_p unreachable_code_optimizer::make_if_from_loop(const tree_node_p loop_n
     }
     return if_n;
 }
+
+// class constant_folding_optimizer
+void constant_folding_optimizer::optimize(const tree_node_p node) {
+    if (!node) return;
+    values_.clear();
+    fold_statement(node);
+}
+
+void constant_folding_optimizer::optimize(symbols_table& table) {
+    fold_functions(table);
+}
+
+void constant_folding_optimizer::fold_functions(const symbols_table& table) {
+    for (const auto& it : table.vector())
+        if (it.second.first->is_category(type::type_category::function)) {
+            const auto f = std::dynamic_pointer_cast<function_type>(it.second.first);
+            locals_ = { &f->table(), &f->parameters() };
+            optimize(it.second.second);
+            fold_functions(f->table());
+        }
+}
+
+constant_node_p constant_folding_optimizer::make_constant(const type_p& type, const tokenizer::token::value& value,
+    const tree_node::position_type& position) {
+    static char characters[256][2];
+    switch (type->category()) {
+    case type::type_category::integer:
+        return std::make_shared<constant_node>(std::to_string(static_cast<long long>(value)), type, value, position);
+    case type::type_category::real:
+        return std::make_shared<constant_node>(std::to_string(static_cast<double>(value)), type, value, position);
+    case type::type_category::character:
+    {
+        const auto c = static_cast<char>(static_cast<long long>(value));
+        auto& s = characters[static_cast<unsigned char>(c)];
+        s[0] = c;
+        tokenizer::token::value result;
+        result.string = s;
+        return std::make_shared<constant_node>(std::to_string(c), type, result, position);
+    }
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+constant_node_p constant_folding_optimizer::fold_cast(const type_p& type, const constant_node_p& node) {
+    const auto from_real = node->type()->is_category(type::type_category::real);
+    const auto int_value = from_real
+        ? static_cast<long long>(node->get_value<double>())
+        : node->get_value<long long>();
+    switch (base_type(type)->category()) {
+    case type::type_category::integer:
+    case type::type_category::character:
+        return make_constant(base_type(type), tokenizer::token::value(int_value), node->position());
+    case type::type_category::real:
+        return make_constant(real(), tokenizer::token::value(node->get_value<double>()), node->position());
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+tree_node_p constant_folding_optimizer::get_typed_constant_element(const tree_node_p& node) {
+    switch (node->category()) {
+    case tree_node::node_category::variable:
+    {
+        const auto var = std::dynamic_pointer_cast<variable_node>(node);
+        if (!var->type()->is_category(type::type_category::modified) ||
+            std::dynamic_pointer_cast<modified_type>(var->type())->modificator() != modified_type::modificator_type::constant)
+            return nullptr;
+        return var->value();
+    }
+    case tree_node::node_category::index:
+    {
+        const auto n = std::dynamic_pointer_cast<index_node>(node);
+        const auto base = get_typed_constant_element(n->variable());
+        if (!base || base->category() != tree_node::node_category::typed_constant ||
+            n->index()->category() != tree_node::node_category::constant)
+            return nullptr;
+        const auto a = std::dynamic_pointer_cast<array_type>(get_type(base));
+        const auto i = std::dynamic_pointer_cast<constant_node>(n->index())->get_value<long long>() - 
+            static_cast<long long>(a->min());
+        if (i < 0 || i >= static_cast<long long>(base->children().size()))
+            return nullptr;
+        return base->children()[i];
+    }
+    case tree_node::node_category::field_access:
+    {
+        const auto n = std::dynamic_pointer_cast<field_access_node>(node);
+        const auto base = get_typed_constant_element(n->variable());
+        if (!base || base->category() != tree_node::node_category::typed_constant)
+            return nullptr;
+        const auto& fields = std::dynamic_pointer_cast<record_type>(get_type(base))->fields().vector();
+        for (size_t i = 0; i < fields.size() && i < base->children().size(); ++i)
+            if (fields[i].first == n->field()->name())
+                return base->children()[i];
+        return nullptr;
+    }
+    default:
+        return nullptr;
+    }
+}
+
+bool constant_folding_optimizer::is_tracked(const tree_node_p& node) const {
+    if (!node || node->category() != tree_node::node_category::variable)
+        return false;
+    const auto t = std::dynamic_pointer_cast<variable_node>(node)->type();
+    if (!t->is_scalar())
+        return false;
+    for (const auto table : locals_)
+        if (table->table().find(node->name()) != table->table().end())
+            return true;
+    return false;
+}
+
+bool constant_folding_optimizer::has_calls(const tree_node_p& node) {
+    if (!node)
+        return false;
+    if (node->category() == tree_node::node_category::call)
+        return true;
+    for (const auto& it : node->children())
+        if (has_calls(it))
+            return true;
+    return false;
+}
+
+tree_node_p constant_folding_optimizer::fold_statement(const tree_node_p& node) {
+    switch (node->category()) {
+    case tree_node::node_category::null:
+        if (node->name() != "statements") {
+            for (auto& it : children(node))
+                if (it)
+                    it = fold_lvalue(it);
+            values_.clear();
+            return node;
+        }
+        for (auto& it : children(node))
+            if (it)
+                it = fold_statement(it);
+        return node;
+    case tree_node::node_category::operation:
+    {
+        const auto op = std::dynamic_pointer_cast<operation_node>(node);
+        if (!op->is_assign())
+            return node;
+        if (has_calls(op)) {
+            values_.clear();
+            const auto result = fold_assignment(op);
+            values_.clear();
+            return result;
+        }
+        return fold_assignment(op);
+    }
+    case tree_node::node_category::call:
+        values_.clear();
+        fold_call_arguments(std::dynamic_pointer_cast<call_node>(node));
+        values_.clear();
+        return node;
+    case tree_node::node_category::write:
+    case tree_node::node_category::exit:
+    {
+        const auto calls = has_calls(node);
+        if (calls)
+            values_.clear();
+        for (auto& it : children(node))
+            it = fold(it);
+        if (calls)
+            values_.clear();
+        return node;
+    }
+    case tree_node::node_category::if_op:
+    {
+        if (has_calls(node->children()[0]))
+            values_.clear();
+        children(node)[0] = fold(node->children()[0]);
+        for (size_t i = 1; i < node->children().size(); ++i) {
+            values_.clear();
+            if (node->children()[i])
+                children(node)[i] = fold_statement(node->children()[i]);
+        }
+        values_.clear();
+        return node;
+    }
+    case tree_node::node_category::for_op:
+    {
+        if (has_calls(node->children()[1]) || has_calls(node->children()[2]))
+            values_.clear();
+        children(node)[1] = fold(node->children()[1]);
+        children(node)[2] = fold(node->children()[2]);
+        values_.clear();
+        if (node->children().size() > 3)
+            children(node)[3] = fold_statement(node->children()[3]);
+        values_.clear();
+        return node;
+    }
+    case tree_node::node_category::while_op:
+        values_.clear();
+        children(node)[0] = fold(node->children()[0]);
+        values_.clear();
+        if (node->children().size() > 1)
+            children(node)[1] = fold_statement(node->children()[1]);
+        values_.clear();
+        return node;
+    case tree_node::node_category::repeat:
+        values_.clear();
+        children(node)[0] = fold_statement(node->children()[0]);
+        values_.clear();
+        children(node)[1] = fold(node->children()[1]);
+        values_.clear();
+        return node;
+    default:
+        return node;
+    }
+}
+
+tree_node_p constant_folding_optimizer::fold_assignment(const operation_node_p& node) {
+    const auto left = fold_lvalue(node->left());
+    auto right = fold(node->right());
+    auto type = node->operation_type();
+    if (is_tracked(left)) {
+        const auto value = values_.find(left->name());
+        if (type != tokenizer::token::sub_types::assign && value != values_.end() &&
+            right->category() == tree_node::node_category::constant) {
+            static const std::unordered_map<tokenizer::token::sub_types, tokenizer::token::sub_types> binary = {
+                { tokenizer::token::sub_types::plus_assign, tokenizer::token::sub_types::plus },
+                { tokenizer::token::sub_types::minus_assign, tokenizer::token::sub_types::minus },
+                { tokenizer::token::sub_types::mult_assign, tokenizer::token::sub_types::mult },
+                { tokenizer::token::sub_types::divide_assign, tokenizer::token::sub_types::div }
+            };
+            auto op = binary.at(type);
+            if (op == tokenizer::token::sub_types::div && get_type(left) == real())
+                op = tokenizer::token::sub_types::divide;
+            const auto result = fold_binary(op, value->second, std::dynamic_pointer_cast<constant_node>(right));
+            if (result && get_type(result) == get_type(left)) {
+                ++statistics_.nodes_folded;
+                right = result;
+                type = tokenizer::token::sub_types::assign;
+            }
+        }
+        if (type == tokenizer::token::sub_types::assign && right->category() == tree_node::node_category::constant)
+            values_[left->name()] = std::dynamic_pointer_cast<constant_node>(right);
+        else
+            values_.erase(left->name());
+    }
+    if (left == node->left() && right == node->right() && type == node->operation_type())
+        return node;
+    return std::make_shared<operation_node>(type, node->position(), node->type(), left, right,
+        type == node->operation_type() ? node->name() : ":=");
+}
+
+void constant_folding_optimizer::fold_call_arguments(const call_node_p& node) {
+    const auto func = std::dynamic_pointer_cast<function_type>(std::dynamic_pointer_cast<typed>(node->variable())->type());
+    auto& args = children(node->children()[1]);
+    for (size_t i = 0; i < args.size(); ++i) {
+        const auto t = func->parameters().get_type(i);
+        args[i] = t->is_category(type::type_category::modified) &&
+            std::dynamic_pointer_cast<modified_type>(t)->is_reference()
+            ? fold_lvalue(args[i])
+            : fold(args[i]);
+    }
+}
+
+constant_node_p constant_folding_optimizer::wrap(const constant_node_p& node) {
+    if (node->type() != integer())
+        return node;
+    return make_constant(integer(), tokenizer::token::value(static_cast<long long>(
+        static_cast<std::int32_t>(static_cast<std::uint32_t>(node->get_value<long long>())))), node->position());
+}
+
+constant_node_p constant_folding_optimizer::fold_binary(const tokenizer::token::sub_types type,
+    const constant_node_p& left, const constant_node_p& right) {
+    if (binary_operations.find(type) == binary_operations.end())
+        return nullptr;
+    if (is_int_only(type) && (left->type() != integer() || right->type() != integer()))
+        return nullptr;
+    if ((type == tokenizer::token::sub_types::div || type == tokenizer::token::sub_types::mod) &&
+        right->get_value<long long>() == 0)
+        return nullptr;
+    if ((type == tokenizer::token::sub_types::shift_left || type == tokenizer::token::sub_types::shift_right) &&
+        (right->get_value<long long>() < 0 || right->get_value<long long>() >= 32))
+        return nullptr;
+    if (type == tokenizer::token::sub_types::shift_right)
+        return make_constant(integer(), tokenizer::token::value(static_cast<long long>(static_cast<std::int32_t>(
+            static_cast<std::uint32_t>(left->get_value<long long>()) >> right->get_value<long long>()))), left->position());
+    const auto is_real = left->type() == real() || right->type() == real();
+    if (is_real && (std::isnan(left->get_value<double>()) || std::isnan(right->get_value<double>())))
+        return nullptr;
+    if (type == tokenizer::token::sub_types::divide && right->get_value<double>() == 0)
+        return nullptr;
+    try {
+        const auto result = calculate(type, left, right);
+        if (result->type() == real() && std::isnan(result->get_value<double>()))
+            return nullptr;
+        return wrap(result);
+    }
+    catch (const exception&) {
+        return nullptr;
+    }
+}
+
+tree_node_p constant_folding_optimizer::fold(const tree_node_p& node) {
+    if (!node)
+        return node;
+    const auto result = fold_node(node);
+    if (result != node && result->category() == tree_node::node_category::constant)
+        ++statistics_.nodes_folded;
+    return result;
+}
+
+tree_node_p constant_folding_optimizer::fold_node(const tree_node_p& node) {
+    switch (node->category()) {
+    case tree_node::node_category::variable:
+    {
+        const auto value = get_typed_constant_element(node);
+        if (value && value->category() != tree_node::node_category::typed_constant) {
+            const auto result = fold(value);
+            const auto t = base_type(get_type(node));
+            if (result->category() == tree_node::node_category::constant)
+                return get_type(result) == t
+                    ? result
+                    : fold_cast(t, std::dynamic_pointer_cast<constant_node>(result));
+        }
+        if (!is_tracked(node))
+            return node;
+        const auto it = values_.find(node->name());
+        return it == values_.end() ? node : it->second;
+    }
+    case tree_node::node_category::operation:
+        return fold_operation(std::dynamic_pointer_cast<operation_node>(node));
+    case tree_node::node_category::cast:
+    {
+        const auto n = std::dynamic_pointer_cast<cast_node>(node);
+        const auto value = fold(n->children()[0]);
+        if (value->category() == tree_node::node_category::constant)
+            return fold_cast(n->type(), std::dynamic_pointer_cast<constant_node>(value));
+        if (value == n->children()[0])
+            return node;
+        return std::make_shared<cast_node>(n->type(), value, n->position());
+    }
+    case tree_node::node_category::index:
+    case tree_node::node_category::field_access:
+    {
+        const auto result = fold_lvalue(node);
+        const auto value = get_typed_constant_element(result);
+        if (value && value->category() != tree_node::node_category::typed_constant) {
+            const auto c = fold(value);
+            if (c->category() == tree_node::node_category::constant)
+                return c;
+        }
+        return result;
+    }
+    case tree_node::node_category::call:
+        fold_call_arguments(std::dynamic_pointer_cast<call_node>(node));
+        return node;
+    default:
+        return node;
+    }
+}
+
+tree_node_p constant_folding_optimizer::fold_lvalue(const tree_node_p& node) {
+    switch (node->category()) {
+    case tree_node::node_category::index:
+    {
+        const auto n = std::dynamic_pointer_cast<index_node>(node);
+        const auto var = fold_lvalue(n->variable());
+        const auto index = fold(n->index());
+        if (var == n->variable() && index == n->index())
+            return node;
+        return std::make_shared<index_node>(n->position(), var, n->type(), index);
+    }
+    case tree_node::node_category::field_access:
+    {
+        const auto n = std::dynamic_pointer_cast<field_access_node>(node);
+        const auto var = fold_lvalue(n->variable());
+        if (var == n->variable())
+            return node;
+        return std::make_shared<field_access_node>(n->position(), var, n->field());
+    }
+    case tree_node::node_category::call:
+        fold_call_arguments(std::dynamic_pointer_cast<call_node>(node));
+        return node;
+    default:
+        return node;
+    }
+}
+
+tree_node_p constant_folding_optimizer::fold_operation(const operation_node_p& node) {
+    const auto left = fold(node->left());
+    if (!node->right()) {
+        if (left->category() == tree_node::node_category::constant)
+            try {
+                return wrap(calculate(node->operation_type(), std::dynamic_pointer_cast<constant_node>(left)));
+            }
+            catch (const exception&) {}
+        if (left == node->left())
+            return node;
+        return std::make_shared<operation_node>(node->operation_type(), node->position(), left, node->name());
+    }
+    const auto right = fold(node->right());
+    if (left->category() == tree_node::node_category::constant &&
+        right->category() == tree_node::node_category::constant) {
+        const auto result = fold_binary(node->operation_type(), 
+            std::dynamic_pointer_cast<constant_node>(left), std::dynamic_pointer_cast<constant_node>(right));
+        if (result)
+            return result;
+    }
+    if (left == node->left() && right == node->right())
+        return node;
+    return std::make_shared<operation_node>(node->operation_type(), node->position(), node->type(), 
+        left, right, node->name());
+}
+
+// class pass_manager
+const pass_manager::passes_t& pass_manager::registered_passes() {
+    static const passes_t passes = {
+        { "fold", [] { return std::make_shared<constant_folding_optimizer>(); } },
+        { "unreachable", [] { return std::make_shared<unreachable_code_optimizer>(); } }
+    };
+    return passes;
+}
+
+pass_manager::pass_manager(const level level) {
+    switch (level) {
+    case level::full:
+        add_pass("fold");
+        add_pass("unreachable");
+        break;
+    case level::basic:
+        add_pass("fold");
+        break;
+    case level::none:
+        break;
+    }
+}
+
+pass_manager::pass_manager(const std::string& passes) {
+    size_t start = 0;
+    while (start <= passes.size()) {
+        auto end = passes.find(',', start);
+        if (end == std::string::npos)
+            end = passes.size();
+        if (end > start)
+            add_pass(passes.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+void pass_manager::add_pass(const std::string& name) {
+    for (const auto& it : registered_passes())
+        if (it.first == name) {
+            passes_.push_back({ name, it.second(), statistics_t() });
+            return;
+        }
+    throw unknown_pass_exception(name);
+}
+
+void pass_manager::optimize(symbols_table& table) {
+    iterations_ = 0;
+    auto changed = !passes_.empty();
+    while (changed && iterations_ < max_iterations) {
+        ++iterations_;
+        changed = false;
+        for (auto& it : passes_)
+            changed = run_pass(it, table) || changed;
+    }
+    statistics_ = statistics_t();
+    for (const auto& it : passes_) {
+        statistics_.nodes_removed += it.statistics.nodes_removed;
+        statistics_.nodes_folded += it.statistics.nodes_folded;
+        statistics_.symbols_dropped += it.statistics.symbols_dropped;
+    }
+}
+
+bool pass_manager::run_pass(pass_t& pass, symbols_table& table) {
+    const auto before = pass.optimizer->statistics();
+    const auto nodes = count_nodes(table);
+    const auto start = std::chrono::steady_clock::now();
+    pass.optimizer->optimize(table);
+    pass.time += std::chrono::steady_clock::now() - start;
+    const auto after = pass.optimizer->statistics();
+    const auto nodes_after = count_nodes(table);
+    if (nodes_after < nodes)
+        pass.statistics.nodes_removed += nodes - nodes_after;
+    pass.statistics.nodes_folded += after.nodes_folded - before.nodes_folded;
+    pass.statistics.symbols_dropped += after.symbols_dropped - before.symbols_dropped;
+    return nodes_after != nodes || after.nodes_folded != before.nodes_folded ||
+        after.symbols_dropped != before.symbols_dropped;
+}
+
+size_t pass_manager::count_nodes(const tree_node_p& node) {
+    if (!node)
+        return 0;
+    size_t result = 1;
+    for (const auto& it : node->children())
+        result += count_nodes(it);
+    return result;
+}
+
+size_t pass_manager::count_nodes(const symbols_table& table) {
+    size_t result = 0;
+    for (const auto& it : table.vector())
+        if (it.second.first->is_category(type::type_category::function)) {
+            result += count_nodes(it.second.second);
+            result += count_nodes(std::dynamic_pointer_cast<function_type>(it.second.first)->table());
+        }
+    return result;
+}
+
+std::string pass_manager::to_string() const {
+    std::string result = str(boost::format("%-12s %10s %10s %10s %10s\n") % 
+        "pass" % "time, ms" % "removed" % "folded" % "dropped");
+    for (const auto& it : passes_)
+        result += str(boost::format("%-12s %10.3f %10d %10d %10d\n") % it.name % it.time.count() %
+            it.statistics.nodes_removed % it.statistics.nodes_folded % it.statistics.symbols_dropped);
+    result += str(boost::format("iterations: %1%\n") % iterations_);
+    return result;
+}
@@ -4,6 +4,10 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
 
 namespace pascal_compiler {
 
@@ -11,16 +15,38 @@ namespace pascal_compiler {
 
     namespace optimizer {
 
+        class unknown_pass_exception : public exception {
+
+        public:
+
+            explicit unknown_pass_exception(const std::string& name);
+
+        };
+
         class basic_optimizer {
             
         public:
 
+            struct statistics_t {
+                size_t nodes_removed = 0;
+                size_t nodes_folded = 0;
+                size_t symbols_dropped = 0;
+            };
+
             basic_optimizer() = default;
             virtual ~basic_optimizer() = default;
 
             virtual void optimize(tree_node_p node) {}
             virtual void optimize(symbols_table& table) {}
 
+            const statistics_t& statistics() const;
+
+        protected:
+
+            statistics_t statistics_;
+
+            static nodes_vector& children(const tree_node_p& node) { return node->children_; }
+
         };// class basic_optimizer
 
         class unreachable_code_optimizer : public basic_optimizer {
@@ -50,10 +76,89 @@ namespace pascal_compiler {
             tree_node_p optimize_if(const if_node_p node);
             tree_node_p optimize_loop_body(const tree_node_p node, const tree_node_p body, const bool enters = false);
             tree_node_p remove_break_continue(const tree_node_p node) const;
+            tree_node_p init_loop_variable(const tree_node_p loop_node, const tree_node_p body) const;
             if_node_p make_if_from_loop(const tree_node_p loop_node) const;
 
         };
 
+        class constant_folding_optimizer : public basic_optimizer {
+
+        public:
+
+            constant_folding_optimizer() = default;
+            virtual ~constant_folding_optimizer() = default;
+
+            void optimize(tree_node_p node) override;
+            void optimize(symbols_table& table) override;
+
+        private:
+
+            typedef std::unordered_map<std::string, constant_node_p> values_t;
+
+            values_t values_;
+            std::vector<const symbols_table*> locals_;
+
+            static constant_node_p make_constant(const type_p& type, const tokenizer::token::value& value,
+                const tree_node::position_type& position);
+            static constant_node_p fold_cast(const type_p& type, const constant_node_p& node);
+            static constant_node_p wrap(const constant_node_p& node);
+            static constant_node_p fold_binary(const tokenizer::token::sub_types type,
+                const constant_node_p& left, const constant_node_p& right);
+            static tree_node_p get_typed_constant_element(const tree_node_p& node);
+            static bool has_calls(const tree_node_p& node);
+            bool is_tracked(const tree_node_p& node) const;
+            void fold_functions(const symbols_table& table);
+            tree_node_p fold_statement(const tree_node_p& node);
+            tree_node_p fold_assignment(const operation_node_p& node);
+            void fold_call_arguments(const call_node_p& node);
+            tree_node_p fold(const tree_node_p& node);
+            tree_node_p fold_node(const tree_node_p& node);
+            tree_node_p fold_lvalue(const tree_node_p& node);
+            tree_node_p fold_operation(const operation_node_p& node);
+
+        };// class constant_folding_optimizer
+
+        class pass_manager : public basic_optimizer {
+
+        public:
+
+            enum class level {
+                none, basic, full
+            };
+
+            pass_manager() = default;
+            explicit pass_manager(const level level);
+            explicit pass_manager(const std::string& passes);
+            virtual ~pass_manager() = default;
+
+            void add_pass(const std::string& name);
+            void optimize(symbols_table& table) override;
+
+            std::string to_string() const;
+
+        private:
+
+            typedef std::vector<std::pair<std::string, std::function<std::shared_ptr<basic_optimizer>()>>> passes_t;
+
+            struct pass_t {
+                std::string name;
+                std::shared_ptr<basic_optimizer> optimizer;
+                statistics_t statistics;
+                std::chrono::duration<double, std::milli> time = std::chrono::duration<double, std::milli>::zero();
+            };
+
+            static const size_t max_iterations = 16;
+
+            std::vector<pass_t> passes_;
+            size_t iterations_ = 0;
+
+            static const passes_t& registered_passes();
+            static size_t count_nodes(const tree_node_p& node);
+            static size_t count_nodes(const symbols_table& table);
+            bool run_pass(pass_t& pass, symbols_table& table);
+
+        };// class pass_manager
+
     }// namespace optimizer
     
     
@@ -0,0 +1,259 @@
+#include "peephole.hpp"
+#include "boost/format.hpp"
+
+using namespace pascal_compiler;
+using namespace code;
+
+const std::string peephole_optimizer::rule_str[] = { "push-pop", "mov", "esp" };
+
+void peephole_optimizer::optimize(std::vector<asm_command>& commands) {
+    size_t i = 0;
+    while (i < commands.size()) {
+        auto changed = false;
+        for (unsigned char r = 0; r < rules_count && !changed; ++r) {
+            const auto size = commands.size();
+            if (apply(static_cast<rule>(r), commands, i)) {
+                removed_[r] += size - commands.size();
+                changed = true;
+            }
+        }
+        if (changed)
+            i = i > window_size ? i - window_size : 0;
+        else
+            ++i;
+    }
+}
+
+size_t peephole_optimizer::removed(const rule rule) const {
+    return removed_[static_cast<unsigned char>(rule)];
+}
+
+std::string peephole_optimizer::to_string() const {
+    std::string result = str(boost::format("%-12s %10s\n") % "rule" % "removed");
+    size_t total = 0;
+    for (size_t i = 0; i < rules_count; ++i) {
+        result += str(boost::format("%-12s %10d\n") % rule_str[i] % removed_[i]);
+        total += removed_[i];
+    }
+    result += str(boost::format("%-12s %10d\n") % "total" % total);
+    return result;
+}
+
+bool peephole_optimizer::apply(const rule rule, std::vector<asm_command>& commands, const size_t i) {
+    switch (rule) {
+    case rule::push_pop:
+        return forward_push(commands, i);
+    case rule::redundant_mov:
+        return remove_redundant_mov(commands, i);
+    case rule::stack_adjust:
+        return merge_stack_adjust(commands, i);
+    default:
+        throw std::logic_error("This point should never be reached");
+    }
+}
+
+bool peephole_optimizer::forward_push(std::vector<asm_command>& commands, const size_t i) {
+    if (commands[i].get_type() != asm_command::type::push)
+        return false;
+    if (forward_real_push(commands, i))
+        return true;
+    const auto value = commands[i].arg(0);
+    for (auto j = i + 1; j < commands.size() && j <= i + window_size; ++j) {
+        if (commands[j].get_type() != asm_command::type::pop) {
+            if (!is_transparent(commands[j], value))
+                return false;
+            continue;
+        }
+        const auto target = commands[j].arg(0);
+        if (is_register(value) && value == target) {
+            commands.erase(commands.begin() + j);
+            commands.erase(commands.begin() + i);
+            return true;
+        }
+        if ((value.is_memory() && target.is_memory()) || (target.is_memory() && uses_register(target, asm_reg::reg_type::esp)))
+            return false;
+        commands[j] = asm_command(asm_command::type::mov, target, value);
+        commands.erase(commands.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+bool peephole_optimizer::forward_real_push(std::vector<asm_command>& commands, const size_t i) {
+    if (i + 3 >= commands.size() || commands[i + 1].get_type() != asm_command::type::push ||
+        commands[i + 2].get_type() != asm_command::type::movsd || commands[i + 3].get_type() != asm_command::type::add)
+        return false;
+    const auto& low = commands[i + 1].arg(0);
+    if (low.get_kind() != asm_operand::kind::constant || low != asm_operand(asm_mem::mem_size::dword, low.get_name(), 0) ||
+        commands[i].arg(0) != asm_operand(asm_mem::mem_size::dword, low.get_name(), 4))
+        return false;
+    const auto& load = commands[i + 2];
+    long long size;
+    if (!is_register(load.arg(0)) || load.arg(1) != asm_operand(asm_reg::reg_type::esp, asm_mem::mem_size::qword) ||
+        commands[i + 3].arg(0) != asm_operand(asm_reg::reg_type::esp) ||
+        !get_int_value(commands[i + 3].arg(1), size) || size != 8)
+        return false;
+    commands[i] = asm_command(asm_command::type::movsd, load.arg(0), { asm_mem::mem_size::qword, low.get_name(), 0 });
+    commands.erase(commands.begin() + i + 1, commands.begin() + i + 4);
+    return true;
+}
+
+bool peephole_optimizer::remove_redundant_mov(std::vector<asm_command>& commands, const size_t i) {
+    const auto type = commands[i].get_type();
+    if ((type != asm_command::type::mov && type != asm_command::type::movsd) || commands[i].args_count() != 2)
+        return false;
+    const auto a = commands[i];
+    if (a.arg(0) == a.arg(1)) {
+        commands.erase(commands.begin() + i);
+        return true;
+    }
+    if (i + 1 >= commands.size() || commands[i + 1].get_type() != type)
+        return false;
+    const auto b = commands[i + 1];
+    if (a.arg(0) == b.arg(1) && a.arg(1) == b.arg(0)) {
+        commands.erase(commands.begin() + i + 1);
+        return true;
+    }
+    if (a.arg(0).is_memory() && a.arg(0) == b.arg(1) && is_register(a.arg(1)) && is_register(b.arg(0))) {
+        if (a.arg(1) == b.arg(0))
+            commands.erase(commands.begin() + i + 1);
+        else
+            commands[i + 1] = asm_command(type, b.arg(0), a.arg(1));
+        return true;
+    }
+    if (is_register(a.arg(0)) && a.arg(0) == b.arg(0) && !uses_register(b.arg(1), a.arg(0).get_reg_type())) {
+        commands.erase(commands.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+bool peephole_optimizer::merge_stack_adjust(std::vector<asm_command>& commands, const size_t i) {
+    if (i + 1 >= commands.size())
+        return false;
+    const auto is_adjust = [](const asm_command& command, long long& value) {
+        if ((command.get_type() != asm_command::type::add && command.get_type() != asm_command::type::sub) ||
+            command.arg(0) != asm_operand(asm_reg::reg_type::esp) || !get_int_value(command.arg(1), value))
+            return false;
+        if (command.get_type() == asm_command::type::sub)
+            value = -value;
+        return true;
+    };
+    long long second;
+    if (commands[i + 1].get_type() == asm_command::type::leave && is_adjust(commands[i], second)) {
+        commands.erase(commands.begin() + i);
+        return true;
+    }
+    if (!is_adjust(commands[i + 1], second))
+        return false;
+    if (commands[i].get_type() == asm_command::type::push && second == 4) {
+        commands.erase(commands.begin() + i, commands.begin() + i + 2);
+        return true;
+    }
+    long long first;
+    if (!is_adjust(commands[i], first))
+        return false;
+    const auto value = first + second;
+    if (value == 0)
+        commands.erase(commands.begin() + i, commands.begin() + i + 2);
+    else {
+        commands[i] = asm_command(value > 0 ? asm_command::type::add : asm_command::type::sub, asm_reg::reg_type::esp,
+            value > 0 ? value : -value);
+        commands.erase(commands.begin() + i + 1);
+    }
+    return true;
+}
+
+asm_reg::reg_type peephole_optimizer::family(const asm_reg::reg_type reg) {
+    switch (reg) {
+    case asm_reg::reg_type::al:
+    case asm_reg::reg_type::ah:
+    case asm_reg::reg_type::ax:
+        return asm_reg::reg_type::eax;
+    case asm_reg::reg_type::cl:
+        return asm_reg::reg_type::ecx;
+    case asm_reg::reg_type::bl:
+        return asm_reg::reg_type::ebx;
+    case asm_reg::reg_type::rsp:
+        return asm_reg::reg_type::esp;
+    case asm_reg::reg_type::rbp:
+        return asm_reg::reg_type::ebp;
+    default:
+        return reg;
+    }
+}
+
+bool peephole_optimizer::is_register(const asm_operand& arg) {
+    return arg.get_kind() == asm_operand::kind::reg;
+}
+
+bool peephole_optimizer::uses_register(const asm_operand& arg, const asm_reg::reg_type reg) {
+    if (arg.get_kind() != asm_operand::kind::reg && arg.get_kind() != asm_operand::kind::mem)
+        return false;
+    return family(arg.get_reg_type()) == family(reg) || (arg.has_index() && family(arg.get_index()) == family(reg));
+}
+
+bool peephole_optimizer::get_int_value(const asm_operand& arg, long long& value) {
+    if (arg.get_kind() != asm_operand::kind::imm)
+        return false;
+    value = arg.get_value();
+    return true;
+}
+
+bool peephole_optimizer::is_transparent(const asm_command& command, const asm_operand& value) {
+    auto writes = true;
+    switch (command.get_type()) {
+    case asm_command::type::cmp:
+    case asm_command::type::test:
+    case asm_command::type::comisd:
+    case asm_command::type::ucomisd:
+        writes = false;
+        break;
+    case asm_command::type::imul:
+        if (command.args_count() != 2)
+            return false;
+        break;
+    case asm_command::type::mov:
+    case asm_command::type::movsx:
+    case asm_command::type::movsd:
+    case asm_command::type::add:
+    case asm_command::type::sub:
+    case asm_command::type::and:
+    case asm_command::type::or:
+    case asm_command::type::xor:
+    case asm_command::type::lea:
+    case asm_command::type::neg:
+    case asm_command::type::not:
+    case asm_command::type::inc:
+    case asm_command::type::dec:
+    case asm_command::type::shl:
+    case asm_command::type::shr:
+    case asm_command::type::cvtsi2sd:
+    case asm_command::type::cvttsd2si:
+    case asm_command::type::addsd:
+    case asm_command::type::subsd:
+    case asm_command::type::mulsd:
+    case asm_command::type::divsd:
+    case asm_command::type::setge:
+    case asm_command::type::setg:
+    case asm_command::type::setle:
+    case asm_command::type::setl:
+    case asm_command::type::sete:
+    case asm_command::type::setne:
+    case asm_command::type::setbe:
+    case asm_command::type::setb:
+    case asm_command::type::seta:
+    case asm_command::type::setae:
+        break;
+    default:
+        return false;
+    }
+    for (size_t i = 0; i < command.args_count(); ++i)
+        if (uses_register(command.arg(i), asm_reg::reg_type::esp))
+            return false;
+    if (!writes)
+        return true;
+    if (command.arg(0).is_memory())
+        return !value.is_memory();
+    return !uses_register(value, command.arg(0).get_reg_type());
+}
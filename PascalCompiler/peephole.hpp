@@ -0,0 +1,49 @@
+#pragma once
+#include "asm_code.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace code {
+
+        class peephole_optimizer {
+
+        public:
+
+            enum class rule : unsigned char {
+                push_pop, redundant_mov, stack_adjust
+            };
+
+            peephole_optimizer() = default;
+
+            void optimize(std::vector<asm_command>& commands);
+            size_t removed(const rule rule) const;
+            std::string to_string() const;
+
+        private:
+
+            static const size_t window_size = 8;
+            static const size_t rules_count = 3;
+            static const std::string rule_str[];
+
+            size_t removed_[rules_count] = {};
+
+            static bool apply(const rule rule, std::vector<asm_command>& commands, const size_t i);
+            static bool forward_push(std::vector<asm_command>& commands, const size_t i);
+            static bool forward_real_push(std::vector<asm_command>& commands, const size_t i);
+            static bool remove_redundant_mov(std::vector<asm_command>& commands, const size_t i);
+            static bool merge_stack_adjust(std::vector<asm_command>& commands, const size_t i);
+
+            static asm_reg::reg_type family(const asm_reg::reg_type reg);
+            static bool is_register(const asm_operand& arg);
+            static bool uses_register(const asm_operand& arg, const asm_reg::reg_type reg);
+            static bool get_int_value(const asm_operand& arg, long long& value);
+            static bool is_transparent(const asm_command& command, const asm_operand& value);
+
+        };// class peephole_optimizer
+
+    }// namespace code
+
+}// namespace pascal_compiler
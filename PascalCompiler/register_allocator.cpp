@@ -0,0 +1,161 @@
+#include "register_allocator.hpp"
+#include <algorithm>
+
+using namespace pascal_compiler;
+using namespace ir;
+
+const asm_reg::reg_type register_allocator::integer_registers[] = {
+    asm_reg::reg_type::ebx, asm_reg::reg_type::esi, asm_reg::reg_type::edi
+};
+
+const asm_reg::reg_type register_allocator::real_registers[] = {
+    asm_reg::reg_type::xmm2, asm_reg::reg_type::xmm3, asm_reg::reg_type::xmm4,
+    asm_reg::reg_type::xmm5, asm_reg::reg_type::xmm6, asm_reg::reg_type::xmm7
+};
+
+const asm_reg::reg_type register_allocator::x86_64_integer_registers[] = {
+    asm_reg::reg_type::ebx, asm_reg::reg_type::r12d, asm_reg::reg_type::r13d,
+    asm_reg::reg_type::r14d, asm_reg::reg_type::r15d
+};
+
+const asm_reg::reg_type register_allocator::x86_64_real_registers[] = {
+    asm_reg::reg_type::xmm2, asm_reg::reg_type::xmm3, asm_reg::reg_type::xmm4,
+    asm_reg::reg_type::xmm5, asm_reg::reg_type::xmm6, asm_reg::reg_type::xmm7,
+    asm_reg::reg_type::xmm8, asm_reg::reg_type::xmm9, asm_reg::reg_type::xmm10,
+    asm_reg::reg_type::xmm11, asm_reg::reg_type::xmm12, asm_reg::reg_type::xmm13,
+    asm_reg::reg_type::xmm14, asm_reg::reg_type::xmm15
+};
+
+register_allocator::register_allocator(const function& function, const bool x86_64) :
+    x86_64_(x86_64), registers_(function.temps().size(), -1) {
+    build_intervals(function);
+    allocate(function);
+}
+
+bool register_allocator::has_register(const operand& value) const {
+    return value.is(operand::kind::temp) && registers_[value.id()] >= 0;
+}
+
+asm_reg::reg_type register_allocator::get_register(const operand& value) const {
+    return static_cast<asm_reg::reg_type>(registers_[value.id()]);
+}
+
+const std::vector<asm_reg::reg_type>& register_allocator::used_registers() const { return used_registers_; }
+
+const std::vector<register_allocator::interval_t>& register_allocator::intervals() const { return intervals_; }
+
+bool register_allocator::is_real_register(const asm_reg::reg_type reg) {
+    return std::find(std::begin(x86_64_real_registers), std::end(x86_64_real_registers), reg) !=
+        std::end(x86_64_real_registers);
+}
+
+void register_allocator::build_intervals(const function& function) {
+    const auto& blocks = function.blocks();
+    const auto temps = function.temps().size();
+    std::vector<std::vector<bool>> uses(blocks.size(), std::vector<bool>(temps, false)),
+        defs(uses), live_in(uses), live_out(uses);
+    std::vector<size_t> first(blocks.size()), last(blocks.size()), calls;
+    const auto none = static_cast<size_t>(-1);
+    std::vector<size_t> start(temps, none), end(temps, 0);
+    size_t position = 0;
+    for (const auto& block : blocks) {
+        first[block.id()] = position;
+        for (const auto& it : block.instructions()) {
+            for (const auto& arg : it.args())
+                if (arg.is(operand::kind::temp)) {
+                    if (!defs[block.id()][arg.id()])
+                        uses[block.id()][arg.id()] = true;
+                    start[arg.id()] = std::min(start[arg.id()], position);
+                    end[arg.id()] = std::max(end[arg.id()], position);
+                }
+            if (it.result().is(operand::kind::temp)) {
+                defs[block.id()][it.result().id()] = true;
+                start[it.result().id()] = std::min(start[it.result().id()], position);
+                end[it.result().id()] = std::max(end[it.result().id()], position);
+            }
+            if (it.op() == instruction::opcode::call || it.op() == instruction::opcode::write)
+                calls.push_back(position);
+            ++position;
+        }
+        last[block.id()] = position - 1;
+    }
+    auto changed = true;
+    while (changed) {
+        changed = false;
+        for (auto i = blocks.size(); i > 0; --i) {
+            const auto id = i - 1;
+            for (const auto s : blocks[id].successors())
+                for (size_t t = 0; t < temps; ++t)
+                    if (live_in[s][t] && !live_out[id][t])
+                        live_out[id][t] = changed = true;
+            for (size_t t = 0; t < temps; ++t)
+                if (!live_in[id][t] && (uses[id][t] || (live_out[id][t] && !defs[id][t])))
+                    live_in[id][t] = changed = true;
+        }
+    }
+    for (const auto& block : blocks)
+        for (size_t t = 0; t < temps; ++t) {
+            if (live_in[block.id()][t])
+                start[t] = std::min(start[t], first[block.id()]);
+            if (live_out[block.id()][t])
+                end[t] = std::max(end[t], last[block.id()]);
+        }
+    for (size_t t = 0; t < temps; ++t) {
+        if (start[t] == none)
+            continue;
+        auto crosses_call = false;
+        for (const auto it : calls)
+            crosses_call = crosses_call || (start[t] < it && it < end[t]);
+        intervals_.push_back({ t, start[t], end[t], crosses_call });
+    }
+    sort(intervals_.begin(), intervals_.end(), [](const interval_t& a, const interval_t& b) {
+        return a.start < b.start || (a.start == b.start && a.temp < b.temp);
+    });
+}
+
+void register_allocator::allocate(const function& function) {
+    std::vector<const interval_t*> active;
+    std::vector<asm_reg::reg_type> free_integer(std::rbegin(integer_registers), std::rend(integer_registers)),
+        free_real(std::rbegin(real_registers), std::rend(real_registers));
+    if (x86_64_) {
+        free_integer.assign(std::rbegin(x86_64_integer_registers), std::rend(x86_64_integer_registers));
+        free_real.assign(std::rbegin(x86_64_real_registers), std::rend(x86_64_real_registers));
+    }
+    const auto is_real = [&function](const size_t temp) {
+        return function.temps()[temp] == value_type::real || is_packed(function.temps()[temp]);
+    };
+    for (const auto& it : intervals_) {
+        for (auto a = active.begin(); a != active.end(); )
+            if ((*a)->end < it.start) {
+                const auto reg = static_cast<asm_reg::reg_type>(registers_[(*a)->temp]);
+                (is_real((*a)->temp) ? free_real : free_integer).push_back(reg);
+                a = active.erase(a);
+            }
+            else
+                ++a;
+        const auto real = is_real(it.temp);
+        if (real && it.crosses_call)
+            continue;
+        auto& free = real ? free_real : free_integer;
+        if (!free.empty()) {
+            registers_[it.temp] = static_cast<int>(free.back());
+            free.pop_back();
+            active.push_back(&it);
+            continue;
+        }
+        const interval_t* spill = nullptr;
+        for (const auto a : active)
+            if (is_real(a->temp) == real && (!spill || a->end > spill->end))
+                spill = a;
+        if (!spill || spill->end <= it.end)
+            continue;
+        registers_[it.temp] = registers_[spill->temp];
+        registers_[spill->temp] = -1;
+        active.erase(find(active.begin(), active.end(), spill));
+        active.push_back(&it);
+    }
+    for (const auto it : registers_)
+        if (it >= 0 && find(used_registers_.begin(), used_registers_.end(), static_cast<asm_reg::reg_type>(it)) == used_registers_.end())
+            used_registers_.push_back(static_cast<asm_reg::reg_type>(it));
+    sort(used_registers_.begin(), used_registers_.end());
+}
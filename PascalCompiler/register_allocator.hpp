@@ -0,0 +1,50 @@
+#pragma once
+#include "ir.hpp"
+#include "asm_code.hpp"
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace ir {
+
+        using namespace code;
+
+        class register_allocator {
+
+        public:
+
+            struct interval_t {
+                size_t temp;
+                size_t start, end;
+                bool crosses_call;
+            };
+
+            explicit register_allocator(const function& function, const bool x86_64 = false);
+
+            bool has_register(const operand& value) const;
+            asm_reg::reg_type get_register(const operand& value) const;
+            const std::vector<asm_reg::reg_type>& used_registers() const;
+            const std::vector<interval_t>& intervals() const;
+            static bool is_real_register(const asm_reg::reg_type reg);
+
+        private:
+
+            static const asm_reg::reg_type integer_registers[];
+            static const asm_reg::reg_type real_registers[];
+            static const asm_reg::reg_type x86_64_integer_registers[];
+            static const asm_reg::reg_type x86_64_real_registers[];
+
+            bool x86_64_;
+
+            std::vector<int> registers_;
+            std::vector<asm_reg::reg_type> used_registers_;
+            std::vector<interval_t> intervals_;
+
+            void build_intervals(const function& function);
+            void allocate(const function& function);
+
+        };// class register_allocator
+
+    }// namespace ir
+
+}// namespace pascal_compiler
@@ -0,0 +1,630 @@
+#include "selector.hpp"
+#include "operations.hpp"
+#include <algorithm>
+
+using namespace pascal_compiler;
+using namespace code;
+using namespace syntax_analyzer;
+using namespace tree;
+using namespace operations;
+using namespace types;
+
+const std::unordered_map<asm_command::type, size_t> instruction_selector::costs = {
+    { asm_command::type::mov, 1 },
+    { asm_command::type::lea, 1 },
+    { asm_command::type::add, 1 },
+    { asm_command::type::sub, 1 },
+    { asm_command::type::and, 1 },
+    { asm_command::type::or, 1 },
+    { asm_command::type::xor, 1 },
+    { asm_command::type::inc, 1 },
+    { asm_command::type::dec, 1 },
+    { asm_command::type::neg, 1 },
+    { asm_command::type::not, 1 },
+    { asm_command::type::imul, 3 },
+    { asm_command::type::cmp, 1 },
+    { asm_command::type::push, 1 }
+};
+
+const std::unordered_map<tokenizer::token::sub_types, asm_command::type> instruction_selector::ops = {
+    { tokenizer::token::sub_types::plus, asm_command::type::add },
+    { tokenizer::token::sub_types::minus, asm_command::type::sub },
+    { tokenizer::token::sub_types::mult, asm_command::type::imul },
+    { tokenizer::token::sub_types::and, asm_command::type::and },
+    { tokenizer::token::sub_types::or, asm_command::type::or },
+    { tokenizer::token::sub_types::xor, asm_command::type::xor },
+    { tokenizer::token::sub_types::plus_assign, asm_command::type::add },
+    { tokenizer::token::sub_types::minus_assign, asm_command::type::sub },
+    { tokenizer::token::sub_types::mult_assign, asm_command::type::imul }
+};
+
+instruction_selector::instruction_selector(asm_code& code) : code_(code) {
+    for (auto it = asm_code::caller_saved_registers.rbegin(); it != asm_code::caller_saved_registers.rend(); ++it)
+        if (is_temporary(*it))
+            free_.push_back(*it);
+}
+
+bool instruction_selector::select_value(const tree_node& node) {
+    asm_operand value;
+    if (!munch_operand(node, value))
+        return false;
+    commands_.push_back({ asm_command::type::push, value });
+    commit();
+    return true;
+}
+
+bool instruction_selector::select_assign(const operation_node& node) {
+    const auto& left = *node.left();
+    if (!is_integer(left) || !is_addressable(left) || !is_integer(*node.right()))
+        return false;
+    const tree_node* rest = nullptr;
+    auto alu = asm_command::type::mov;
+    if (node.operation_type() == tokenizer::token::sub_types::assign) {
+        const auto value = dynamic_cast<const operation_node*>(node.right().get());
+        if (value && value->right() && ops.count(value->operation_type())) {
+            alu = ops.at(value->operation_type());
+            if (same(*value->left(), left))
+                rest = value->right().get();
+            else if (alu != asm_command::type::sub && same(*value->right(), left))
+                rest = value->left().get();
+        }
+    }
+    else if (ops.count(node.operation_type())) {
+        alu = ops.at(node.operation_type());
+        rest = node.right().get();
+    }
+    else
+        return false;
+    asm_operand target, value;
+    asm_reg::reg_type parameter;
+    const auto in_register = get_parameter_register(left, parameter);
+    if (!rest) {
+        if (!munch_operand(*node.right(), value))
+            return false;
+        if (in_register) {
+            commands_.push_back({ asm_command::type::mov, parameter, value });
+            commit();
+            return true;
+        }
+        if (value.is_memory()) {
+            asm_reg::reg_type reg;
+            if (!load(value, reg))
+                return false;
+            value = reg;
+        }
+        if (!munch_address(left, target))
+            return false;
+        commands_.push_back({ asm_command::type::mov, target, value });
+        commit();
+        return true;
+    }
+    long long step;
+    const auto is_constant = get_int_value(*rest, step);
+    if (alu == asm_command::type::sub)
+        step = -step;
+    const auto memory = in_register ? asm_operand(parameter) : asm_operand(asm_reg::reg_type::ebp, asm_mem::mem_size::dword);
+    const auto is_step = alu == asm_command::type::add || alu == asm_command::type::sub;
+    const auto update = is_constant && is_step && (step == 1 || step == -1)
+        ? asm_command(step == 1 ? asm_command::type::inc : asm_command::type::dec, memory)
+        : asm_command(alu, memory, is_constant ? shape(*rest) : asm_reg::reg_type::eax);
+    const auto update_price = (is_constant ? 0 : load_price({ rest, false, 1 })) + cost(update);
+    const auto store_price = cost({ asm_command::type::mov, asm_reg::reg_type::eax, memory }) +
+        cost({ alu, asm_reg::reg_type::eax, shape(*rest) }) + cost({ asm_command::type::mov, memory, asm_reg::reg_type::eax });
+    if (in_register)
+        target = parameter;
+    else if (!munch_address(left, target))
+        return false;
+    if (alu != asm_command::type::imul && update_price <= store_price) {
+        if (!munch_operand(*rest, value))
+            return false;
+        if (value.is_memory()) {
+            asm_reg::reg_type reg;
+            if (!load(value, reg))
+                return false;
+            value = reg;
+        }
+        if (update.get_type() == asm_command::type::inc || update.get_type() == asm_command::type::dec)
+            commands_.push_back({ update.get_type(), target });
+        else
+            commands_.push_back({ alu, target, value });
+    }
+    else {
+        auto reg = parameter;
+        if (!in_register) {
+            if (!allocate(reg))
+                return false;
+            commands_.push_back({ asm_command::type::mov, reg, target });
+        }
+        if (!munch_operand(*rest, value))
+            return false;
+        if (alu == asm_command::type::imul && value.get_kind() == asm_operand::kind::imm)
+            commands_.push_back({ alu, reg, reg, value });
+        else
+            commands_.push_back({ alu, reg, value });
+        if (!in_register)
+            commands_.push_back({ asm_command::type::mov, target, reg });
+    }
+    commit();
+    return true;
+}
+
+bool instruction_selector::select_condition(const operation_node& node, const asm_label label, const bool jump_if) {
+    if (!is_relational(node.operation_type()) || !is_integer(*node.left()) || !is_integer(*node.right()))
+        return false;
+    asm_operand left, right;
+    if (!munch_operand(*node.left(), left) || !munch_operand(*node.right(), right))
+        return false;
+    if (left.get_kind() == asm_operand::kind::imm || (left.is_memory() && right.is_memory())) {
+        asm_reg::reg_type reg;
+        if (!load(left, reg))
+            return false;
+        left = reg;
+    }
+    commands_.push_back({ asm_command::type::cmp, left, right });
+    const auto& jump = operation_node::jumps.at(node.operation_type());
+    commands_.push_back({ jump_if ? jump.first : jump.second, label });
+    commit();
+    return true;
+}
+
+bool instruction_selector::select_load(const tree_node& node, const asm_reg::reg_type reg, const bool by_reference) {
+    asm_operand value;
+    if (by_reference) {
+        if (!munch_address(node, value))
+            return false;
+        commands_.push_back({ asm_command::type::lea, reg, value });
+    }
+    else if (is_integer(node)) {
+        if (!munch_operand(node, value))
+            return false;
+        commands_.push_back({ asm_command::type::mov, reg, value });
+    }
+    else {
+        const auto typed_node = dynamic_cast<const typed*>(&node);
+        if (!typed_node || base_type(typed_node->type()) != real())
+            return false;
+        asm_reg::reg_type source;
+        if (node.category() == tree_node::node_category::constant)
+            value = asm_operand(asm_mem::mem_size::qword,
+                code_.add_double_constant(static_cast<const constant_node&>(node).get_value<double>()), 0);
+        else if (get_parameter_register(node, source))
+            value = source;
+        else if (!is_addressable(node) || !munch_address(node, value))
+            return false;
+        else
+            value = resize(value, asm_mem::mem_size::qword);
+        commands_.push_back({ asm_command::type::movsd, reg, value });
+    }
+    commit();
+    return true;
+}
+
+bool instruction_selector::allocate(asm_reg::reg_type& reg) {
+    if (free_.empty())
+        return false;
+    reg = free_.back();
+    free_.pop_back();
+    return true;
+}
+
+void instruction_selector::release(const asm_operand& operand) {
+    const auto free = [this](const asm_reg::reg_type reg) {
+        if (is_temporary(reg))
+            free_.push_back(reg);
+    };
+    if (operand.get_kind() == asm_operand::kind::reg)
+        free(operand.get_reg_type());
+    else if (operand.get_kind() == asm_operand::kind::mem) {
+        free(operand.get_reg_type());
+        if (operand.has_index())
+            free(operand.get_index());
+    }
+}
+
+bool instruction_selector::load(const asm_operand& value, asm_reg::reg_type& result) {
+    if (value.get_kind() == asm_operand::kind::reg && is_temporary(value.get_reg_type())) {
+        result = value.get_reg_type();
+        return true;
+    }
+    release(value);
+    if (!allocate(result))
+        return false;
+    commands_.push_back({ asm_command::type::mov, result, value });
+    return true;
+}
+
+bool instruction_selector::get_parameter_register(const tree_node& node, asm_reg::reg_type& reg) const {
+    return node.category() == tree_node::node_category::variable && code_.get_parameter_register(node.name(), reg) &&
+        !code_.is_reference(node.name());
+}
+
+bool instruction_selector::munch_address(const tree_node& node, asm_operand& result) {
+    switch (node.category()) {
+    case tree_node::node_category::variable:
+    {
+        asm_reg::reg_type reg;
+        if (code_.get_parameter_register(node.name(), reg)) {
+            if (!code_.is_reference(node.name()))
+                return false;
+            result = asm_operand(reg, asm_mem::mem_size::dword);
+            return true;
+        }
+        const auto offset = code_.get_offset(node.name());
+        auto base = asm_reg::reg_type::ebp;
+        if (!code_.is_local(node.name())) {
+            if (!allocate(base))
+                return false;
+            commands_.push_back({ asm_command::type::mov, base, { asm_reg::reg_type::ebp, asm_mem::mem_size::dword, offset.first } });
+        }
+        if (!code_.is_reference(node.name())) {
+            result = asm_operand(base, asm_mem::mem_size::dword, -offset.second);
+            return true;
+        }
+        auto pointer = base;
+        if (pointer == asm_reg::reg_type::ebp && !allocate(pointer))
+            return false;
+        commands_.push_back({ asm_command::type::mov, pointer, { base, asm_mem::mem_size::dword, -offset.second } });
+        result = asm_operand(pointer, asm_mem::mem_size::dword);
+        return true;
+    }
+    case tree_node::node_category::field_access:
+    {
+        const auto& access = static_cast<const field_access_node&>(node);
+        asm_operand record;
+        if (!munch_address(*access.variable(), record))
+            return false;
+        const auto offset = static_cast<long long>(std::dynamic_pointer_cast<record_type>(get_type(access.variable()))->
+            get_field_offset(access.field()->name()));
+        result = record.has_index()
+            ? asm_operand(record.get_reg_type(), asm_mem::mem_size::dword, record.get_index(), record.get_scale(),
+                record.get_offset() + offset)
+            : asm_operand(record.get_reg_type(), asm_mem::mem_size::dword, record.get_offset() + offset);
+        return true;
+    }
+    case tree_node::node_category::index:
+    {
+        const auto& element = static_cast<const index_node&>(node);
+        asm_operand array;
+        if (!munch_address(*element.variable(), array))
+            return false;
+        std::vector<term> terms;
+        long long shift = 0;
+        flatten(*element.index(), false, terms, shift);
+        if (terms.size() > 1 || (terms.size() == 1 && terms[0].negative)) {
+            terms = { { element.index().get(), false, 1 } };
+            shift = 0;
+        }
+        const auto min = static_cast<long long>(std::dynamic_pointer_cast<array_type>(get_type(element.variable()))->min());
+        const auto size = static_cast<long long>(element.type()->data_size());
+        const auto offset = array.get_offset() + (shift - min) * size;
+        if (terms.empty()) {
+            result = array.has_index()
+                ? asm_operand(array.get_reg_type(), asm_mem::mem_size::dword, array.get_index(), array.get_scale(), offset)
+                : asm_operand(array.get_reg_type(), asm_mem::mem_size::dword, offset);
+            return true;
+        }
+        asm_reg::reg_type index;
+        if (!munch_register(*terms[0].node, index))
+            return false;
+        if (array.has_index()) {
+            asm_reg::reg_type base;
+            release(array);
+            if (!allocate(base))
+                return false;
+            commands_.push_back({ asm_command::type::lea, base, asm_operand(array.get_reg_type(), asm_mem::mem_size::dword,
+                array.get_index(), array.get_scale()) });
+            array = asm_operand(base, asm_mem::mem_size::dword);
+        }
+        auto scale = terms[0].scale * size;
+        if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+            commands_.push_back({ asm_command::type::imul, index, index, scale });
+            scale = 1;
+        }
+        result = asm_operand(array.get_reg_type(), asm_mem::mem_size::dword, index, scale, offset);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool instruction_selector::munch_operand(const tree_node& node, asm_operand& result) {
+    if (!is_integer(node))
+        return false;
+    long long value;
+    if (get_int_value(node, value)) {
+        result = asm_operand(value);
+        return true;
+    }
+    asm_reg::reg_type reg;
+    if (get_parameter_register(node, reg)) {
+        result = reg;
+        return true;
+    }
+    if (is_addressable(node))
+        return munch_address(node, result);
+    if (node.category() != tree_node::node_category::operation || !munch_register(node, reg))
+        return false;
+    result = reg;
+    return true;
+}
+
+bool instruction_selector::munch_register(const tree_node& node, asm_reg::reg_type& result) {
+    if (node.category() != tree_node::node_category::operation) {
+        asm_operand value;
+        return munch_operand(node, value) && load(value, result);
+    }
+    if (!is_integer(node))
+        return false;
+    const auto& operation = static_cast<const operation_node&>(node);
+    const auto type = operation.operation_type();
+    if (!operation.right()) {
+        if (!munch_register(*operation.left(), result))
+            return false;
+        if (type == tokenizer::token::sub_types::minus)
+            commands_.push_back({ asm_command::type::neg, result });
+        else if (type == tokenizer::token::sub_types::not)
+            commands_.push_back({ asm_command::type::not, result });
+        return true;
+    }
+    switch (type) {
+    case tokenizer::token::sub_types::plus:
+    case tokenizer::token::sub_types::minus:
+        return munch_sum(node, result);
+    case tokenizer::token::sub_types::mult:
+    {
+        auto left = operation.left().get(), right = operation.right().get();
+        long long factor;
+        if (get_int_value(*left, factor))
+            std::swap(left, right);
+        asm_operand value;
+        if (get_int_value(*right, factor)) {
+            if (!munch_operand(*left, value))
+                return false;
+            if (value.get_kind() == asm_operand::kind::imm) {
+                if (!load(value, result))
+                    return false;
+                value = result;
+            }
+            release(value);
+            if (!allocate(result))
+                return false;
+            commands_.push_back({ asm_command::type::imul, result, value, factor });
+            return true;
+        }
+        if (!munch_register(*left, result) || !munch_operand(*right, value))
+            return false;
+        commands_.push_back({ asm_command::type::imul, result, value });
+        release(value);
+        return true;
+    }
+    case tokenizer::token::sub_types::and:
+    case tokenizer::token::sub_types::or:
+    case tokenizer::token::sub_types::xor:
+    {
+        asm_operand value;
+        if (!munch_register(*operation.left(), result) || !munch_operand(*operation.right(), value))
+            return false;
+        commands_.push_back({ ops.at(type), result, value });
+        release(value);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool instruction_selector::munch_sum(const tree_node& node, asm_reg::reg_type& result) {
+    std::vector<term> terms;
+    long long displacement = 0;
+    flatten(node, false, terms, displacement);
+    if (terms.empty()) {
+        if (!allocate(result))
+            return false;
+        commands_.push_back({ asm_command::type::mov, result, displacement });
+        return true;
+    }
+    const auto is_base = [](const term& t) { return !t.negative && t.scale == 1; };
+    auto first = std::find_if(terms.begin(), terms.end(), is_base);
+    const auto has_base = first != terms.end();
+    if (!has_base)
+        first = std::find_if(terms.begin(), terms.end(), [](const term& t) { return !t.negative; });
+    if (first != terms.end())
+        std::iter_swap(terms.begin(), first);
+    auto index = std::find_if(terms.begin() + 1, terms.end(), [](const term& t) { return !t.negative && t.scale != 1; });
+    if (index == terms.end())
+        index = std::find_if(terms.begin() + 1, terms.end(), is_base);
+    const auto has_index = has_base && index != terms.end();
+    if (has_index)
+        std::iter_swap(terms.begin() + 1, index);
+    size_t chain_price = load_price(terms[0]) +
+        (terms[0].scale != 1 ? cost({ asm_command::type::imul, asm_reg::reg_type::eax, asm_reg::reg_type::eax, terms[0].scale }) : 0) +
+        (terms[0].negative ? cost({ asm_command::type::neg, asm_reg::reg_type::eax }) : 0) +
+        (displacement != 0 ? cost({ asm_command::type::add, asm_reg::reg_type::eax, displacement }) : 0);
+    size_t lea_price = load_price(terms[0]) + (has_index ? load_price(terms[1]) : 0) +
+        cost({ asm_command::type::lea, asm_reg::reg_type::eax, { asm_reg::reg_type::eax, asm_mem::mem_size::dword } });
+    for (size_t i = 1; i < terms.size(); ++i) {
+        chain_price += term_price(terms[i]);
+        if (i > 1 || !has_index)
+            lea_price += term_price(terms[i]);
+    }
+    size_t start = 1;
+    if (!munch_register(*terms[0].node, result))
+        return false;
+    if (has_base && lea_price < chain_price) {
+        asm_operand address(result, asm_mem::mem_size::dword, displacement);
+        asm_reg::reg_type reg;
+        if (has_index) {
+            if (!munch_register(*terms[1].node, reg))
+                return false;
+            address = asm_operand(result, asm_mem::mem_size::dword, reg, terms[1].scale, displacement);
+            start = 2;
+        }
+        commands_.push_back({ asm_command::type::lea, result, address });
+        if (has_index)
+            release(reg);
+        displacement = 0;
+    }
+    else {
+        if (terms[0].scale != 1)
+            commands_.push_back({ asm_command::type::imul, result, result, terms[0].scale });
+        if (terms[0].negative)
+            commands_.push_back({ asm_command::type::neg, result });
+    }
+    for (auto i = start; i < terms.size(); ++i)
+        if (!munch_term(terms[i], result))
+            return false;
+    if (displacement > 0)
+        commands_.push_back({ asm_command::type::add, result, displacement });
+    else if (displacement < 0)
+        commands_.push_back({ asm_command::type::sub, result, -displacement });
+    return true;
+}
+
+bool instruction_selector::munch_term(const term& term, const asm_reg::reg_type accumulator) {
+    const auto alu = term.negative ? asm_command::type::sub : asm_command::type::add;
+    if (term.scale != 1) {
+        asm_reg::reg_type reg;
+        if (!munch_register(*term.node, reg))
+            return false;
+        commands_.push_back({ asm_command::type::imul, reg, reg, term.scale });
+        commands_.push_back({ alu, accumulator, reg });
+        release(reg);
+        return true;
+    }
+    asm_operand value;
+    if (!munch_operand(*term.node, value))
+        return false;
+    commands_.push_back({ alu, accumulator, value });
+    release(value);
+    return true;
+}
+
+void instruction_selector::commit() {
+    for (const auto& it : commands_)
+        code_.push_back(it);
+    commands_.clear();
+}
+
+bool instruction_selector::is_temporary(const asm_reg::reg_type reg) {
+    return std::find(asm_code::caller_saved_registers.begin(), asm_code::caller_saved_registers.end(), reg) !=
+        asm_code::caller_saved_registers.end() &&
+        std::find(asm_code::integer_argument_registers.begin(), asm_code::integer_argument_registers.end(), reg) ==
+        asm_code::integer_argument_registers.end();
+}
+
+asm_operand instruction_selector::resize(const asm_operand& operand, const asm_mem::mem_size size) {
+    return operand.has_index()
+        ? asm_operand(operand.get_reg_type(), size, operand.get_index(), operand.get_scale(), operand.get_offset())
+        : asm_operand(operand.get_reg_type(), size, operand.get_offset());
+}
+
+bool instruction_selector::is_integer(const tree_node& node) {
+    const auto value = dynamic_cast<const typed*>(&node);
+    return value && base_type(value->type()) == integer();
+}
+
+bool instruction_selector::is_addressable(const tree_node& node) {
+    switch (node.category()) {
+    case tree_node::node_category::variable:
+    case tree_node::node_category::index:
+    case tree_node::node_category::field_access:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool instruction_selector::same(const tree_node& a, const tree_node& b) {
+    if (a.category() != b.category() || a.name() != b.name() || a.children().size() != b.children().size())
+        return false;
+    for (size_t i = 0; i < a.children().size(); ++i)
+        if (!a.children()[i] || !b.children()[i] || !same(*a.children()[i], *b.children()[i]))
+            return false;
+    return true;
+}
+
+bool instruction_selector::get_int_value(const tree_node& node, long long& value) {
+    if (node.category() != tree_node::node_category::constant || !is_integer(node))
+        return false;
+    value = static_cast<const constant_node&>(node).get_value<long long>();
+    return true;
+}
+
+void instruction_selector::flatten(const tree_node& node, const bool negative, std::vector<term>& terms, long long& displacement) {
+    long long value;
+    if (get_int_value(node, value)) {
+        displacement += negative ? -value : value;
+        return;
+    }
+    const auto operation = dynamic_cast<const operation_node*>(&node);
+    if (operation && is_integer(node))
+        switch (operation->operation_type()) {
+        case tokenizer::token::sub_types::plus:
+            if (!operation->right())
+                break;
+            flatten(*operation->left(), negative, terms, displacement);
+            flatten(*operation->right(), negative, terms, displacement);
+            return;
+        case tokenizer::token::sub_types::minus:
+            if (!operation->right()) {
+                flatten(*operation->left(), !negative, terms, displacement);
+                return;
+            }
+            flatten(*operation->left(), negative, terms, displacement);
+            flatten(*operation->right(), !negative, terms, displacement);
+            return;
+        case tokenizer::token::sub_types::mult:
+        {
+            if (!operation->right())
+                break;
+            auto left = operation->left().get(), right = operation->right().get();
+            if (get_int_value(*left, value))
+                std::swap(left, right);
+            if (get_int_value(*right, value) && (value == 2 || value == 4 || value == 8)) {
+                terms.push_back({ left, negative, value });
+                return;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    terms.push_back({ &node, negative, 1 });
+}
+
+asm_operand instruction_selector::shape(const tree_node& node) {
+    long long value;
+    if (get_int_value(node, value))
+        return value;
+    if (is_addressable(node))
+        return asm_operand(asm_reg::reg_type::ebp, asm_mem::mem_size::dword);
+    return asm_reg::reg_type::eax;
+}
+
+size_t instruction_selector::cost(const asm_command& command) {
+    auto result = costs.at(command.get_type());
+    if (command.get_type() == asm_command::type::lea)
+        return result;
+    for (size_t i = 0; i < command.args_count(); ++i) {
+        if (!command.arg(i).is_memory())
+            continue;
+        if (i > 0 || command.get_type() == asm_command::type::cmp || command.get_type() == asm_command::type::push)
+            result += load_cost;
+        else
+            result += command.get_type() == asm_command::type::mov ? store_cost : load_cost + store_cost;
+    }
+    return result;
+}
+
+size_t instruction_selector::load_price(const term& term) {
+    const auto value = shape(*term.node);
+    return value.get_kind() == asm_operand::kind::reg ? 0 : cost({ asm_command::type::mov, asm_reg::reg_type::eax, value });
+}
+
+size_t instruction_selector::term_price(const term& term) {
+    if (term.scale == 1)
+        return cost({ asm_command::type::add, asm_reg::reg_type::eax, shape(*term.node) });
+    return load_price(term) + cost({ asm_command::type::imul, asm_reg::reg_type::eax, asm_reg::reg_type::eax, term.scale }) +
+        cost({ asm_command::type::add, asm_reg::reg_type::eax, asm_reg::reg_type::ecx });
+}
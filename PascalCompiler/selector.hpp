@@ -0,0 +1,67 @@
+#pragma once
+#include "asm_code.hpp"
+#include "tree.hpp"
+#include <unordered_map>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace code {
+
+        class instruction_selector {
+
+        public:
+
+            explicit instruction_selector(asm_code& code);
+
+            bool select_value(const syntax_analyzer::tree::tree_node& node);
+            bool select_assign(const syntax_analyzer::tree::operation_node& node);
+            bool select_condition(const syntax_analyzer::tree::operation_node& node, const asm_label label, const bool jump_if);
+            bool select_load(const syntax_analyzer::tree::tree_node& node, const asm_reg::reg_type reg, const bool by_reference);
+
+        private:
+
+            struct term {
+                const syntax_analyzer::tree::tree_node* node;
+                bool negative;
+                long long scale;
+            };
+
+            static const size_t load_cost = 1;
+            static const size_t store_cost = 1;
+            static const std::unordered_map<asm_command::type, size_t> costs;
+            static const std::unordered_map<tokenizer::token::sub_types, asm_command::type> ops;
+
+            asm_code& code_;
+            std::vector<asm_command> commands_;
+            std::vector<asm_reg::reg_type> free_;
+
+            bool allocate(asm_reg::reg_type& reg);
+            void release(const asm_operand& operand);
+            bool load(const asm_operand& value, asm_reg::reg_type& result);
+            bool get_parameter_register(const syntax_analyzer::tree::tree_node& node, asm_reg::reg_type& reg) const;
+            bool munch_address(const syntax_analyzer::tree::tree_node& node, asm_operand& result);
+            bool munch_operand(const syntax_analyzer::tree::tree_node& node, asm_operand& result);
+            bool munch_register(const syntax_analyzer::tree::tree_node& node, asm_reg::reg_type& result);
+            bool munch_sum(const syntax_analyzer::tree::tree_node& node, asm_reg::reg_type& result);
+            bool munch_term(const term& term, const asm_reg::reg_type accumulator);
+            void commit();
+
+            static bool is_temporary(const asm_reg::reg_type reg);
+            static asm_operand resize(const asm_operand& operand, const asm_mem::mem_size size);
+            static bool is_integer(const syntax_analyzer::tree::tree_node& node);
+            static bool is_addressable(const syntax_analyzer::tree::tree_node& node);
+            static bool same(const syntax_analyzer::tree::tree_node& a, const syntax_analyzer::tree::tree_node& b);
+            static bool get_int_value(const syntax_analyzer::tree::tree_node& node, long long& value);
+            static void flatten(const syntax_analyzer::tree::tree_node& node, const bool negative,
+                std::vector<term>& terms, long long& displacement);
+            static asm_operand shape(const syntax_analyzer::tree::tree_node& node);
+            static size_t cost(const asm_command& command);
+            static size_t load_price(const term& term);
+            static size_t term_price(const term& term);
+
+        };// class instruction_selector
+
+    }// namespace code
+
+}// namespace pascal_compiler
@@ -0,0 +1,307 @@
+#include "ssa.hpp"
+#include <algorithm>
+
+using namespace pascal_compiler;
+using namespace ir;
+
+// class dominator_tree
+dominator_tree::dominator_tree(const std::vector<std::vector<size_t>>& successors,
+    const std::vector<std::vector<size_t>>& predecessors, const size_t root) :
+    root_(root), idom_(successors.size(), undefined), number_(successors.size(), undefined),
+    children_(successors.size()), frontiers_(successors.size()) {
+    std::vector<bool> visited(successors.size(), false);
+    std::vector<std::pair<size_t, size_t>> stack = { { root, 0 } };
+    visited[root] = true;
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.second < successors[top.first].size()) {
+            const auto next = successors[top.first][top.second++];
+            if (!visited[next]) {
+                visited[next] = true;
+                stack.emplace_back(next, 0);
+            }
+            continue;
+        }
+        order_.push_back(top.first);
+        stack.pop_back();
+    }
+    reverse(order_.begin(), order_.end());
+    for (size_t i = 0; i < order_.size(); ++i)
+        number_[order_[i]] = i;
+    idom_[root] = root;
+    auto changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto it : order_) {
+            if (it == root)
+                continue;
+            auto result = undefined;
+            for (const auto p : predecessors[it]) {
+                if (idom_[p] == undefined)
+                    continue;
+                if (result == undefined) {
+                    result = p;
+                    continue;
+                }
+                auto a = p, b = result;
+                while (a != b) {
+                    while (number_[a] > number_[b])
+                        a = idom_[a];
+                    while (number_[b] > number_[a])
+                        b = idom_[b];
+                }
+                result = a;
+            }
+            if (result != idom_[it]) {
+                idom_[it] = result;
+                changed = true;
+            }
+        }
+    }
+    for (const auto it : order_)
+        if (it != root)
+            children_[idom_[it]].push_back(it);
+    for (const auto it : order_) {
+        if (predecessors[it].size() < 2)
+            continue;
+        for (const auto p : predecessors[it]) {
+            if (number_[p] == undefined)
+                continue;
+            for (auto runner = p; runner != idom_[it]; runner = idom_[runner]) {
+                auto& frontier = frontiers_[runner];
+                if (find(frontier.begin(), frontier.end(), it) == frontier.end())
+                    frontier.push_back(it);
+                if (runner == root)
+                    break;
+            }
+        }
+    }
+}
+
+dominator_tree dominator_tree::dominators(const function& function) {
+    std::vector<std::vector<size_t>> successors, predecessors;
+    for (const auto& it : function.blocks()) {
+        successors.push_back(it.successors());
+        predecessors.push_back(it.predecessors());
+    }
+    return dominator_tree(successors, predecessors, 0);
+}
+
+dominator_tree dominator_tree::post_dominators(const function& function) {
+    const auto& blocks = function.blocks();
+    const auto exit = blocks.size();
+    std::vector<std::vector<size_t>> successors(exit + 1), predecessors(exit + 1);
+    std::vector<bool> reaches_exit(exit, false);
+    std::vector<size_t> stack;
+    for (const auto& it : blocks)
+        if (it.instructions().back().op() == instruction::opcode::ret) {
+            reaches_exit[it.id()] = true;
+            stack.push_back(it.id());
+        }
+    while (!stack.empty()) {
+        const auto id = stack.back(); stack.pop_back();
+        for (const auto it : blocks[id].predecessors())
+            if (!reaches_exit[it]) {
+                reaches_exit[it] = true;
+                stack.push_back(it);
+            }
+    }
+    for (const auto& it : blocks) {
+        successors[it.id()] = it.predecessors();
+        predecessors[it.id()] = it.successors();
+        if (it.instructions().back().op() == instruction::opcode::ret || !reaches_exit[it.id()]) {
+            successors[exit].push_back(it.id());
+            predecessors[it.id()].push_back(exit);
+        }
+    }
+    return dominator_tree(successors, predecessors, exit);
+}
+
+size_t dominator_tree::root() const { return root_; }
+
+size_t dominator_tree::idom(const size_t id) const { return idom_[id]; }
+
+bool dominator_tree::dominates(const size_t a, const size_t b) const {
+    if (number_[b] == undefined)
+        return false;
+    for (auto it = b; ; it = idom_[it]) {
+        if (it == a)
+            return true;
+        if (it == root_)
+            return false;
+    }
+}
+
+const std::vector<size_t>& dominator_tree::children(const size_t id) const { return children_[id]; }
+
+const std::vector<size_t>& dominator_tree::frontier(const size_t id) const { return frontiers_[id]; }
+
+const std::vector<size_t>& dominator_tree::order() const { return order_; }
+
+static void collect_nested_variables(const module& module, const function& f, const size_t level,
+    std::vector<std::string>& names) {
+    for (const auto id : f.nested()) {
+        const auto& nested = *module.get_function(id);
+        for (const auto& it : nested.variables())
+            if (it.level == level)
+                names.push_back(it.name);
+        collect_nested_variables(module, nested, level, names);
+    }
+}
+
+static void rename(function& f, const dominator_tree& tree, const size_t id,
+    std::vector<std::vector<operand>>& stacks, const std::vector<bool>& promoted,
+    const std::vector<std::vector<size_t>>& phi_variables) {
+    std::vector<size_t> pushed;
+    size_t phis = 0;
+    for (auto& it : f.block(id).instructions()) {
+        if (it.is_phi()) {
+            const auto variable = phi_variables[id][phis++];
+            it.result() = f.new_temp(it.result().type());
+            stacks[variable].push_back(it.result());
+            pushed.push_back(variable);
+            continue;
+        }
+        for (auto& arg : it.args())
+            if (arg.is(operand::kind::variable) && promoted[arg.id()] && !stacks[arg.id()].empty())
+                arg = stacks[arg.id()].back();
+        if (it.result().is(operand::kind::variable) && promoted[it.result().id()]) {
+            const auto variable = it.result().id();
+            it.result() = f.new_temp(it.result().type());
+            stacks[variable].push_back(it.result());
+            pushed.push_back(variable);
+        }
+    }
+    for (const auto successor : f.block(id).successors()) {
+        size_t index = 0;
+        for (auto& it : f.block(successor).instructions()) {
+            if (!it.is_phi())
+                break;
+            const auto variable = phi_variables[successor][index++];
+            auto& args = it.args();
+            for (size_t i = 0; i < args.size(); i += 2)
+                if (args[i].id() == id && !stacks[variable].empty())
+                    args[i + 1] = stacks[variable].back();
+        }
+    }
+    for (const auto it : tree.children(id))
+        rename(f, tree, it, stacks, promoted, phi_variables);
+    for (const auto it : pushed)
+        stacks[it].pop_back();
+}
+
+void ir::construct_ssa(function& function, const module& module) {
+    function.update_cfg();
+    const auto& variables = function.variables();
+    std::vector<bool> promoted(variables.size(), false);
+    for (size_t i = 0; i < variables.size(); ++i)
+        promoted[i] = variables[i].level == function.depth() && variables[i].type != value_type::none;
+    std::vector<std::string> captured;
+    collect_nested_variables(module, function, function.depth(), captured);
+    for (size_t i = 0; i < variables.size(); ++i)
+        if (find(captured.begin(), captured.end(), variables[i].name) != captured.end())
+            promoted[i] = false;
+    for (const auto& block : function.blocks())
+        for (const auto& it : block.instructions())
+            if (it.op() == instruction::opcode::addr)
+                promoted[it.args()[0].id()] = false;
+    const auto tree = dominator_tree::dominators(function);
+    std::vector<std::vector<size_t>> phi_variables(function.blocks().size());
+    std::vector<std::vector<instruction>> phis(function.blocks().size());
+    for (size_t v = 0; v < variables.size(); ++v) {
+        if (!promoted[v])
+            continue;
+        std::vector<size_t> work;
+        std::vector<bool> has_phi(function.blocks().size(), false), queued(function.blocks().size(), false);
+        for (const auto& block : function.blocks())
+            for (const auto& it : block.instructions())
+                if (it.result() == operand::make_variable(v, variables[v].type) && !queued[block.id()]) {
+                    queued[block.id()] = true;
+                    work.push_back(block.id());
+                }
+        while (!work.empty()) {
+            const auto id = work.back(); work.pop_back();
+            for (const auto it : tree.frontier(id)) {
+                if (has_phi[it])
+                    continue;
+                has_phi[it] = true;
+                std::vector<operand> args;
+                for (const auto p : function.block(it).predecessors()) {
+                    args.push_back(operand::make_block(p));
+                    args.push_back(operand::make_variable(v, variables[v].type));
+                }
+                phis[it].emplace_back(instruction::opcode::phi, operand::make_variable(v, variables[v].type), args);
+                phi_variables[it].push_back(v);
+                if (!queued[it]) {
+                    queued[it] = true;
+                    work.push_back(it);
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < phis.size(); ++i) {
+        auto& instructions = function.block(i).instructions();
+        instructions.insert(instructions.begin(), phis[i].begin(), phis[i].end());
+    }
+    std::vector<std::vector<operand>> stacks(variables.size());
+    rename(function, tree, 0, stacks, promoted, phi_variables);
+}
+
+void ir::destruct_ssa(function& function) {
+    function.update_cfg();
+    std::vector<size_t> order;
+    for (const auto& it : function.blocks())
+        order.push_back(it.id());
+    const auto count = function.blocks().size();
+    for (size_t id = 0; id < count; ++id) {
+        if (function.block(id).instructions().empty() || !function.block(id).instructions().front().is_phi())
+            continue;
+        const auto predecessors = function.block(id).predecessors();
+        for (const auto p : predecessors) {
+            auto from = p;
+            if (function.block(p).successors().size() > 1) {
+                from = function.add_block();
+                function.block(from).instructions().emplace_back(instruction::opcode::jmp, operand(),
+                    std::vector<operand>{ operand::make_block(id) });
+                for (auto& arg : function.block(p).instructions().back().args())
+                    if (arg == operand::make_block(id))
+                        arg = operand::make_block(from);
+                order.insert(find(order.begin(), order.end(), id), from);
+            }
+            std::vector<std::pair<operand, operand>> copies;
+            for (const auto& it : function.block(id).instructions()) {
+                if (!it.is_phi())
+                    break;
+                const auto& args = it.args();
+                for (size_t i = 0; i < args.size(); i += 2)
+                    if (args[i].id() == p && args[i + 1] != it.result())
+                        copies.emplace_back(it.result(), args[i + 1]);
+            }
+            auto parallel = false;
+            for (const auto& a : copies)
+                for (const auto& b : copies)
+                    parallel = parallel || a.second == b.first;
+            auto& instructions = function.block(from).instructions();
+            std::vector<instruction> moves;
+            if (parallel) {
+                std::vector<operand> temps;
+                for (const auto& it : copies) {
+                    temps.push_back(function.new_temp(it.first.type()));
+                    moves.emplace_back(instruction::opcode::mov, temps.back(), std::vector<operand>{ it.second });
+                }
+                for (size_t i = 0; i < copies.size(); ++i)
+                    moves.emplace_back(instruction::opcode::mov, copies[i].first, std::vector<operand>{ temps[i] });
+            }
+            else
+                for (const auto& it : copies)
+                    moves.emplace_back(instruction::opcode::mov, it.first, std::vector<operand>{ it.second });
+            instructions.insert(instructions.end() - 1, moves.begin(), moves.end());
+        }
+    }
+    for (auto& it : function.blocks()) {
+        auto& instructions = it.instructions();
+        instructions.erase(remove_if(instructions.begin(), instructions.end(),
+            [](const instruction& inst) { return inst.is_phi(); }), instructions.end());
+    }
+    function.reorder_blocks(order);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "ir.hpp"
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace ir {
+
+        class dominator_tree {
+
+        public:
+
+            static dominator_tree dominators(const function& function);
+            static dominator_tree post_dominators(const function& function);
+
+            size_t root() const;
+            size_t idom(const size_t id) const;
+            bool dominates(const size_t a, const size_t b) const;
+            const std::vector<size_t>& children(const size_t id) const;
+            const std::vector<size_t>& frontier(const size_t id) const;
+            const std::vector<size_t>& order() const;
+
+        private:
+
+            dominator_tree(const std::vector<std::vector<size_t>>& successors,
+                const std::vector<std::vector<size_t>>& predecessors, const size_t root);
+
+            static const size_t undefined = static_cast<size_t>(-1);
+
+            size_t root_;
+            std::vector<size_t> idom_, order_, number_;
+            std::vector<std::vector<size_t>> children_, frontiers_;
+
+        };// class dominator_tree
+
+        void construct_ssa(function& function, const module& module);
+        void destruct_ssa(function& function);
+
+    }// namespace ir
+
+}// namespace pascal_compiler
@@ -69,6 +69,7 @@ void symbols_table::to_asm_code(asm_code& code) const {
             const auto f = std::dynamic_pointer_cast<function_type>(it.second.first);
             code.start_function(it.first, it.second.second->position().first, it.second.second->position().second,
                 f->table(), f->parameters());
+            code.assign_parameter_registers(!tree::contains_call(it.second.second));
             f->table().to_asm_code(code);
             it.second.second->to_asm_code(code);
             code.end_function();
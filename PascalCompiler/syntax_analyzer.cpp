@@ -708,6 +708,7 @@ void syntax_analyzer::parse_function_declaration() {
     auto block = parse_block();
     block->push_back(std::make_shared<exit_node>(tokenizer_.current()->get_position()));
     tables_.back().calculate_offsets();
+    pass_unmodified_by_reference(func, block);
     const auto vars = tables_.back(); tables_.pop_back(); tables_.pop_back();
     func->set_table(vars);
     tables_.back().change_last(std::make_pair(func, block));
@@ -731,6 +732,7 @@ void syntax_analyzer::parse_procedure_declaration() {
     auto block = parse_block();
     block->push_back(std::make_shared<exit_node>(tokenizer_.current()->get_position()));
     tables_.back().calculate_offsets();
+    pass_unmodified_by_reference(func, block);
     const auto vars = tables_.back(); tables_.pop_back(); tables_.pop_back();   
     func->set_table(vars);
     tables_.back().change_last(std::make_pair(func, block));
@@ -763,7 +765,8 @@ void syntax_analyzer::parse_formal_parameter_list() {
             result_type = std::make_shared<modified_type>(modified_type::modificator_type::var, result_type);
             break;
         case pascal_compiler::tokenizer::token::sub_types::const_op:
-            result_type = std::make_shared<modified_type>(modified_type::modificator_type::constant, result_type);
+            result_type = std::make_shared<modified_type>(modified_type::modificator_type::constant, result_type,
+                is_aggregate(result_type));
             break;
         default:
             break;
@@ -794,6 +797,63 @@ void syntax_analyzer::parse_formal_parameter_list() {
     tokenizer_.next();
 }
 
+void syntax_analyzer::pass_unmodified_by_reference(const function_type_p& func, const tree_node_p& block) const {
+    if (!writes_only_locals(block, tables_.back()))
+        return;
+    auto parameters = func->parameters();
+    for (const auto it : func->parameters().vector())
+        if (is_aggregate(it.second.first))
+            parameters.change(it.first, make_pair(std::make_shared<modified_type>(
+                modified_type::modificator_type::constant, it.second.first, true), it.second.second));
+    parameters.calculate_offsets();
+    func->set_parameters(parameters);
+}
+
+bool syntax_analyzer::writes_only_locals(const tree_node_p& node, const symbols_table& table) {
+    if (!node)
+        return true;
+    switch (node->category()) {
+    case tree_node::node_category::call:
+        return false;
+    case tree_node::node_category::for_op:
+        if (!is_local(node->children()[0], table))
+            return false;
+        break;
+    case tree_node::node_category::null:
+        if (node->name() == "read")
+            for (const auto& it : node->children())
+                if (!is_local(it, table))
+                    return false;
+        break;
+    case tree_node::node_category::operation:
+    {
+        const auto operation = std::static_pointer_cast<operation_node>(node);
+        if (operation->is_assign() && !is_local(operation->left(), table))
+            return false;
+        break;
+    }
+    default:
+        break;
+    }
+    for (const auto& it : node->children())
+        if (!writes_only_locals(it, table))
+            return false;
+    return true;
+}
+
+bool syntax_analyzer::is_local(const tree_node_p& node, const symbols_table& table) {
+    auto root = node;
+    while (root->category() == tree_node::node_category::index ||
+           root->category() == tree_node::node_category::field_access)
+        root = std::dynamic_pointer_cast<applied>(root)->variable();
+    return root->category() == tree_node::node_category::variable &&
+        table.table().find(root->name()) != table.table().end();
+}
+
+bool syntax_analyzer::is_aggregate(const type_p& type) {
+    return type->is_category(type::type_category::array) || type->is_category(type::type_category::record);
+}
+
 const symbols_table::symbol_t& syntax_analyzer::find_declaration(const pascal_compiler::tokenizer::token_p& token) {
     const auto name = token->get_string_value();
     for (std::vector<symbols_table>::const_reverse_iterator it = tables_.rbegin(); it != tables_.rend(); ++it) {
@@ -135,6 +135,10 @@ namespace pascal_compiler {
             void parse_function_declaration();
             void parse_procedure_declaration();
             void parse_formal_parameter_list();
+            void pass_unmodified_by_reference(const function_type_p& func, const tree_node_p& block) const;
+            static bool writes_only_locals(const tree_node_p& node, const symbols_table& table);
+            static bool is_local(const tree_node_p& node, const symbols_table& table);
+            static bool is_aggregate(const type_p& type);
 
             const symbols_table::symbol_t& find_declaration(const tokenizer::token_p& token);
 
@@ -0,0 +1,103 @@
+#include "tiering.hpp"
+#include "asm_code.hpp"
+#include "encoder.hpp"
+#include "ir_generator.hpp"
+#include "boost/format.hpp"
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+using namespace pascal_compiler;
+using namespace bytecode;
+
+tiering::tiering(const ir::module& module, const program& code, const size_t call_threshold,
+    const size_t back_edge_threshold) : module_(module), code_(code), requested_(code.functions().size()) {
+#ifdef __linux__
+    memory_size_ = machine::memory_size(code);
+    const auto memory = mmap(nullptr, memory_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (memory != MAP_FAILED)
+        memory_ = static_cast<unsigned char*>(memory);
+#endif
+    machine_ = memory_ ? std::make_unique<machine>(code, memory_) : std::make_unique<machine>(code);
+    if (memory_)
+        machine_->set_tier_up(call_threshold, back_edge_threshold, [this](const size_t function) { tier_up(function); });
+}
+
+tiering::~tiering() {
+    if (compiler_.joinable())
+        compiler_.join();
+    machine_.reset();
+#ifdef __linux__
+    if (memory_)
+        munmap(memory_, memory_size_);
+#endif
+}
+
+void tiering::run() {
+    start_ = std::chrono::steady_clock::now();
+    machine_->run();
+    if (compiler_.joinable())
+        compiler_.join();
+}
+
+void tiering::tier_up(const size_t function) {
+    if (requested_[function])
+        return;
+    requested_[function] = true;
+    std::lock_guard<std::mutex> lock(mutex_);
+    add_event(function, "tier-up", true);
+    if (jit_) {
+        patch(function, true);
+        return;
+    }
+    pending_.push_back(function);
+    if (!compiling_) {
+        compiling_ = true;
+        compiler_ = std::thread(&tiering::compile, this);
+    }
+}
+
+void tiering::compile() {
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        code::asm_code code;
+        code.set_target(code::asm_code::target::x86_64);
+        ir::generator(code, true).generate(module_);
+        auto result = std::make_unique<code::jit>(code::encoder(code));
+        std::lock_guard<std::mutex> lock(mutex_);
+        compile_time_ = std::chrono::steady_clock::now() - start;
+        jit_ = std::move(result);
+        machine_->set_gate(jit_->gate());
+        for (const auto it : pending_)
+            patch(it, false);
+        pending_.clear();
+    }
+    catch (const pascal_compiler::exception& e) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = e.what();
+    }
+}
+
+void tiering::patch(const size_t function, const bool counted) {
+    machine_->set_native(function, jit_->symbol(code::asm_code::to_gas_name(module_.get_function(function)->label())));
+    add_event(function, "native", counted);
+}
+
+void tiering::add_event(const size_t function, const std::string& name, const bool counted) {
+    const auto& counter = machine_->counters()[function];
+    events_.push_back({ code_.get_function(function).name, name, std::chrono::steady_clock::now() - start_,
+        counted ? std::to_string(counter.calls) : "", counted ? std::to_string(counter.back_edges) : "" });
+}
+
+std::string tiering::to_string() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string result = str(boost::format("%-12s %-10s %10s %10s %10s\n") %
+        "function" % "event" % "time, ms" % "calls" % "back edges");
+    for (const auto& it : events_)
+        result += str(boost::format("%-12s %-10s %10.3f %10s %10s\n") % it.function % it.name % it.time.count() %
+            it.calls % it.back_edges);
+    result += str(boost::format("compile: %1$.3f ms\n") % compile_time_.count());
+    if (!error_.empty())
+        result += "compile failed: " + error_ + '\n';
+    return result;
+}
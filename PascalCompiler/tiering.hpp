@@ -0,0 +1,68 @@
+#pragma once
+#include "bytecode.hpp"
+#include "ir.hpp"
+#include "jit.hpp"
+#include "vm.hpp"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace bytecode {
+
+        class tiering {
+
+        public:
+
+            static const size_t default_call_threshold = 1000;
+            static const size_t default_back_edge_threshold = 10000;
+
+            tiering(const ir::module& module, const program& code, const size_t call_threshold = default_call_threshold,
+                const size_t back_edge_threshold = default_back_edge_threshold);
+            tiering(const tiering&) = delete;
+            tiering& operator=(const tiering&) = delete;
+            ~tiering();
+
+            void run();
+            std::string to_string() const;
+
+        private:
+
+            struct event_t {
+                std::string function;
+                std::string name;
+                std::chrono::duration<double, std::milli> time;
+                std::string calls;
+                std::string back_edges;
+            };
+
+            const ir::module& module_;
+            const program& code_;
+            unsigned char* memory_ = nullptr;
+            size_t memory_size_ = 0;
+            std::unique_ptr<machine> machine_;
+            std::unique_ptr<code::jit> jit_;
+            std::thread compiler_;
+            mutable std::mutex mutex_;
+            std::vector<size_t> pending_;
+            std::vector<bool> requested_;
+            std::vector<event_t> events_;
+            std::chrono::steady_clock::time_point start_;
+            std::chrono::duration<double, std::milli> compile_time_ = std::chrono::duration<double, std::milli>::zero();
+            std::string error_;
+            bool compiling_ = false;
+
+            void tier_up(const size_t function);
+            void compile();
+            void patch(const size_t function, const bool counted);
+            void add_event(const size_t function, const std::string& name, const bool counted);
+
+        };// class tiering
+
+    }// namespace bytecode
+
+}// namespace pascal_compiler
@@ -2,6 +2,7 @@
 #include "boost/format.hpp"
 #include <iterator>
 #include "operations.hpp"
+#include "selector.hpp"
 
 using namespace pascal_compiler;
 using namespace syntax_analyzer;
@@ -45,6 +46,13 @@ void tree_node::to_asm_code(asm_code& code, const bool is_left) {
             it->to_asm_code(code, is_left);
 }
 
+void tree_node::to_asm_condition(asm_code& code, const asm_label label, const bool jump_if) {
+    to_asm_code(code);
+    code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
+    code.push_back({ asm_command::type::test, asm_reg::reg_type::eax, asm_reg::reg_type::eax });
+    code.push_back({ jump_if ? asm_command::type::jnz : asm_command::type::jz, label });
+}
+
 const type_p& typed::type() const { return type_; }
 
 type_p tree::get_type(const tree_node_p& node) {
@@ -58,20 +66,34 @@ type_p tree::get_type(const tree_node_p& node) {
 const tree_node_p& variable_node::value() const { return value_; }
 
 void variable_node::to_asm_code(asm_code& code, const bool is_left) {
+    if (!is_left && instruction_selector(code).select_value(*this))
+        return;
+    asm_reg::reg_type reg;
+    if (code.get_parameter_register(name(), reg)) {
+        if (code.is_reference(name())) {
+            code.push_back({ asm_command::type::push, reg });
+            if (!is_left)
+                put_value_on_stack(code, type());
+        }
+        else if (is_left)
+            throw std::logic_error("This point should never be reached");
+        else if (base_type(type()) == real()) {
+            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 8 });
+            code.push_back({ asm_command::type::movsd, { asm_reg::reg_type::esp, asm_mem::mem_size::qword }, reg });
+        }
+        else
+            code.push_back({ asm_command::type::push, reg });
+        return;
+    }
     const auto offset = code.get_offset(name());
     code.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, {asm_reg::reg_type::ebp, asm_mem::mem_size::dword, offset.first} });
     code.push_back({ asm_command::type::sub, asm_reg::reg_type::eax, offset.second });
-    if (type()->category() == type::type_category::modified) {
-        const auto t = std::dynamic_pointer_cast<modified_type>(type());
-        if (t->modificator() == modified_type::modificator_type::var)
-            code.push_back({ asm_command::type::push, {asm_reg::reg_type::eax, asm_mem::mem_size::dword} });
-        else
-            code.push_back({ asm_command::type::push, asm_reg::reg_type::eax });
-    }
+    if (code.is_reference(name()))
+        code.push_back({ asm_command::type::push, {asm_reg::reg_type::eax, asm_mem::mem_size::dword} });
     else
         code.push_back({ asm_command::type::push, asm_reg::reg_type::eax });
     if (!is_left)
-        put_value_on_stack(code, type(), position());
+        put_value_on_stack(code, type());
 }
 
 std::string constant_node::value_string() const {
@@ -94,10 +116,10 @@ void constant_node::to_asm_code(asm_code& code, const bool is_left) {
     case type::type_category::character:
         code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 1 });
         code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::byte },
-            { std::to_string(static_cast<char>(value_)) } });
+            static_cast<long long>(static_cast<char>(value_)) });
         break;
     case type::type_category::integer:
-        code.push_back({ asm_command::type::push, { std::to_string(static_cast<long long>(value_)) } });
+        code.push_back({ asm_command::type::push, static_cast<long long>(value_) });
         break;
     case type::type_category::real:
     {
@@ -149,12 +171,30 @@ const std::unordered_map<tokenizer::token::sub_types, asm_command::type> operati
     { tokenizer::token::sub_types::assign, asm_command::type::movsd },
     { tokenizer::token::sub_types::greater_equal, asm_command::type::setb },
     { tokenizer::token::sub_types::greater, asm_command::type::setbe },
-    { tokenizer::token::sub_types::less_equal, asm_command::type::seta },
-    { tokenizer::token::sub_types::less, asm_command::type::setae },
+    { tokenizer::token::sub_types::less_equal, asm_command::type::setb },
+    { tokenizer::token::sub_types::less, asm_command::type::setbe },
     { tokenizer::token::sub_types::equal, asm_command::type::jp },
     { tokenizer::token::sub_types::not_equal, asm_command::type::jnp }
 };
 
+const std::unordered_map<tokenizer::token::sub_types, std::pair<asm_command::type, asm_command::type>> operation_node::jumps = {
+    { tokenizer::token::sub_types::greater_equal, { asm_command::type::jge, asm_command::type::jl } },
+    { tokenizer::token::sub_types::greater, { asm_command::type::jg, asm_command::type::jle } },
+    { tokenizer::token::sub_types::less_equal, { asm_command::type::jle, asm_command::type::jg } },
+    { tokenizer::token::sub_types::less, { asm_command::type::jl, asm_command::type::jge } },
+    { tokenizer::token::sub_types::equal, { asm_command::type::jz, asm_command::type::jnz } },
+    { tokenizer::token::sub_types::not_equal, { asm_command::type::jnz, asm_command::type::jz } }
+};
+
+const std::unordered_map<tokenizer::token::sub_types, std::pair<asm_command::type, asm_command::type>> operation_node::f_jumps = {
+    { tokenizer::token::sub_types::greater_equal, { asm_command::type::jae, asm_command::type::jb } },
+    { tokenizer::token::sub_types::greater, { asm_command::type::ja, asm_command::type::jbe } },
+    { tokenizer::token::sub_types::less_equal, { asm_command::type::jae, asm_command::type::jb } },
+    { tokenizer::token::sub_types::less, { asm_command::type::ja, asm_command::type::jbe } },
+    { tokenizer::token::sub_types::equal, { asm_command::type::jz, asm_command::type::jnz } },
+    { tokenizer::token::sub_types::not_equal, { asm_command::type::jnz, asm_command::type::jz } }
+};
+
 tokenizer::token::sub_types operation_node::operation_type() const { return operation_type_; }
 
 const tree_node_p& operation_node::left() const { return left_; }
@@ -171,7 +211,19 @@ void operation_node::to_asm_code(asm_code& code, const bool is_left) {
 }
 
 void operation_node::to_asm_assign(asm_code& code) const {
+    if (instruction_selector(code).select_assign(*this))
+        return;
+    asm_reg::reg_type target;
+    if (left_->category() == node_category::variable && code.get_parameter_register(left_->name(), target) &&
+        !code.is_reference(left_->name())) {
+        to_asm_register_assign(code, target);
+        return;
+    }
     left_->to_asm_code(code, true);
+    if (!type()->is_scalar() && right_->category() == node_category::call) {
+        std::dynamic_pointer_cast<call_node>(right_)->to_asm_call(code);
+        return;
+    }
     right_->to_asm_code(code, !type()->is_scalar());
     asm_mem::mem_size mem_size;
     asm_command::type com_type;
@@ -180,7 +232,7 @@ void operation_node::to_asm_assign(asm_code& code) const {
     if (t == real()) {
         reg1 = asm_reg::reg_type::xmm0;
         code.push_back({ asm_command::type::movsd, reg1, { asm_reg::reg_type::esp, asm_mem::mem_size::qword } });
-        code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, {"8"} });
+        code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 8 });
         com_type = f_ops.at(operation_type_);
         mem_size = asm_mem::mem_size::qword;
     }
@@ -192,7 +244,7 @@ void operation_node::to_asm_assign(asm_code& code) const {
         else {
             reg1 = asm_reg::reg_type::al;
             code.push_back({ asm_command::type::mov, reg1, { asm_reg::reg_type::esp, asm_mem::mem_size::byte } });
-            code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, {"1"} });
+            code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 1 });
         }
         mem_size = type() == integer() ? asm_mem::mem_size::dword : asm_mem::mem_size::byte;
         com_type = ops.at(operation_type_);
@@ -200,14 +252,7 @@ void operation_node::to_asm_assign(asm_code& code) const {
     else {
         code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
         code.push_back({ asm_command::type::pop, asm_reg::reg_type::ebx });
-        code.push_back({ asm_command::type::mov, asm_reg::reg_type::ecx, t->data_size() / 4 });
-        const auto label = code.get_label_name(position().first, position().second, "COPYSTRUCT");
-        code.push_back({ asm_command::type::label, label });
-        code.push_back({ asm_command::type::mov,asm_reg::reg_type::edx, { asm_reg::reg_type::eax, asm_mem::mem_size::dword } });
-        code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::ebx, asm_mem::mem_size::dword }, asm_reg::reg_type::edx });
-        code.push_back({ asm_command::type::add, asm_reg::reg_type::eax, 4 });
-        code.push_back({ asm_command::type::add, asm_reg::reg_type::ebx, 4 });
-        code.push_back({ asm_command::type::loop, label });
+        code.add_block_copy(asm_reg::reg_type::eax, asm_reg::reg_type::ebx, t->data_size(), code.new_label());
         return;
     }
     if (com_type == asm_command::type::idiv)
@@ -216,12 +261,34 @@ void operation_node::to_asm_assign(asm_code& code) const {
     code.push_back({ com_type,{ asm_reg::reg_type::ebx, mem_size }, reg1 });
 }
 
+void operation_node::to_asm_register_assign(asm_code& code, const asm_reg::reg_type target) const {
+    right_->to_asm_code(code);
+    if (base_type(type()) == real()) {
+        code.push_back({ asm_command::type::movsd, asm_reg::reg_type::xmm0, { asm_reg::reg_type::esp, asm_mem::mem_size::qword } });
+        code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 8 });
+        code.push_back({ f_ops.at(operation_type_), target, asm_reg::reg_type::xmm0 });
+        return;
+    }
+    code.push_back({ asm_command::type::pop, asm_reg::reg_type::ecx });
+    const auto com_type = ops.at(operation_type_);
+    if (com_type != asm_command::type::idiv) {
+        code.push_back({ com_type, target, asm_reg::reg_type::ecx });
+        return;
+    }
+    code.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, target });
+    code.push_back({ asm_command::type::cdq });
+    code.push_back({ asm_command::type::idiv, asm_reg::reg_type::ecx });
+    code.push_back({ asm_command::type::mov, target, asm_reg::reg_type::eax });
+}
+
 void operation_node::to_asm(asm_code& code) const {
+    if (instruction_selector(code).select_value(*this))
+        return;
     left_->to_asm_code(code);
     if (right_ == nullptr) {
         if (operation_type_ == tokenizer::token::sub_types::minus)
             if (type() == real()) 
-                code.push_back({ asm_command::type::xor, {asm_reg::reg_type::esp, asm_mem::mem_size::byte, 7},{"128"} });
+                code.push_back({ asm_command::type::xor, {asm_reg::reg_type::esp, asm_mem::mem_size::byte, 7}, 128 });
             else
                 code.push_back({ asm_command::type::neg,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword} });
         else if (operation_type_ == tokenizer::token::sub_types::not)
@@ -235,7 +302,7 @@ void operation_node::to_asm(asm_code& code) const {
         reg1 = asm_reg::reg_type::xmm0;
         reg2 = asm_reg::reg_type::xmm1;
         code.push_back({ asm_command::type::movsd, reg2,{ asm_reg::reg_type::esp, asm_mem::mem_size::qword } });
-        code.push_back({ asm_command::type::add,{ asm_reg::reg_type::esp },{ "8" } });
+        code.push_back({ asm_command::type::add,{ asm_reg::reg_type::esp }, 8 });
         code.push_back({ asm_command::type::movsd, reg1,{ asm_reg::reg_type::esp, asm_mem::mem_size::qword } });
         com_type = f_ops.at(operation_type_);
     }
@@ -282,7 +349,7 @@ void operation_node::to_asm_compare(asm_code& code) const {
     case type::type_category::character: 
         code.push_back({ asm_command::type::movsx, asm_reg::reg_type::ebx, {asm_reg::reg_type::esp, asm_mem::mem_size::byte} });
         code.push_back({ asm_command::type::movsx, asm_reg::reg_type::eax, { asm_reg::reg_type::esp, asm_mem::mem_size::byte, 1 } });
-        code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, {"2"} });
+        code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 2 });
         code.push_back({ asm_command::type::cmp, asm_reg::reg_type::eax, asm_reg::reg_type::ebx });
         comm = ops.at(operation_type_);
         break;
@@ -299,20 +366,23 @@ void operation_node::to_asm_compare(asm_code& code) const {
             : asm_command::type::comisd;
         code.push_back({ asm_command::type::movsd, asm_reg::reg_type::xmm0,{ asm_reg::reg_type::esp, asm_mem::mem_size::qword, 8 } });
         code.push_back({ asm_command::type::movsd, asm_reg::reg_type::xmm1,{ asm_reg::reg_type::esp, asm_mem::mem_size::qword } });
-        code.push_back({ asm_command::type::add, asm_reg::reg_type::esp,{ "12" } });
-        code.push_back({ comp_com, asm_reg::reg_type::xmm0,asm_reg::reg_type::xmm1 });
+        code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 12 });
+        if (is_less(operation_type_))
+            code.push_back({ comp_com, asm_reg::reg_type::xmm1, asm_reg::reg_type::xmm0 });
+        else
+            code.push_back({ comp_com, asm_reg::reg_type::xmm0, asm_reg::reg_type::xmm1 });
         comm = f_ops.at(operation_type_);
         if (!is_equ)
             break;
-        const auto label = code.get_label_name(position().first, position().second, "CONDFAIL");
-        const auto end_l = code.get_label_name(position().first, position().second, "ENDCOND");
+        const auto label = code.new_label();
+        const auto end_l = code.new_label();
         code.push_back(asm_command::type::lahf);
-        code.push_back({ asm_command::type::test, asm_reg::reg_type::ah,{ "68" } });
+        code.push_back({ asm_command::type::test, asm_reg::reg_type::ah, 68 });
         code.push_back({ comm,{ label } });
-        code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword},{ "-1" } });
+        code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword}, -1 });
         code.push_back({ asm_command::type::jmp,{ end_l } });
         code.push_back({ asm_command::type::label,{ label } });
-        code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword},{ "0" } });
+        code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword}, 0 });
         code.push_back({ asm_command::type::label,{ end_l } });
         return;
     }
@@ -320,11 +390,113 @@ void operation_node::to_asm_compare(asm_code& code) const {
         throw std::logic_error("This point should be unreachable");
     }
     code.push_back({ comm, asm_reg::reg_type::al });
-    code.push_back({ asm_command::type::sub, asm_reg::reg_type::al, {"1"} });
+    code.push_back({ asm_command::type::sub, asm_reg::reg_type::al, 1 });
     code.push_back({ asm_command::type::movsx, asm_reg::reg_type::eax, asm_reg::reg_type::al });
     code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword }, asm_reg::reg_type::eax });
 }
 
+void operation_node::to_asm_condition(asm_code& code, const asm_label label, const bool jump_if) {
+    if (code.short_circuit() && is_boolean())
+        switch (operation_type_) {
+        case tokenizer::token::sub_types::not:
+            left_->to_asm_condition(code, label, !jump_if);
+            return;
+        case tokenizer::token::sub_types::and:
+        case tokenizer::token::sub_types::or:
+        {
+            const auto is_and = operation_type_ == tokenizer::token::sub_types::and;
+            if (is_and != jump_if) {
+                left_->to_asm_condition(code, label, jump_if);
+                right_->to_asm_condition(code, label, jump_if);
+                return;
+            }
+            const auto skip_label = code.new_label();
+            left_->to_asm_condition(code, skip_label, !jump_if);
+            right_->to_asm_condition(code, label, jump_if);
+            code.push_back({ asm_command::type::label, skip_label });
+            return;
+        }
+        default:
+            break;
+        }
+    if (!is_relational(operation_type_)) {
+        tree_node::to_asm_condition(code, label, jump_if);
+        return;
+    }
+    if (instruction_selector(code).select_condition(*this, label, jump_if))
+        return;
+    left_->to_asm_code(code);
+    right_->to_asm_code(code);
+    const auto t = std::dynamic_pointer_cast<typed>(left_)->type();
+    switch (t->category()) {
+    case type::type_category::character:
+        code.push_back({ asm_command::type::movsx, asm_reg::reg_type::ebx, { asm_reg::reg_type::esp, asm_mem::mem_size::byte } });
+        code.push_back({ asm_command::type::movsx, asm_reg::reg_type::eax, { asm_reg::reg_type::esp, asm_mem::mem_size::byte, 1 } });
+        code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 2 });
+        break;
+    case type::type_category::integer:
+        code.push_back({ asm_command::type::pop, asm_reg::reg_type::ebx });
+        code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
+        break;
+    case type::type_category::real:
+    {
+        const auto is_equ = operation_type_ == tokenizer::token::sub_types::equal || operation_type_ == tokenizer::token::sub_types::not_equal;
+        code.push_back({ asm_command::type::movsd, asm_reg::reg_type::xmm0, { asm_reg::reg_type::esp, asm_mem::mem_size::qword, 8 } });
+        code.push_back({ asm_command::type::movsd, asm_reg::reg_type::xmm1, { asm_reg::reg_type::esp, asm_mem::mem_size::qword } });
+        code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 16 });
+        if (is_less(operation_type_))
+            code.push_back({ asm_command::type::comisd, asm_reg::reg_type::xmm1, asm_reg::reg_type::xmm0 });
+        else
+            code.push_back({ is_equ ? asm_command::type::ucomisd : asm_command::type::comisd, asm_reg::reg_type::xmm0, asm_reg::reg_type::xmm1 });
+        if (!is_equ) {
+            const auto& jump = f_jumps.at(operation_type_);
+            code.push_back({ jump_if ? jump.first : jump.second, label });
+            return;
+        }
+        if ((operation_type_ == tokenizer::token::sub_types::equal) == jump_if) {
+            const auto skip_label = code.new_label();
+            code.push_back({ asm_command::type::jp, skip_label });
+            code.push_back({ asm_command::type::jz, label });
+            code.push_back({ asm_command::type::label, skip_label });
+        }
+        else {
+            code.push_back({ asm_command::type::jp, label });
+            code.push_back({ asm_command::type::jnz, label });
+        }
+        return;
+    }
+    default:
+        throw std::logic_error("This point should be unreachable");
+    }
+    code.push_back({ asm_command::type::cmp, asm_reg::reg_type::eax, asm_reg::reg_type::ebx });
+    const auto& jump = jumps.at(operation_type_);
+    code.push_back({ jump_if ? jump.first : jump.second, label });
+}
+
+bool operation_node::is_boolean() const {
+    if (is_relational(operation_type_))
+        return true;
+    const auto is_boolean_operand = [](const tree_node_p& node) {
+        const auto operation = std::dynamic_pointer_cast<operation_node>(node);
+        return operation && operation->is_boolean();
+    };
+    switch (operation_type_) {
+    case tokenizer::token::sub_types::not:
+        return is_boolean_operand(left_);
+    case tokenizer::token::sub_types::and:
+    case tokenizer::token::sub_types::or:
+    case tokenizer::token::sub_types::xor:
+        return is_boolean_operand(left_) && is_boolean_operand(right_);
+    default:
+        return false;
+    }
+}
+
+// a < b is compared as b > a, so an unordered result is false like the other real comparisons
+bool operation_node::is_less(const tokenizer::token::sub_types type) {
+    return type == tokenizer::token::sub_types::less || type == tokenizer::token::sub_types::less_equal;
+}
+
 bool operation_node::is_assign() const {
     return operation_type_ == tokenizer::token::sub_types::plus_assign   ||
            operation_type_ == tokenizer::token::sub_types::minus_assign  ||
@@ -337,21 +509,14 @@ const tree_node_p& applied::variable() const { return variable_; }
 
 void call_node::to_asm_code(asm_code& code, bool is_left) {
     const auto func = std::dynamic_pointer_cast<function_type>(std::dynamic_pointer_cast<typed>(variable())->type());
-    size_t i = 0;
-    for (; i < children()[1]->children().size(); ++i) {
-        const auto t = func->parameters().vector()[i].second.first;
-        if (t->category() == type::type_category::modified)
-            children()[1]->children()[i]->to_asm_code(code,
-                std::dynamic_pointer_cast<modified_type>(t)->modificator() == modified_type::modificator_type::var);
-        else
-            children()[1]->children()[i]->to_asm_code(code);
+    const auto result = func->return_type();
+    if (result->is_category(type::type_category::array) || result->is_category(type::type_category::record)) {
+        code.push_back({ asm_command::type::lea, asm_reg::reg_type::eax,
+            { asm_reg::reg_type::ebp, asm_mem::mem_size::dword, -code.add_frame_slot(result->data_size()) } });
+        code.push_back({ asm_command::type::push, asm_reg::reg_type::eax });
     }
-    for (; i < func->parameters().size(); ++i)
-        func->parameters().vector()[i].second.second->to_asm_code(code);
-    if (func->parameters().get_data_size() % 4 != 0)
-        code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, func->parameters().get_data_size() % 4 });
-    code.push_back({ asm_command::type::call, code.get_function_label(variable()->name()) });
-    switch (func->return_type()->category()) {
+    to_asm_call(code);
+    switch (result->category()) {
     case type::type_category::character:
         code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 1 });
         code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::byte }, asm_reg::reg_type::al });
@@ -359,23 +524,96 @@ void call_node::to_asm_code(asm_code& code, bool is_left) {
     case type::type_category::integer: 
         code.push_back({ asm_command::type::push, asm_reg::reg_type::eax });
         return;
+    case type::type_category::array:
+    case type::type_category::record:
+        code.push_back({ asm_command::type::push, asm_reg::reg_type::eax });
+        if (!is_left)
+            put_value_on_stack(code, result);
+        return;
     case type::type_category::real: 
         code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 8 });
         code.push_back({ asm_command::type::movsd, {asm_reg::reg_type::esp, asm_mem::mem_size::qword}, asm_reg::reg_type::xmm0 });
         return;
-    case type::type_category::array:
-    case type::type_category::record:
-        code.push_back({ asm_command::type::push, {"offset", code.get_temp_var_name()} });
-        return;
     case type::type_category::nil:
         return;
     default: 
         throw std::logic_error("This point should never be reached");
     }
+}
 
+void call_node::to_asm_call(asm_code& code) const {
+    const auto func = std::dynamic_pointer_cast<function_type>(std::dynamic_pointer_cast<typed>(variable())->type());
+    const auto& parameters = func->parameters();
+    const auto& args = children()[1]->children();
+    nodes_vector arguments;
+    std::vector<bool> by_reference, deferred;
+    for (size_t i = 0; i < parameters.size(); ++i) {
+        const auto t = parameters.vector()[i].second.first;
+        arguments.push_back(i < args.size() ? args[i] : parameters.vector()[i].second.second);
+        by_reference.push_back(i < args.size() && t->category() == type::type_category::modified &&
+            std::dynamic_pointer_cast<modified_type>(t)->is_reference());
+    }
+    std::unordered_map<std::string, asm_reg::reg_type> registers;
+    for (const auto& it : asm_code::get_parameter_registers(parameters))
+        registers.insert(it);
+    deferred.resize(arguments.size());
+    auto is_pure = true;
+    for (auto i = arguments.size(); i-- > 0;) {
+        is_pure = is_pure && !contains_call(arguments[i]);
+        deferred[i] = is_pure && registers.count(parameters.vector()[i].first);
+    }
+    long long reserved = 0;
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        if (deferred[i]) {
+            reserved += parameters.vector()[i].second.first->data_size();
+            continue;
+        }
+        if (reserved)
+            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, reserved });
+        reserved = 0;
+        arguments[i]->to_asm_code(code, by_reference[i]);
+    }
+    reserved += parameters.get_data_size() % 4;
+    if (reserved)
+        code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, reserved });
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        if (!deferred[i])
+            continue;
+        const auto reg = registers.at(parameters.vector()[i].first);
+        if (instruction_selector(code).select_load(*arguments[i], reg, by_reference[i]))
+            continue;
+        arguments[i]->to_asm_code(code, by_reference[i]);
+        if (by_reference[i] || base_type(parameters.vector()[i].second.first) != real())
+            code.push_back({ asm_command::type::pop, reg });
+        else {
+            code.push_back({ asm_command::type::movsd, reg, { asm_reg::reg_type::esp, asm_mem::mem_size::qword } });
+            code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 8 });
+        }
+    }
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        const auto& name = parameters.vector()[i].first;
+        if (deferred[i] || !registers.count(name))
+            continue;
+        const auto is_real = !by_reference[i] && base_type(parameters.vector()[i].second.first) == real();
+        code.push_back({ is_real ? asm_command::type::movsd : asm_command::type::mov, registers.at(name),
+            { asm_reg::reg_type::esp, is_real ? asm_mem::mem_size::qword : asm_mem::mem_size::dword,
+            parameters.get_data_size() - parameters.get_offset(name) } });
+    }
+    code.push_back({ asm_command::type::call, code.get_function_label(variable()->name()) });
 }
 
-void tree::put_value_on_stack(asm_code& code, const type_p type, const tree_node::position_type position) {
+bool tree::contains_call(const tree_node_p& node) {
+    if (!node)
+        return false;
+    if (node->category() == tree_node::node_category::call || node->category() == tree_node::node_category::write)
+        return true;
+    for (const auto& it : node->children())
+        if (contains_call(it))
+            return true;
+    return false;
+}
+
+void tree::put_value_on_stack(asm_code& code, const type_p type) {
     code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
     const auto t = type->category() == type::type_category::modified
         ? std::dynamic_pointer_cast<modified_type>(type)->base_type()
@@ -383,7 +621,7 @@ void tree::put_value_on_stack(asm_code& code, const type_p type, const tree_node
     switch (t->category()) {
     case type::type_category::character:
         code.push_back({ asm_command::type::mov, asm_reg::reg_type::al,{ asm_reg::reg_type::eax, asm_mem::mem_size::byte } });
-        code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp,{ "1" } });
+        code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 1 });
         code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::byte },asm_reg::reg_type::al });
         return;
     case type::type_category::integer:
@@ -396,13 +634,8 @@ void tree::put_value_on_stack(asm_code& code, const type_p type, const tree_node
     case type::type_category::record:
     case type::type_category::array:
     {
-        code.push_back({ asm_command::type::add, asm_reg::reg_type::eax, t->data_size() - 4 });
-        code.push_back({ asm_command::type::mov, asm_reg::reg_type::ecx, t->data_size() / 4 });
-        const auto label = code.get_label_name(position.first, position.second, "COPYSTRUCT");
-        code.push_back({ asm_command::type::label, label });
-        code.push_back({ asm_command::type::push,{ asm_reg::reg_type::eax, asm_mem::mem_size::dword } });
-        code.push_back({ asm_command::type::sub, asm_reg::reg_type::eax, 4 });
-        code.push_back({ asm_command::type::loop, label });
+        code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, static_cast<long long>(t->data_size()) });
+        code.add_block_copy(asm_reg::reg_type::eax, asm_reg::reg_type::esp, t->data_size(), code.new_label());
         return;
     }
     default:
@@ -414,33 +647,43 @@ void tree::put_value_on_stack(asm_code& code, const type_p type, const tree_node
 const tree_node_p& index_node::index() const { return index_; }
 
 void index_node::to_asm_code(asm_code& code, const bool is_left) {
+    if (!is_left && instruction_selector(code).select_value(*this))
+        return;
     index_->to_asm_code(code, false);
     variable()->to_asm_code(code, true);
     code.push_back({ asm_command::type::pop, asm_reg::reg_type::ecx });
     code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
     const auto t = base_type(std::dynamic_pointer_cast<typed>(variable())->type());
     const auto min = std::dynamic_pointer_cast<array_type>(t)->min();
-    if (min != 0)
-        code.push_back({ asm_command::type::sub, asm_reg::reg_type::eax, min });
-    code.push_back({ asm_command::type::mov, asm_reg::reg_type::ebx, type()->data_size() });
-    code.push_back({ asm_command::type::imul, asm_reg::reg_type::ebx });
-    code.push_back({ asm_command::type::add, asm_reg::reg_type::ecx, asm_reg::reg_type::eax });
+    const long long size = type()->data_size();
+    if (size == 1 || size == 2 || size == 4 || size == 8)
+        code.push_back({ asm_command::type::lea, asm_reg::reg_type::ecx,
+            { asm_reg::reg_type::ecx, asm_mem::mem_size::dword, asm_reg::reg_type::eax, size, -static_cast<long long>(min) * size } });
+    else {
+        if (min != 0)
+            code.push_back({ asm_command::type::sub, asm_reg::reg_type::eax, static_cast<long long>(min) });
+        code.push_back({ asm_command::type::mov, asm_reg::reg_type::ebx, size });
+        code.push_back({ asm_command::type::imul, asm_reg::reg_type::ebx });
+        code.push_back({ asm_command::type::add, asm_reg::reg_type::ecx, asm_reg::reg_type::eax });
+    }
     code.push_back({ asm_command::type::push, asm_reg::reg_type::ecx });
     if (is_left) return;
-    put_value_on_stack(code, type(), position());
+    put_value_on_stack(code, type());
 }
 
 //class field_access_node
 const variable_node_p& field_access_node::field() const { return field_; }
 
 void field_access_node::to_asm_code(asm_code& code, const bool is_left) {
+    if (!is_left && instruction_selector(code).select_value(*this))
+        return;
     variable()->to_asm_code(code, true);
     const auto t = base_type(std::dynamic_pointer_cast<typed>(variable())->type());
     const auto offset = std::dynamic_pointer_cast<record_type>(t)->get_field_offset(field_->name());
     if (offset != 0)
-        code.push_back({ asm_command::type::add,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword }, offset });
+        code.push_back({ asm_command::type::add,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword }, static_cast<long long>(offset) });
     if (is_left) return;
-    put_value_on_stack(code, type(), position());
+    put_value_on_stack(code, type());
 }
 
 //class cast_node
@@ -462,12 +705,12 @@ void cast_node::to_asm_code(asm_code& code, const bool is_left) {
             return;
         case type::type_category::integer: 
             code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
-            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp,{ "1" } });
+            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 1 });
             code.push_back({ asm_command::type::mov, {asm_reg::reg_type::esp, asm_mem::mem_size::byte}, asm_reg::reg_type::al});
             return;
         case type::type_category::real: 
             code.push_back({ asm_command::type::cvttsd2si, asm_reg::reg_type::eax, {asm_reg::reg_type::esp, asm_mem::mem_size::qword} });
-            code.push_back({ asm_command::type::add, asm_reg::reg_type::esp,{ "7" } });
+            code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 7 });
             code.push_back({ asm_command::type::mov, {asm_reg::reg_type::esp, asm_mem::mem_size::byte}, asm_reg::reg_type::al });
             return;
         default: 
@@ -477,14 +720,14 @@ void cast_node::to_asm_code(asm_code& code, const bool is_left) {
         switch (t->category()) { 
         case type::type_category::character: 
             code.push_back({ asm_command::type::movsx, asm_reg::reg_type::eax,{ asm_reg::reg_type::esp, asm_mem::mem_size::byte } });
-            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp,{ "3" } });
+            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 3 });
             code.push_back({ asm_command::type::mov, {asm_reg::reg_type::esp, asm_mem::mem_size::dword}, asm_reg::reg_type::eax });
             return;
         case type::type_category::integer: 
             return;
         case type::type_category::real: 
             code.push_back({ asm_command::type::cvttsd2si, asm_reg::reg_type::eax,{ asm_reg::reg_type::esp, asm_mem::mem_size::qword } });
-            code.push_back({ asm_command::type::add, asm_reg::reg_type::esp,{ "4" } });
+            code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 4 });
             code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword }, asm_reg::reg_type::eax });
             break;
         default: 
@@ -495,11 +738,11 @@ void cast_node::to_asm_code(asm_code& code, const bool is_left) {
         switch (t->category()) { 
         case type::type_category::character: 
             code.push_back({ asm_command::type::movsx, asm_reg::reg_type::eax,{ asm_reg::reg_type::esp, asm_mem::mem_size::byte } });
-            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp,{ "7" } });
+            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 7 });
             goto end;
         case type::type_category::integer: 
             code.push_back({ asm_command::type::mov, asm_reg::reg_type::eax,{ asm_reg::reg_type::esp, asm_mem::mem_size::dword } });
-            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp,{ "4" } });
+            code.push_back({ asm_command::type::sub, asm_reg::reg_type::esp, 4 });
             goto end;
         case type::type_category::real: 
             return;
@@ -550,7 +793,7 @@ void write_node::to_asm_code(asm_code& code, const bool is_left) {
         {
             f += "s%";
             const auto s = code.add_string_constant(std::dynamic_pointer_cast<constant_node>(*it)->value_string());
-            code.push_back({ asm_command::type::push, {"offset", s}});
+            code.push_back({ asm_command::type::push, asm_operand::address(s) });
             size += 4;
             break;
         }
@@ -560,7 +803,7 @@ void write_node::to_asm_code(asm_code& code, const bool is_left) {
     }
     reverse(f.begin(), f.end());
     const auto s = code.add_string_constant(f + '\n');
-    code.push_back({ asm_command::type::push,{ "offset", s } });
+    code.push_back({ asm_command::type::push, asm_operand::address(s) });
     code.push_back({ asm_command::type::call, {"crt_printf"} });
     code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, size + 4 });
 }
@@ -576,18 +819,15 @@ tree_node_p repeat_node::body() const {
 }
 
 void repeat_node::to_asm_code(asm_code& code, const bool is_left) {
-    const auto body_label = code.get_label_name(position().first, position().second, "REPEATBODY");
-    const auto cond_label = code.get_label_name(position().first, position().second, "REPEATCOND");
-    const auto end_label = code.get_label_name(position().first, position().second, "REPEATEND");
+    const auto body_label = code.new_label();
+    const auto cond_label = code.new_label();
+    const auto end_label = code.new_label();
     code.add_loop_start(cond_label);
     code.add_loop_end(end_label);
     code.push_back({ asm_command::type::label, body_label });
     children()[0]->to_asm_code(code);
     code.push_back({ asm_command::type::label, cond_label });
-    children()[1]->to_asm_code(code);
-    code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
-    code.push_back({ asm_command::type::test, asm_reg::reg_type::eax, asm_reg::reg_type::eax });
-    code.push_back({ asm_command::type::jz, body_label });
+    children()[1]->to_asm_condition(code, body_label, false);
     code.push_back({ asm_command::type::label, end_label });
     code.pop_loop_start();
     code.pop_loop_end();
@@ -614,27 +854,32 @@ tree_node_p for_node::body() const {
 }
 
 void for_node::to_asm_code(asm_code& code, bool is_left) {
-    const auto body_label = code.get_label_name(position().first, position().second, "LOOPBODY");
-    const auto cond_label = code.get_label_name(position().first, position().second, "LOOPCOND");
-    const auto end_label = code.get_label_name(position().first, position().second, "LOOPEND");
+    const auto body_label = code.new_label();
+    const auto cond_label = code.new_label();
+    const auto end_label = code.new_label();
     code.add_loop_start(cond_label);
     code.add_loop_end(end_label);
     children()[2]->to_asm_code(code);
     children()[1]->to_asm_code(code);
     const auto offset = code.get_offset(children()[0]->name());
+    asm_reg::reg_type reg;
+    const auto is_register = code.get_parameter_register(children()[0]->name(), reg);
+    const auto counter = is_register ? asm_operand(reg) : asm_operand(asm_reg::reg_type::ebx, asm_mem::mem_size::dword, -offset.second);
     code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
-    code.push_back({ asm_command::type::mov, asm_reg::reg_type::ebx, { asm_reg::reg_type::ebp, asm_mem::mem_size::dword, offset.first } });
-    code.push_back({ asm_command::type::mov, {asm_reg::reg_type::ebx, asm_mem::mem_size::dword, -offset.second}, asm_reg::reg_type::eax });
-    code.push_back({ is_downto_ ? asm_command::type::inc : asm_command::type::dec,{ asm_reg::reg_type::ebx, asm_mem::mem_size::dword, -offset.second } });
+    if (!is_register)
+        code.push_back({ asm_command::type::mov, asm_reg::reg_type::ebx, { asm_reg::reg_type::ebp, asm_mem::mem_size::dword, offset.first } });
+    code.push_back({ asm_command::type::mov, counter, asm_reg::reg_type::eax });
+    code.push_back({ is_downto_ ? asm_command::type::inc : asm_command::type::dec, counter });
     code.push_back({ asm_command::type::jmp, cond_label });
     code.push_back({ asm_command::type::label, body_label });
     if (children().size() == 4)
         children()[3]->to_asm_code(code);
     code.push_back({ asm_command::type::label, cond_label });
-    code.push_back({ asm_command::type::mov, asm_reg::reg_type::ebx,{ asm_reg::reg_type::ebp, asm_mem::mem_size::dword, offset.first } });
-    code.push_back({ is_downto_ ? asm_command::type::dec : asm_command::type::inc,{ asm_reg::reg_type::ebx, asm_mem::mem_size::dword, -offset.second } });
+    if (!is_register)
+        code.push_back({ asm_command::type::mov, asm_reg::reg_type::ebx,{ asm_reg::reg_type::ebp, asm_mem::mem_size::dword, offset.first } });
+    code.push_back({ is_downto_ ? asm_command::type::dec : asm_command::type::inc, counter });
     code.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, {asm_reg::reg_type::esp, asm_mem::mem_size::dword} });
-    code.push_back({ asm_command::type::cmp, {asm_reg::reg_type::ebx, asm_mem::mem_size::dword, -offset.second }, asm_reg::reg_type::eax });
+    code.push_back({ asm_command::type::cmp, counter, asm_reg::reg_type::eax });
     code.push_back({ is_downto_ ? asm_command::type::jge : asm_command::type::jle, body_label });
     code.push_back({ asm_command::type::label, end_label });
     code.push_back({ asm_command::type::add, asm_reg::reg_type::esp, 4 });
@@ -643,19 +888,16 @@ void for_node::to_asm_code(asm_code& code, bool is_left) {
 }
 
 void while_node::to_asm_code(asm_code& code, bool is_left) {
-    const auto body_label = code.get_label_name(position().first, position().second, "WHILEBODY");
-    const auto cond_label = code.get_label_name(position().first, position().second, "WHILECOND");
-    const auto end_label = code.get_label_name(position().first, position().second, "WHILEEND");
+    const auto body_label = code.new_label();
+    const auto cond_label = code.new_label();
+    const auto end_label = code.new_label();
     code.add_loop_start(cond_label);
     code.add_loop_end(end_label);
     code.push_back({ asm_command::type::jmp, cond_label });
     code.push_back({ asm_command::type::label, body_label });
     children()[1]->to_asm_code(code);
     code.push_back({ asm_command::type::label, cond_label });
-    children()[0]->to_asm_code(code);
-    code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
-    code.push_back({ asm_command::type::test, asm_reg::reg_type::eax, asm_reg::reg_type::eax });
-    code.push_back({ asm_command::type::jnz, body_label });
+    children()[0]->to_asm_condition(code, body_label, true);
     code.push_back({ asm_command::type::label, end_label });
     code.pop_loop_start();
     code.pop_loop_end();
@@ -678,12 +920,9 @@ void continue_node::to_asm_code(asm_code& code, bool is_left) {
 }
 
 void if_node::to_asm_code(asm_code& code, bool is_left) {
-    const auto else_label = code.get_label_name(position().first, position().second, "IFFAIL");
-    const auto end_label = code.get_label_name(position().first, position().second, "IFEND");
-    children()[0]->to_asm_code(code);
-    code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
-    code.push_back({ asm_command::type::test, asm_reg::reg_type::eax, asm_reg::reg_type::eax });
-    code.push_back({ asm_command::type::jz, else_label });
+    const auto else_label = code.new_label();
+    const auto end_label = code.new_label();
+    children()[0]->to_asm_condition(code, else_label, false);
     if (then_branch())
         then_branch()->to_asm_code(code);
     code.push_back({ asm_command::type::jmp, end_label });
@@ -733,19 +972,12 @@ void exit_node::to_asm_code(asm_code& code, bool is_left) {
             break;
         case type::type_category::array:
         case type::type_category::record:
-        {
-            code.push_back({ asm_command::type::lea, asm_reg::reg_type::ebx,code.get_temp_var_name() });
             code.push_back({ asm_command::type::pop, asm_reg::reg_type::eax });
-            code.push_back({ asm_command::type::mov, asm_reg::reg_type::ecx, f->data_size() / 4 });
-            const auto label = code.get_label_name(position().first, position().second, "COPYSTRUCT");
-            code.push_back({ asm_command::type::label, label });
-            code.push_back({ asm_command::type::mov,asm_reg::reg_type::edx,{ asm_reg::reg_type::eax, asm_mem::mem_size::dword } });
-            code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::ebx, asm_mem::mem_size::dword }, asm_reg::reg_type::edx });
-            code.push_back({ asm_command::type::add, asm_reg::reg_type::eax, 4 });
-            code.push_back({ asm_command::type::add, asm_reg::reg_type::ebx, 4 });
-            code.push_back({ asm_command::type::loop, label });
+            code.push_back({ asm_command::type::mov, asm_reg::reg_type::ebx,
+                { asm_reg::reg_type::ebp, asm_mem::mem_size::dword, code.get_return_slot_offset() } });
+            code.add_block_copy(asm_reg::reg_type::eax, asm_reg::reg_type::ebx, f->data_size(), code.new_label());
+            code.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, asm_reg::reg_type::ebx });
             break;
-        }
         default:
             throw std::logic_error("This point should never be reached!");
         }
@@ -766,23 +998,16 @@ void exit_node::to_asm_code(asm_code& code, bool is_left) {
             break;
         case type::type_category::array:
         case type::type_category::record:
-        {
-            code.push_back({ asm_command::type::lea, asm_reg::reg_type::ebx,code.get_temp_var_name() });
             code.push_back({ asm_command::type::lea, asm_reg::reg_type::eax,{ asm_reg::reg_type::ebp, asm_mem::mem_size::dword, -offset.second } });
-            code.push_back({ asm_command::type::mov, asm_reg::reg_type::ecx, f->data_size() / 4 });
-            const auto label = code.get_label_name(position().first, position().second, "COPYSTRUCT");
-            code.push_back({ asm_command::type::label, label });
-            code.push_back({ asm_command::type::mov,asm_reg::reg_type::edx,{ asm_reg::reg_type::eax, asm_mem::mem_size::dword } });
-            code.push_back({ asm_command::type::mov,{ asm_reg::reg_type::ebx, asm_mem::mem_size::dword }, asm_reg::reg_type::edx });
-            code.push_back({ asm_command::type::add, asm_reg::reg_type::eax, 4 });
-            code.push_back({ asm_command::type::add, asm_reg::reg_type::ebx, 4 });
-            code.push_back({ asm_command::type::loop, label });
+            code.push_back({ asm_command::type::mov, asm_reg::reg_type::ebx,
+                { asm_reg::reg_type::ebp, asm_mem::mem_size::dword, code.get_return_slot_offset() } });
+            code.add_block_copy(asm_reg::reg_type::eax, asm_reg::reg_type::ebx, f->data_size(), code.new_label());
+            code.push_back({ asm_command::type::mov, asm_reg::reg_type::eax, asm_reg::reg_type::ebx });
             break;
-        }
         default:
             throw std::logic_error("This point should never be reached!");
         }
     }
     code.push_back({ asm_command::type::leave });
-    code.push_back({ asm_command::type::ret, code.get_current_function_param_size() });
+    code.push_back({ asm_command::type::ret, static_cast<long long>(code.get_current_function_param_size()) });
 }
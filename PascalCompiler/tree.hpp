@@ -18,6 +18,12 @@ namespace pascal_compiler {
 
     }// namespace optimizer
 
+    namespace code {
+
+        class instruction_selector;
+
+    }// namespace code
+
     namespace syntax_analyzer {
 
         using namespace types;
@@ -91,6 +97,7 @@ namespace pascal_compiler {
                 const position_type& position() const;
                 std::string to_string(const std::string& prefix = "", const bool last = true) const;
                 virtual void to_asm_code(asm_code& code, bool is_left = false);
+                virtual void to_asm_condition(asm_code& code, const asm_label label, const bool jump_if);
 
             private:
 
@@ -203,21 +210,33 @@ namespace pascal_compiler {
                     tree_node(name, node_category::operation, position, left, right),
                     typed(result_type), operation_type_(type), left_(left), right_(right) {}
 
+                operation_node(const tokenizer::token::sub_types type, const position_type& position,
+                    const tree_node_p& left, const std::string& name) :
+                    tree_node(name, node_category::operation, position, left),
+                    typed(get_type(left)), operation_type_(type), left_(left) {}
+
                 tokenizer::token::sub_types operation_type() const;
                 const tree_node_p& left() const;
                 const tree_node_p& right() const;
                 bool is_assign() const;
+                bool is_boolean() const;
 
                 void to_asm_code(asm_code& code, const bool is_left = false) override;
+                void to_asm_condition(asm_code& code, const asm_label label, const bool jump_if) override;
 
             private:
 
+                friend class code::instruction_selector;
+
                 void to_asm_assign(asm_code& code) const;
+                void to_asm_register_assign(asm_code& code, const asm_reg::reg_type target) const;
                 void to_asm(asm_code& code) const;
                 void to_asm_compare(asm_code& code) const;
+                static bool is_less(const tokenizer::token::sub_types type);
                 tokenizer::token::sub_types operation_type_;
                 tree_node_p left_ = nullptr, right_ = nullptr;
                 static const std::unordered_map<tokenizer::token::sub_types, asm_command::type> ops, f_ops;
+                static const std::unordered_map<tokenizer::token::sub_types, std::pair<asm_command::type, asm_command::type>> jumps, f_jumps;
 
             };// class operation_node
 
@@ -263,10 +282,12 @@ namespace pascal_compiler {
                     applied(function) {}
 
                 void to_asm_code(asm_code& code, bool is_left) override;
+                void to_asm_call(asm_code& code) const;
 
             };// class call_node
 
-            void put_value_on_stack(asm_code& code, type_p type, const tree_node::position_type position);
+            void put_value_on_stack(asm_code& code, type_p type);
+            bool contains_call(const tree_node_p& node);
 
             class index_node;
             typedef std::shared_ptr<index_node> index_node_p;
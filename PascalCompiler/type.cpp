@@ -104,6 +104,10 @@ void function_type::set_table(const symbols_table& table) {
     table_ = table;
 }
 
+void function_type::set_parameters(const symbols_table& parameters) {
+    parameters_ = parameters;
+}
+
 std::string function_type::to_string(const std::string& prefix) const {
     std::string result = "function (";
     for (const auto it : parameters_.vector()) {
@@ -120,6 +124,10 @@ std::string function_type::to_string(const std::string& prefix) const {
 //class modified_type
 modified_type::modificator_type modified_type::modificator() const { return modificator_; }
 
+bool modified_type::is_reference() const {
+    return modificator_ == modificator_type::var || by_reference_;
+}
+
 std::string modified_type::to_string(const std::string& prefix) const {
     const std::string str = modificator_ == modificator_type::constant ? "const " : "var ";
     return str + type_->to_string(prefix + std::string(str.length(), ' '));
@@ -128,7 +136,7 @@ std::string modified_type::to_string(const std::string& prefix) const {
 const type_p& modified_type::base_type() const { return type_; }
 
 size_t modified_type::data_size() const {
-    return modificator_ == modificator_type::var ? 4 : base_type()->data_size();
+    return is_reference() ? 4 : base_type()->data_size();
 }
 
 //class pointer_type
@@ -159,6 +159,7 @@ namespace pascal_compiler {
                 const symbols_table& table() const;
                 const type_p& return_type() const;
                 void set_table(const symbols_table& table);
+                void set_parameters(const symbols_table& parameters);
                 std::string to_string(const std::string& prefix = "") const override;
 
             private:
@@ -178,10 +179,11 @@ namespace pascal_compiler {
 
                 enum class modificator_type { constant, var };
 
-                modified_type(const modificator_type modificator, const type_p& type) :
-                    type("", type_category::modified), type_(type), modificator_(modificator) {};
+                modified_type(const modificator_type modificator, const type_p& type, const bool by_reference = false) :
+                    type("", type_category::modified), type_(type), modificator_(modificator), by_reference_(by_reference) {};
 
                 modificator_type modificator() const;
+                bool is_reference() const;
                 std::string to_string(const std::string& prefix = "") const override;
                 const type_p& base_type() const;
                 size_t data_size() const override;
@@ -190,6 +192,7 @@ namespace pascal_compiler {
 
                 type_p type_;
                 modificator_type modificator_;
+                bool by_reference_;
 
             };// class modified_type
 
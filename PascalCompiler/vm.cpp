@@ -0,0 +1,478 @@
+#include "vm.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace pascal_compiler;
+using namespace bytecode;
+
+#ifdef __GNUC__
+#define VM_HANDLER(name) case opcode::name: op_##name:
+#define VM_DISPATCH() goto *handlers[static_cast<size_t>(ip->op)]
+#else
+#define VM_HANDLER(name) case opcode::name:
+#define VM_DISPATCH() continue
+#endif
+
+vm_exception::vm_exception(const std::string& message) {
+    message_ = message;
+}
+
+machine::machine(const program& code) :
+    code_(code), storage_(memory_size(code)), memory_(storage_.data()),
+    base_(reinterpret_cast<std::uintptr_t>(memory_)), origin_(0) {
+    initialize();
+}
+
+machine::machine(const program& code, unsigned char* memory) :
+    code_(code), memory_(memory), base_(0), origin_(static_cast<std::int32_t>(reinterpret_cast<std::uintptr_t>(memory))) {
+    initialize();
+}
+
+void machine::initialize() {
+    std::memcpy(memory_, code_.data().data(), code_.data().size());
+    for (const auto& f : code_.functions()) {
+        constants_.emplace_back();
+        for (const auto& it : f.constants) {
+            auto value = it.value;
+            if (it.kind == constant_kind::address)
+                value.integer += origin_;
+            constants_.back().push_back(value);
+        }
+    }
+    registers_.reset(new slot[registers_size]);
+    counters_.assign(code_.functions().size(), { 0, 0 });
+    native_.reset(new std::atomic<const void*>[code_.functions().size()]);
+    for (size_t i = 0; i < code_.functions().size(); ++i)
+        native_[i].store(nullptr);
+    gate_.store(nullptr);
+}
+
+void machine::set_tier_up(const size_t call_threshold, const size_t back_edge_threshold, const tier_up_handler& handler) {
+    call_threshold_ = call_threshold;
+    back_edge_threshold_ = back_edge_threshold;
+    tier_up_ = handler;
+}
+
+void machine::set_gate(const void* gate) {
+    gate_.store(gate, std::memory_order_release);
+}
+
+void machine::set_native(const size_t function, const void* entry) {
+    native_[function].store(entry, std::memory_order_release);
+}
+
+const std::vector<machine::counter_t>& machine::counters() const {
+    return counters_;
+}
+
+size_t machine::memory_size(const program& code) {
+    return code.data().size() + stack_size;
+}
+
+void machine::run() {
+#ifdef __GNUC__
+    static const void* const handlers[] = {
+        &&op_mov, &&op_add_int, &&op_sub_int, &&op_mul_int, &&op_div_int, &&op_mod_int, &&op_and_int, &&op_or_int,
+        &&op_xor_int, &&op_shl_int, &&op_shr_int, &&op_neg_int, &&op_not_int, &&op_add_real, &&op_sub_real,
+        &&op_mul_real, &&op_div_real, &&op_neg_real, &&op_eq_int, &&op_ne_int, &&op_lt_int, &&op_le_int, &&op_gt_int,
+        &&op_ge_int, &&op_eq_real, &&op_ne_real, &&op_lt_real, &&op_le_real, &&op_gt_real, &&op_ge_real,
+        &&op_int_to_real, &&op_real_to_int, &&op_int_to_char, &&op_address_local, &&op_address_outer,
+        &&op_load_local_int, &&op_load_local_char, &&op_load_local_real, &&op_store_local_int, &&op_store_local_char,
+        &&op_store_local_real, &&op_load_int, &&op_load_char, &&op_load_real, &&op_store_int, &&op_store_char,
+        &&op_store_real, &&op_copy, &&op_push_int, &&op_push_char, &&op_push_real, &&op_push_block, &&op_call, &&op_ret,
+        &&op_ret_int, &&op_ret_real, &&op_ret_block, &&op_jump, &&op_jump_if, &&op_jump_unless, &&op_jump_back,
+        &&op_jump_back_if, &&op_jump_back_unless, &&op_write_int, &&op_write_char, &&op_write_real, &&op_write_string,
+        &&op_write_line
+    };
+#endif
+    const auto base = base_;
+    const auto at = [base](const std::int32_t address) {
+        return reinterpret_cast<unsigned char*>(base + static_cast<std::uint32_t>(address));
+    };
+    const auto slot_size = code_.slot_size();
+    const auto functions = code_.functions().data();
+    const auto stack_limit = origin_ + static_cast<std::int32_t>(code_.data().size());
+    const auto registers_end = registers_.get() + registers_size;
+    auto sp = origin_ + static_cast<std::int32_t>(memory_size(code_)), fp = 0;
+    auto f = functions;
+    auto regs = registers_.get();
+    slot result;
+    const auto push_slot = [&](const std::int32_t value) {
+        sp -= slot_size;
+        std::memset(at(sp), 0, slot_size);
+        write_int(at(sp), value);
+    };
+    const auto enter = [&](const function& callee) {
+        sp -= callee.padding + slot_size;
+        push_slot(fp);
+        const auto frame = sp;
+        for (std::int32_t i = 1; i < static_cast<std::int32_t>(callee.depth); ++i)
+            push_slot(read_int(at(fp - slot_size * i)));
+        push_slot(frame);
+        sp -= callee.frame_size;
+        fp = frame;
+        if (sp < stack_limit || regs + callee.registers > registers_end)
+            throw vm_exception("Stack overflow");
+        const auto& constants = constants_[&callee - functions];
+        std::copy(constants.begin(), constants.end(), regs + callee.registers - constants.size());
+    };
+    enter(*f);
+    auto ip = f->code.data();
+    for (;;)
+        switch (ip->op) {
+        VM_HANDLER(mov)
+            regs[ip->a] = regs[ip->b];
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(add_int)
+            regs[ip->a].integer = static_cast<std::int32_t>(
+                static_cast<std::uint32_t>(regs[ip->b].integer) + static_cast<std::uint32_t>(regs[ip->c].integer));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(sub_int)
+            regs[ip->a].integer = static_cast<std::int32_t>(
+                static_cast<std::uint32_t>(regs[ip->b].integer) - static_cast<std::uint32_t>(regs[ip->c].integer));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(mul_int)
+            regs[ip->a].integer = static_cast<std::int32_t>(
+                static_cast<std::uint32_t>(regs[ip->b].integer) * static_cast<std::uint32_t>(regs[ip->c].integer));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(div_int)
+            regs[ip->a].integer = regs[ip->b].integer / regs[ip->c].integer;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(mod_int)
+            regs[ip->a].integer = regs[ip->b].integer % regs[ip->c].integer;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(and_int)
+            regs[ip->a].integer = regs[ip->b].integer & regs[ip->c].integer;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(or_int)
+            regs[ip->a].integer = regs[ip->b].integer | regs[ip->c].integer;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(xor_int)
+            regs[ip->a].integer = regs[ip->b].integer ^ regs[ip->c].integer;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(shl_int)
+            regs[ip->a].integer = static_cast<std::int32_t>(static_cast<std::uint32_t>(regs[ip->b].integer) << (regs[ip->c].integer & 31));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(shr_int)
+            regs[ip->a].integer = static_cast<std::int32_t>(static_cast<std::uint32_t>(regs[ip->b].integer) >> (regs[ip->c].integer & 31));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(neg_int)
+            regs[ip->a].integer = static_cast<std::int32_t>(0u - static_cast<std::uint32_t>(regs[ip->b].integer));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(not_int)
+            regs[ip->a].integer = ~regs[ip->b].integer;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(add_real)
+            regs[ip->a].real = regs[ip->b].real + regs[ip->c].real;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(sub_real)
+            regs[ip->a].real = regs[ip->b].real - regs[ip->c].real;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(mul_real)
+            regs[ip->a].real = regs[ip->b].real * regs[ip->c].real;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(div_real)
+            regs[ip->a].real = regs[ip->b].real / regs[ip->c].real;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(neg_real)
+            regs[ip->a].real = -regs[ip->b].real;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(eq_int)
+            regs[ip->a].integer = regs[ip->b].integer == regs[ip->c].integer ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(ne_int)
+            regs[ip->a].integer = regs[ip->b].integer != regs[ip->c].integer ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(lt_int)
+            regs[ip->a].integer = regs[ip->b].integer < regs[ip->c].integer ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(le_int)
+            regs[ip->a].integer = regs[ip->b].integer <= regs[ip->c].integer ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(gt_int)
+            regs[ip->a].integer = regs[ip->b].integer > regs[ip->c].integer ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(ge_int)
+            regs[ip->a].integer = regs[ip->b].integer >= regs[ip->c].integer ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(eq_real)
+            regs[ip->a].integer = regs[ip->b].real == regs[ip->c].real ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(ne_real)
+            regs[ip->a].integer = regs[ip->b].real != regs[ip->c].real ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(lt_real)
+            regs[ip->a].integer = regs[ip->b].real < regs[ip->c].real ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(le_real)
+            regs[ip->a].integer = regs[ip->b].real <= regs[ip->c].real ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(gt_real)
+            regs[ip->a].integer = regs[ip->b].real > regs[ip->c].real ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(ge_real)
+            regs[ip->a].integer = regs[ip->b].real >= regs[ip->c].real ? -1 : 0;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(int_to_real)
+            regs[ip->a].real = regs[ip->b].integer;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(real_to_int)
+        {
+            const auto value = regs[ip->b].real;
+            regs[ip->a].integer = value > -2147483649.0 && value < 2147483648.0
+                ? static_cast<std::int32_t>(value)
+                : std::numeric_limits<std::int32_t>::min();
+            ++ip;
+            VM_DISPATCH();
+        }
+        VM_HANDLER(int_to_char)
+            regs[ip->a].integer = static_cast<signed char>(regs[ip->b].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(address_local)
+            regs[ip->a].integer = fp - ip->value;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(address_outer)
+            regs[ip->a].integer = read_int(at(fp - slot_size * ip->b)) - ip->value;
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(load_local_int)
+            regs[ip->a].integer = read_int(at(fp - ip->value));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(load_local_char)
+            regs[ip->a].integer = static_cast<signed char>(*at(fp - ip->value));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(load_local_real)
+            regs[ip->a].real = read_real(at(fp - ip->value));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(store_local_int)
+            write_int(at(fp - ip->value), regs[ip->a].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(store_local_char)
+            *at(fp - ip->value) = static_cast<unsigned char>(regs[ip->a].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(store_local_real)
+            write_real(at(fp - ip->value), regs[ip->a].real);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(load_int)
+            regs[ip->a].integer = read_int(at(regs[ip->b].integer));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(load_char)
+            regs[ip->a].integer = static_cast<signed char>(*at(regs[ip->b].integer));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(load_real)
+            regs[ip->a].real = read_real(at(regs[ip->b].integer));
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(store_int)
+            write_int(at(regs[ip->a].integer), regs[ip->b].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(store_char)
+            *at(regs[ip->a].integer) = static_cast<unsigned char>(regs[ip->b].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(store_real)
+            write_real(at(regs[ip->a].integer), regs[ip->b].real);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(copy)
+            std::memmove(at(regs[ip->a].integer), at(regs[ip->b].integer), ip->value);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(push_int)
+            sp -= 4;
+            write_int(at(sp), regs[ip->a].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(push_char)
+            *at(--sp) = static_cast<unsigned char>(regs[ip->a].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(push_real)
+            sp -= 8;
+            write_real(at(sp), regs[ip->a].real);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(push_block)
+            sp -= ip->value;
+            std::memmove(at(sp), at(regs[ip->a].integer), ip->value);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(call)
+        {
+            const auto& callee = functions[ip->value];
+            if (++counters_[ip->value].calls == call_threshold_ && tier_up_)
+                tier_up_(ip->value);
+            const auto entry = native_[ip->value].load(std::memory_order_acquire);
+            if (entry) {
+                const auto gate = gate_.load(std::memory_order_acquire);
+                sp -= callee.padding;
+                if (callee.real_result)
+                    result.real = reinterpret_cast<real_gate>(gate)(entry, static_cast<std::uint32_t>(sp), static_cast<std::uint32_t>(fp));
+                else
+                    result.integer = reinterpret_cast<integer_gate>(gate)(entry, static_cast<std::uint32_t>(sp), static_cast<std::uint32_t>(fp));
+                sp += callee.parameters_size;
+                if (ip->a != program::no_register)
+                    regs[ip->a] = result;
+                ++ip;
+                VM_DISPATCH();
+            }
+            frames_.push_back({ f, ip + 1, regs, ip->a });
+            regs += f->registers;
+            f = &callee;
+            enter(callee);
+            ip = callee.code.data();
+            VM_DISPATCH();
+        }
+        VM_HANDLER(ret_int)
+            result.integer = regs[ip->a].integer;
+            goto leave;
+        VM_HANDLER(ret_real)
+            result.real = regs[ip->a].real;
+            goto leave;
+        VM_HANDLER(ret_block)
+            result.integer = read_int(at(fp + f->return_slot));
+            std::memmove(at(result.integer), at(regs[ip->a].integer), f->return_size);
+            goto leave;
+        VM_HANDLER(ret)
+        leave:
+        {
+            sp = fp;
+            fp = read_int(at(sp));
+            sp += 2 * slot_size + f->parameters_size;
+            if (frames_.empty()) {
+                std::fflush(stdout);
+                return;
+            }
+            const auto caller = frames_.back();
+            frames_.pop_back();
+            f = caller.callee;
+            ip = caller.ip;
+            regs = caller.registers;
+            if (caller.result != program::no_register)
+                regs[caller.result] = result;
+            VM_DISPATCH();
+        }
+        VM_HANDLER(jump)
+            ip = f->code.data() + ip->value;
+            VM_DISPATCH();
+        VM_HANDLER(jump_if)
+            ip = regs[ip->a].integer ? f->code.data() + ip->value : ip + 1;
+            VM_DISPATCH();
+        VM_HANDLER(jump_unless)
+            ip = regs[ip->a].integer ? ip + 1 : f->code.data() + ip->value;
+            VM_DISPATCH();
+        VM_HANDLER(jump_back)
+            if (++counters_[f - functions].back_edges == back_edge_threshold_ && tier_up_)
+                tier_up_(f - functions);
+            ip = f->code.data() + ip->value;
+            VM_DISPATCH();
+        VM_HANDLER(jump_back_if)
+            if (!regs[ip->a].integer) {
+                ++ip;
+                VM_DISPATCH();
+            }
+            if (++counters_[f - functions].back_edges == back_edge_threshold_ && tier_up_)
+                tier_up_(f - functions);
+            ip = f->code.data() + ip->value;
+            VM_DISPATCH();
+        VM_HANDLER(jump_back_unless)
+            if (regs[ip->a].integer) {
+                ++ip;
+                VM_DISPATCH();
+            }
+            if (++counters_[f - functions].back_edges == back_edge_threshold_ && tier_up_)
+                tier_up_(f - functions);
+            ip = f->code.data() + ip->value;
+            VM_DISPATCH();
+        VM_HANDLER(write_int)
+            std::printf("%d", regs[ip->a].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(write_char)
+            std::putchar(regs[ip->a].integer);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(write_real)
+            std::printf("%f", regs[ip->a].real);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(write_string)
+            std::fputs(reinterpret_cast<const char*>(at(regs[ip->a].integer)), stdout);
+            ++ip;
+            VM_DISPATCH();
+        VM_HANDLER(write_line)
+            std::putchar('\n');
+            ++ip;
+            VM_DISPATCH();
+        default:
+            throw std::logic_error("This point should never be reached");
+        }
+}
+
+std::int32_t machine::read_int(const unsigned char* address) {
+    std::int32_t result;
+    std::memcpy(&result, address, sizeof result);
+    return result;
+}
+
+void machine::write_int(unsigned char* address, const std::int32_t value) {
+    std::memcpy(address, &value, sizeof value);
+}
+
+double machine::read_real(const unsigned char* address) {
+    double result;
+    std::memcpy(&result, address, sizeof result);
+    return result;
+}
+
+void machine::write_real(unsigned char* address, const double value) {
+    std::memcpy(address, &value, sizeof value);
+}
+
+#undef VM_HANDLER
+#undef VM_DISPATCH
@@ -0,0 +1,84 @@
+#pragma once
+#include "bytecode.hpp"
+#include "exceptions.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pascal_compiler {
+
+    namespace bytecode {
+
+        class vm_exception : public exception {
+
+        public:
+
+            explicit vm_exception(const std::string& message);
+
+        };
+
+        class machine {
+
+        public:
+
+            struct counter_t {
+                size_t calls;
+                size_t back_edges;
+            };
+
+            typedef std::function<void(size_t)> tier_up_handler;
+
+            explicit machine(const program& code);
+            machine(const program& code, unsigned char* memory);
+
+            void run();
+            void set_tier_up(const size_t call_threshold, const size_t back_edge_threshold, const tier_up_handler& handler);
+            void set_gate(const void* gate);
+            void set_native(const size_t function, const void* entry);
+            const std::vector<counter_t>& counters() const;
+            static size_t memory_size(const program& code);
+
+        private:
+
+            typedef std::int32_t(*integer_gate)(const void*, std::uint64_t, std::uint64_t);
+            typedef double(*real_gate)(const void*, std::uint64_t, std::uint64_t);
+
+            struct frame {
+                const function* callee;
+                const instruction* ip;
+                slot* registers;
+                std::uint16_t result;
+            };
+
+            static const size_t stack_size = 8 << 20;
+            static const size_t registers_size = 1 << 22;
+
+            const program& code_;
+            std::vector<unsigned char> storage_;
+            unsigned char* memory_;
+            std::uintptr_t base_;
+            std::int32_t origin_;
+            std::vector<std::vector<slot>> constants_;
+            std::unique_ptr<slot[]> registers_;
+            std::vector<frame> frames_;
+            std::vector<counter_t> counters_;
+            std::unique_ptr<std::atomic<const void*>[]> native_;
+            std::atomic<const void*> gate_;
+            size_t call_threshold_ = 0, back_edge_threshold_ = 0;
+            tier_up_handler tier_up_;
+
+            void initialize();
+
+            static std::int32_t read_int(const unsigned char* address);
+            static void write_int(unsigned char* address, const std::int32_t value);
+            static double read_real(const unsigned char* address);
+            static void write_real(unsigned char* address, const double value);
+
+        };// class machine
+
+    }// namespace bytecode
+
+}// namespace pascal_compiler